@@ -91,9 +91,12 @@
 #include "text_parser.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_comp.h"
 #include "planner.h"
 #include "stepper.h"
+#include "step_stream.h"
 #include "encoder.h"
+#include "kinematics.h"
 #include "spindle.h"
 #include "report.h"
 #include "gpio.h"
@@ -112,6 +115,27 @@ extern "C"{
 
 cmSingleton_t cm;		// canonical machine controller singleton
 
+/* Dogleg traverses are queued here and issued to the planner from the main loop
+ * (see cm_dogleg_callback()). G28 and G30 queue two traverses back to back.
+ */
+#define DOGLEG_QUEUE_SIZE 2
+#define DOGLEG_LEGS 3							// lift Z, traverse, drop Z
+
+typedef struct cmDogleg {
+	uint8_t count;								// traverses queued, including the running one
+	uint8_t rd;									// running traverse
+	uint8_t leg;								// running leg of the running traverse
+	uint8_t leg_count;							// 0 if the running traverse has not been started
+	GCodeState_t gm[DOGLEG_QUEUE_SIZE];			// queued traverses. Target is the final position
+	float leg_end[DOGLEG_LEGS][AXES];			// ends of the legs of the running traverse
+	float start[AXES];							// start of the running leg
+	float time[AXES];							// time for each axis to complete the leg
+	float t_final;								// time of the last breakpoint in the leg
+	float t_prev;								// time of the last queued breakpoint
+	float t_scan;								// time of the last breakpoint considered
+} cmDogleg_t;
+static cmDogleg_t dog;
+
 /***********************************************************************************
  **** GENERIC STATIC FUNCTIONS AND VARIABLES ***************************************
  ***********************************************************************************/
@@ -125,6 +149,10 @@ static void _exec_flood_coolant_control(float *value, float *flag);
 static void _exec_absolute_origin(float *value, float *flag);
 static void _exec_program_finalize(float *value, float *flag);
 
+static stat_t _dogleg_traverse(void);
+static uint8_t _dogleg_legs(const float start[], const float end[], float leg_end[][AXES]);
+static void _dogleg_start_leg(void);
+static stat_t _dogleg_run(void);
 static int8_t _get_axis(const index_t index);
 static int8_t _get_axis_type(const index_t index);
 
@@ -249,7 +277,9 @@ void cm_set_model_linenum(uint32_t linenum)
 /*
  * cm_get_active_coord_offset() - return the currently active coordinate offset for an axis
  *
- *	Takes G5x, G92 and absolute override into account to return the active offset for this move
+ *	Takes G5x, G92, G43 and absolute override into account to return the active offset for this move.
+ *	The tool length offset is carried as part of the Z work offset so it flows through the same
+ *	model, planner and runtime pipeline as the coordinate offsets.
  *
  *	This function is typically used to evaluate and set offsets, as opposed to cm_get_work_offset()
  *	which merely returns what's in the work_offset[] array.
@@ -261,6 +291,8 @@ float cm_get_active_coord_offset(uint8_t axis)
 	float offset = cm.offset[cm.gm.coord_system][axis];
 	if (cm.gmx.origin_offset_enable == true)
 		offset += cm.gmx.origin_offset[axis];				// includes G5x and G92 components
+	if (axis == AXIS_Z)
+		offset += cm.gmx.tool_length_offset;				// G43 tool length offset (0 if G49)
 	return (offset);
 }
 
@@ -341,6 +373,36 @@ float cm_get_work_position(GCodeState_t *gcode_state, uint8_t axis)
 	return (position);
 }
 
+/*
+ * cm_get_actual_position() - return the instantaneous machine position of an axis (mm)
+ *
+ *	Unlike the RUNTIME position (mr.position) this does not lead the motors by the
+ *	segments that are queued in the stepper pipeline. It is derived from the step counts
+ *	and the progress of the running DDA segment - see st_get_actual_steps().
+ *	Axes without a motor report the runtime position.
+ *
+ *	A status report asks for each axis in turn. The sample is taken once per SysTick
+ *	so all the axes in a report come from the same instant and the cost is paid once.
+ */
+
+float cm_get_actual_position(uint8_t axis)
+{
+	static uint32_t sample_tick = 0;
+	static float position[AXES];
+	uint32_t tick = SysTickTimer_getValue();
+
+	if ((tick != sample_tick) || (tick == 0)) {
+		float steps[MOTORS];
+		sample_tick = tick;
+		for (uint8_t i=0; i<AXES; i++) {
+			position[i] = mp_get_runtime_absolute_position(i);
+		}
+		st_get_actual_steps(steps);
+		fk_kinematics(steps, position);
+	}
+	return (position[axis]);
+}
+
 /***********************************************************************************
  * CRITICAL HELPERS
  * Core functions supporting the canonical machining functions
@@ -392,6 +454,15 @@ stat_t cm_deferred_write_callback()
 				nv_persist(&nv);				// Note: only writes values that have changed
 			}
 		}
+		for (uint8_t i=1; i<=TOOLS; i++) {		// tool table (G10 L1 and tool setter measurements)
+			float *tool = (float *)&cm.tt[i];	// length, diameter, wear
+			for (uint8_t j=0; j<3; j++) {
+				sprintf((char *)nv.token, "tt%d%c", i, ("ldw")[j]);
+				nv.index = nv_get_index((const char_t *)"", nv.token);
+				nv.value = tool[j];
+				nv_persist(&nv);
+			}
+		}
 	}
 	return (STAT_OK);
 }
@@ -411,6 +482,10 @@ stat_t cm_deferred_write_callback()
  * 	RADIUS	  - ABC axis value is provided in Gcode block in linear units
  *			  - Target is set to degrees based on axis' Radius value
  *			  - Radius mode is only processed for ABC axes. Application to XYZ is ignored.
+ *	MODULO	  - ABC axis value is an angle in degrees taken modulo 360
+ *			  - Absolute targets are reached by the shortest direction (at most 180 degrees).
+ *			    Incremental moves run as programmed, so G91 can still make whole turns
+ *			  - Whole turns are removed from the position before each move (_wrap_modulo_axes)
  *
  *	Target coordinates are provided in target[]
  *	Axes that need processing are signaled in flag[]
@@ -422,17 +497,40 @@ stat_t cm_deferred_write_callback()
 
 static float _calc_ABC(uint8_t axis, float target[], float flag[])
 {
-	if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
+	if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED) ||
+		(cm.a[axis].axis_mode == AXIS_MODULO)) {
 		return(target[axis]);	// no mm conversion - it's in degrees
 	}
 	return(_to_millimeters(target[axis]) * 360 / (2 * M_PI * cm.a[axis].radius));
 }
 
+/*
+ * _wrap_modulo_axes() - remove whole turns from modulo axis positions
+ *
+ *	Runs before each new target is set, when any arc has been fully queued. Not done while
+ *	cutter compensation holds a move, as the held move was set up in the current frame.
+ */
+static void _wrap_modulo_axes(void)
+{
+	if (cm_comp_engaged()) return;
+	for (uint8_t axis=AXIS_A; axis<=AXIS_C; axis++) {
+		if (cm.a[axis].axis_mode != AXIS_MODULO) continue;
+		float turns = floor(cm.gmx.position[axis] / 360);
+		if (fp_ZERO(turns)) continue;
+		turns = min(max(turns, -MODULO_TURNS_MAX), MODULO_TURNS_MAX);
+		cm.gmx.position[axis] -= 360 * turns;
+		cm.gm.target[axis] -= 360 * turns;
+		mp_wrap_planner_position(axis, (int16_t)turns);
+	}
+}
+
 void cm_set_model_target(float target[], float flag[])
 {
 	uint8_t axis;
 	float tmp = 0;
 
+	_wrap_modulo_axes();
+
 	// process XYZABC for lower modes
 	for (axis=AXIS_X; axis<=AXIS_Z; axis++) {
 		if ((fp_FALSE(flag[axis])) || (cm.a[axis].axis_mode == AXIS_DISABLED)) {
@@ -454,6 +552,11 @@ void cm_set_model_target(float target[], float flag[])
 		}
 		if (cm.gm.distance_mode == ABSOLUTE_MODE) {
 			cm.gm.target[axis] = tmp + cm_get_active_coord_offset(axis); // sacidu93's fix to Issue #22
+			if (cm.a[axis].axis_mode == AXIS_MODULO) {	// shortest direction to the target angle
+				float delta = fmod(cm.gm.target[axis] - cm.gmx.position[axis], 360);
+				if (delta > 180) { delta -= 360; } else if (delta <= -180) { delta += 360; }
+				cm.gm.target[axis] = cm.gmx.position[axis] + delta;
+			}
 		} else {
 			cm.gm.target[axis] += tmp;
 		}
@@ -475,6 +578,7 @@ stat_t cm_test_soft_limits(float target[])
 	if (cm.soft_limit_enable == true) {
 		for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 			if (cm.homed[axis] != true) continue;		// don't test axes that are not homed
+			if (cm.a[axis].axis_mode == AXIS_MODULO) continue;	// modulo axes have no travel limits
 
 			if (fp_EQ(cm.a[axis].travel_min, cm.a[axis].travel_max)) continue;
 
@@ -526,6 +630,12 @@ void canonical_machine_init()
 	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);// always the default
 
 	cm.gmx.block_delete_switch = true;
+	cm.gmx.feed_rate_override_enable = true;	// overrides enabled and at 100% (M48)
+	cm.gmx.traverse_override_enable = true;
+	cm.gmx.spindle_override_enable = true;
+	cm.gmx.feed_rate_override_factor = 1.0;
+	cm.gmx.traverse_override_factor = 1.0;
+	cm.gmx.spindle_override_factor = 1.0;
 
 	// never start a machine in a motion mode
 	cm.gm.motion_mode = MOTION_MODE_CANCEL_MOTION_MODE;
@@ -534,6 +644,10 @@ void canonical_machine_init()
 	cm.feedhold_requested = false;
 	cm.queue_flush_requested = false;
 	cm.cycle_start_requested = false;
+	cm.rt_head = 0;
+	cm.rt_tail = 0;
+	cm.door_state = DOOR_CLOSED;
+	cm.door_resume_requested = false;
 
 	// signal that the machine is ready for action
 	cm.machine_state = MACHINE_READY;
@@ -542,6 +656,7 @@ void canonical_machine_init()
 	// sub-system inits
 	cm_spindle_init();
 	cm_arc_init();
+	cm_comp_init();
 }
 
 /*
@@ -666,6 +781,32 @@ stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[])
 	return (STAT_OK);
 }
 
+/*
+ * cm_set_tool_table() - G10 L1 Pn (affects MODEL only)
+ *
+ *	Sets the tool length from the Z word and the tool diameter from the R word (radius).
+ *	Like G10 L2 the values are persisted once the machining cycle is over. Tool table
+ *	entries can also be set directly using the $tt1l - $tt4w config tokens.
+ *
+ *	The active tool length offset is not changed. Issue G43 to apply a new length.
+ */
+
+stat_t cm_set_tool_table(uint8_t tool, float offset[], float flag[], float radius, uint8_t radius_flag)
+{
+	if ((tool < 1) || (tool > TOOLS)) {								// you can't set T0
+		return (STAT_P_WORD_IS_NOT_VALID_TOOL_NUMBER);
+	}
+	if (fp_TRUE(flag[AXIS_Z])) {
+		cm.tt[tool].length = _to_millimeters(offset[AXIS_Z]);
+		cm.deferred_write_flag = true;
+	}
+	if (radius_flag == true) {
+		cm.tt[tool].diameter = _to_millimeters(radius) * 2;
+		cm.deferred_write_flag = true;
+	}
+	return (STAT_OK);
+}
+
 /******************************************************************************************
  * Representation functions that affect gcode model and are queued to planner (synchronous)
  */
@@ -689,10 +830,34 @@ static void _exec_offset(float *value, float *flag)
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		offsets[axis] = cm.offset[coord_system][axis] + (cm.gmx.origin_offset[axis] * cm.gmx.origin_offset_enable);
 	}
+	offsets[AXIS_Z] += cm.gmx.tool_length_offset;
 	mp_set_runtime_work_offset(offsets);
 	cm_set_work_offsets(MODEL);								// set work offsets in the Gcode model
 }
 
+/*
+ * cm_set_tool_length_offset() - G43, G49
+ *
+ *	G43 applies the length + wear of the tool table entry as an offset to the Z axis.
+ *	The tool is taken from the H word, or the current tool if H is not provided.
+ *	G49 cancels the offset. The offset is applied to the runtime using _exec_offset().
+ */
+stat_t cm_set_tool_length_offset(uint8_t mode, uint8_t tool)
+{
+	if (tool > TOOLS) {
+		return (STAT_H_WORD_IS_INVALID);
+	}
+	cm.gmx.tool_length_mode = mode;
+	if (mode == true) {
+		cm.gmx.tool_length_offset = cm.tt[tool].length + cm.tt[tool].wear;
+	} else {
+		cm.gmx.tool_length_offset = 0;
+	}
+	float value[AXES] = { (float)cm.gm.coord_system,0,0,0,0,0 };
+	mp_queue_command(_exec_offset, value, value);
+	return (STAT_OK);
+}
+
 /*
  * cm_set_position() - set the position of a single axis in the model, planner and runtime
  *
@@ -780,6 +945,9 @@ stat_t cm_set_origin_offsets(float offset[], float flag[])
 		if (fp_TRUE(flag[axis])) {
 			cm.gmx.origin_offset[axis] = cm.gmx.position[axis] -
 									  cm.offset[cm.gm.coord_system][axis] - _to_millimeters(offset[axis]);
+			if (axis == AXIS_Z) {
+				cm.gmx.origin_offset[axis] -= cm.gmx.tool_length_offset;
+			}
 		}
 	}
 	// now pass the offset to the callback - setting the coordinate system also applies the offsets
@@ -820,6 +988,9 @@ stat_t cm_resume_origin_offsets()
  *****************************/
 /*
  * cm_straight_traverse() - G0 linear rapid
+ *
+ *	Planned as a coordinated straight line unless cm.traverse_mode selects
+ *	a dogleg. Dogleg traverses are not run through cutter compensation.
  */
 
 stat_t cm_straight_traverse(float target[], float flags[])
@@ -834,11 +1005,185 @@ stat_t cm_straight_traverse(float target[], float flags[])
 	// prep and plan the move
 	cm_set_work_offsets(&cm.gm);				// capture the fully resolved offsets to the state
 	cm_cycle_start();							// required for homing & other cycles
-	mp_aline(&cm.gm);							// send the move to the planner
+	if ((cm.traverse_mode != TRAVERSE_COORDINATED) && (cm_comp_engaged() == false)) {
+		status = _dogleg_traverse();			// send the move to the planner as independent axis moves
+	} else {
+		status = cm_comp_aline(&cm.gm);			// send the move to the planner via cutter compensation
+	}
 	cm_finalize_move();
+	return (status);
+}
+
+/*
+ * _dogleg_traverse() - plan G0 with each axis moving at its own velocity_max
+ * cm_dogleg_callback() - issue queued dogleg segments from the main loop
+ * cm_dogleg_busy()	- true if dogleg segments are still to be issued
+ * cm_abort_dogleg() - drop queued dogleg traverses
+ *
+ *	Axes with less time to travel finish first, so the path bends where each
+ *	axis completes. The move is split at those completion times into segments
+ *	that are queued back-to-back. The planner joins them into one continuous
+ *	move with a single completion, and applies per-axis jerk to each segment.
+ *	Breakpoints are located at constant velocity. Bends closer together than
+ *	MIN_SEGMENT_TIME are merged into the following segment.
+ *
+ *	TRAVERSE_DOGLEG_SAFE_Z lifts Z to traverse_safe_z before any other axis
+ *	moves, traverses at that height (or higher), then lowers Z to the target.
+ *	Moves that only involve Z are run as a plain dogleg.
+ *
+ *	A traverse can need more planner buffers than are free, so segments are issued
+ *	like arc segments: as many as fit when the traverse is queued, the rest from
+ *	cm_dogleg_callback(), which returns EAGAIN (holding off command dispatch) until
+ *	the last one is in the planner. Soft limits are tested when the traverse is queued.
+ */
+
+static stat_t _dogleg_traverse(void)
+{
+	float leg_end[DOGLEG_LEGS][AXES];
+	uint8_t leg_count = _dogleg_legs(cm.gmx.position, cm.gm.target, leg_end);
+
+	for (uint8_t leg=0; leg<leg_count-1; leg++) {		// the final target is tested by the caller
+		ritorno(cm_test_soft_limits(leg_end[leg]));
+	}
+	if (dog.count >= DOGLEG_QUEUE_SIZE) {
+		return (STAT_BUFFER_FULL);
+	}
+	if (dog.count == 0) {
+		dog.rd = 0;
+		dog.leg_count = 0;
+		copy_vector(dog.start, cm.gmx.position);
+	}
+	memcpy(&dog.gm[(dog.rd + dog.count) % DOGLEG_QUEUE_SIZE], &cm.gm, sizeof(GCodeState_t));
+	dog.count++;
+
+	stat_t status = _dogleg_run();
+	return ((status == STAT_EAGAIN) ? STAT_OK : status);
+}
+
+/*
+ * _dogleg_legs() - split a traverse into legs; returns the number of legs
+ */
+
+static uint8_t _dogleg_legs(const float start[], const float end[], float leg_end[][AXES])
+{
+	uint8_t leg_count = 0;
+
+	if (cm.traverse_mode == TRAVERSE_DOGLEG_SAFE_Z) {
+		bool lateral = false;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if ((axis != AXIS_Z) && (fp_NE(start[axis], end[axis]))) lateral = true;
+		}
+		if (lateral) {
+			float travel_z = max(start[AXIS_Z], cm.traverse_safe_z);
+
+			memcpy(leg_end[leg_count], start, sizeof(float)*AXES);	// lift Z in place
+			leg_end[leg_count++][AXIS_Z] = travel_z;
+			memcpy(leg_end[leg_count], end, sizeof(float)*AXES);	// traverse at or above the safe height
+			leg_end[leg_count++][AXIS_Z] = max(end[AXIS_Z], travel_z);
+		}
+	}
+	memcpy(leg_end[leg_count++], end, sizeof(float)*AXES);			// drop Z onto the target
+	return (leg_count);
+}
+
+/*
+ * _dogleg_start_leg() - set up the axis times for the next leg from the current start
+ */
+
+static void _dogleg_start_leg(void)
+{
+	float *end = dog.leg_end[dog.leg];
+
+	dog.t_final = 0;
+	dog.t_prev = 0;
+	dog.t_scan = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		dog.time[axis] = 0;
+		if (cm.a[axis].velocity_max > 0) {
+			dog.time[axis] = fabs(end[axis] - dog.start[axis]) / cm.a[axis].velocity_max;
+		}
+		dog.t_final = max(dog.t_final, dog.time[axis]);
+	}
+}
+
+/*
+ * _dogleg_run() - issue segments until done (STAT_OK) or out of buffers (STAT_EAGAIN)
+ */
+
+static stat_t _dogleg_run(void)
+{
+	GCodeState_t gm;
+	stat_t status;
+
+	while (dog.count > 0) {
+		if (dog.leg_count == 0) {						// start the next traverse
+			dog.leg_count = _dogleg_legs(dog.start, dog.gm[dog.rd].target, dog.leg_end);
+			dog.leg = 0;
+			_dogleg_start_leg();
+		}
+		float *end = dog.leg_end[dog.leg];
+		float t_next = 0;
+		for (uint8_t axis=0; axis<AXES; axis++) {		// find the next axis to finish
+			if ((dog.time[axis] > dog.t_scan) && ((t_next == 0) || (dog.time[axis] < t_next))) {
+				t_next = dog.time[axis];
+			}
+		}
+		if (t_next == 0) {								// all axes in this leg have been planned
+			copy_vector(dog.start, end);
+			if (++dog.leg < dog.leg_count) {
+				_dogleg_start_leg();
+				continue;
+			}
+			dog.leg_count = 0;							// traverse done - move to the next one
+			dog.rd = (dog.rd + 1) % DOGLEG_QUEUE_SIZE;
+			dog.count--;
+			continue;
+		}
+		if ((t_next < dog.t_final) && ((t_next - dog.t_prev) < MIN_SEGMENT_TIME)) {
+			dog.t_scan = t_next;
+			continue;
+		}
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+			return (STAT_EAGAIN);						// pick up from here in the callback
+		}
+		dog.t_scan = t_next;
+		memcpy(&gm, &dog.gm[dog.rd], sizeof(GCodeState_t));
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (dog.time[axis] <= t_next) {
+				gm.target[axis] = end[axis];
+			} else {
+				gm.target[axis] = dog.start[axis] + copysign(t_next * cm.a[axis].velocity_max, end[axis] - dog.start[axis]);
+			}
+		}
+		if (((status = mp_aline(&gm)) != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) return (status);
+		dog.t_prev = t_next;
+	}
 	return (STAT_OK);
 }
 
+stat_t cm_dogleg_callback(void)
+{
+	if (dog.count == 0) {
+		return (STAT_NOOP);
+	}
+	stat_t status = _dogleg_run();
+	if (status == STAT_EAGAIN) {
+		return (STAT_EAGAIN);
+	}
+	if (status != STAT_OK) {
+		cm_abort_dogleg();
+		return (cm_soft_alarm(status));
+	}
+	return (STAT_OK);
+}
+
+bool cm_dogleg_busy(void) { return (dog.count > 0);}
+
+void cm_abort_dogleg(void)
+{
+	dog.count = 0;
+}
+
 /*
  * cm_set_g28_position()  - G28.1
  * cm_goto_g28_position() - G28
@@ -955,11 +1300,41 @@ stat_t cm_straight_feed(float target[], float flags[])
 	// prep and plan the move
 	cm_set_work_offsets(&cm.gm);				// capture the fully resolved offsets to the state
 	cm_cycle_start();							// required for homing & other cycles
-	status = mp_aline(&cm.gm);					// send the move to the planner
+	status = cm_comp_aline(&cm.gm);				// send the move to the planner via cutter compensation
 	cm_finalize_move();
 	return (status);
 }
 
+/*
+ * cm_preplanned_line() - queue a line with host-planned velocities
+ *
+ *	Travel is relative, per axis, in mm (degrees for rotary axes). Velocities are in mm/min.
+ *	The move bypasses cutter compensation and look-ahead and is validated by mp_aline_preplanned().
+ */
+stat_t cm_preplanned_line(const float travel[], const float entry, const float cruise, const float exit)
+{
+	if (cm_comp_engaged() || cm_comp_busy()) {
+		return (STAT_CUTTER_COMPENSATION_NOT_ALLOWED);
+	}
+	if (ss_get_mode() == true) return (STAT_COMMAND_NOT_ACCEPTED);
+	cm.gm.motion_mode = MOTION_MODE_STRAIGHT_FEED;
+	for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+		cm.gm.target[axis] = cm.gmx.position[axis] + travel[axis];
+	}
+
+	// test soft limits
+	stat_t status = cm_test_soft_limits(cm.gm.target);
+	if (status != STAT_OK) return (cm_soft_alarm(status));
+
+	// prep and plan the move
+	cm_set_work_offsets(&cm.gm);
+	cm_cycle_start();
+	if ((status = mp_aline_preplanned(&cm.gm, entry, cruise, exit)) == STAT_OK) {
+		cm_finalize_move();
+	}
+	return (status);
+}
+
 /*****************************
  * Spindle Functions (4.3.7) *
  *****************************/
@@ -972,14 +1347,18 @@ stat_t cm_straight_feed(float target[], float flags[])
  * cm_select_tool()		- T parameter
  * _exec_select_tool()	- execution callback
  *
- * cm_change_tool()		- M6 (This might become a complete tool change cycle)
+ * cm_change_tool()		- M6
  * _exec_change_tool()	- execution callback
  *
- * Note: These functions don't actually do anything for now, and there's a bug
- *		 where T and M in different blocks don;t work correctly
+ *	T and M6 set the model immediately so T and M6 can be in different blocks. The queued
+ *	callbacks carry the change to the runtime model in sync with motion.
+ *
+ *	If a tool change mode is configured ($tcm) M6 runs the tool change cycle instead.
+ *	See cycle_toolchange.c
  */
 stat_t cm_select_tool(uint8_t tool_select)
 {
+	cm.gm.tool_select = tool_select;
 	float value[AXES] = { (float)tool_select,0,0,0,0,0 };
 	mp_queue_command(_exec_select_tool, value, value);
 	return (STAT_OK);
@@ -987,11 +1366,15 @@ stat_t cm_select_tool(uint8_t tool_select)
 
 static void _exec_select_tool(float *value, float *flag)
 {
-	cm.gm.tool_select = (uint8_t)value[0];
+	mr.gm.tool_select = (uint8_t)value[0];
 }
 
 stat_t cm_change_tool(uint8_t tool_change)
 {
+	if (cm.tool_change_mode != TOOL_CHANGE_OFF) {
+		return (cm_tool_change_cycle_start(cm.gm.tool_select));
+	}
+	cm.gm.tool = cm.gm.tool_select;
 	float value[AXES] = { (float)cm.gm.tool_select,0,0,0,0,0 };
 	mp_queue_command(_exec_change_tool, value, value);
 	return (STAT_OK);
@@ -999,7 +1382,7 @@ stat_t cm_change_tool(uint8_t tool_change)
 
 static void _exec_change_tool(float *value, float *flag)
 {
-	cm.gm.tool = (uint8_t)value[0];
+	mr.gm.tool = (uint8_t)value[0];
 }
 
 /***********************************
@@ -1208,6 +1591,140 @@ void cm_request_feedhold(void) { cm.feedhold_requested = true; }
 void cm_request_queue_flush(void) { cm.queue_flush_requested = true; }
 void cm_request_cycle_start(void) { cm.cycle_start_requested = true; }
 
+/*
+ * cm_request_realtime() - queue an extended realtime byte (called from the RX ISR)
+ * cm_realtime_callback() - act on queued realtime bytes and run the safety door sequence
+ *
+ *	The ISR only enqueues the byte; the controller pass does the work. The queue is
+ *	single producer (ISR) / single consumer (main loop) so no locking is needed.
+ *	Bytes arriving while the queue is full are dropped.
+ *
+ *	Feed and traverse overrides scale the move times of blocks as they are planned
+ *	(see _calc_move_times()). The callback also hands the current factors (including
+ *	M48-M50.3 changes) to the runtime on every pass, which slows blocks already queued
+ *	or running if the override drops (see _exec_override()). Increases apply to moves
+ *	planned after the change. Spindle override is applied to the spindle PWM immediately.
+ *
+ *	Safety door: opening the door requests a feedhold. Once motion has stopped the
+ *	spindle and coolant are turned off and their state is saved. Cycle start requests
+ *	are held while the door is open. On resume the spindle and coolant are restored,
+ *	and if the spindle was running the cycle start is delayed SAFETY_DOOR_SPINUP_MS.
+ */
+
+void cm_request_realtime(uint8_t c)
+{
+	uint8_t next = (cm.rt_head + 1) & (RT_QUEUE_SIZE-1);
+	if (next == cm.rt_tail) return;			// queue full - drop the byte
+	cm.rt_queue[cm.rt_head] = c;
+	cm.rt_head = next;
+}
+
+static void _adjust_override(float *factor, float delta, float lo, float hi)
+{
+	*factor = min(hi, max(lo, *factor + delta));
+}
+
+static void _exec_realtime(uint8_t c)
+{
+	switch (c) {
+		case CHAR_STATUS_REPORT: { sr_request_status_report(SR_IMMEDIATE_REQUEST); return; }
+		case CHAR_SAFETY_DOOR: {
+			if (cm.door_state == DOOR_CLOSED) {
+				cm.door_state = DOOR_OPENED;
+				cm.door_resume_requested = false;
+				cm_request_feedhold();
+				sr_request_status_report(SR_IMMEDIATE_REQUEST);
+			}
+			return;
+		}
+		case CHAR_JOG_CANCEL: {
+			if (cm.cycle_state == CYCLE_JOG) {
+				cm_request_feedhold();
+				cm_request_queue_flush();
+			}
+			return;
+		}
+		case CHAR_FEED_OVR_RESET: { cm.gmx.feed_rate_override_factor = 1.0; break; }
+		case CHAR_FEED_OVR_COARSE_PLUS: { _adjust_override(&cm.gmx.feed_rate_override_factor, 0.10, FEED_OVERRIDE_MIN, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_COARSE_MINUS: { _adjust_override(&cm.gmx.feed_rate_override_factor, -0.10, FEED_OVERRIDE_MIN, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_FINE_PLUS: { _adjust_override(&cm.gmx.feed_rate_override_factor, 0.01, FEED_OVERRIDE_MIN, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_FINE_MINUS: { _adjust_override(&cm.gmx.feed_rate_override_factor, -0.01, FEED_OVERRIDE_MIN, FEED_OVERRIDE_MAX); break; }
+		case CHAR_TRAVERSE_OVR_RESET: { cm.gmx.traverse_override_factor = 1.0; break; }
+		case CHAR_TRAVERSE_OVR_MEDIUM: { cm.gmx.traverse_override_factor = 0.50; break; }
+		case CHAR_TRAVERSE_OVR_LOW: { cm.gmx.traverse_override_factor = 0.25; break; }
+		case CHAR_SPINDLE_OVR_RESET: { cm.gmx.spindle_override_factor = 1.0; cm_exec_spindle_override(); break; }
+		case CHAR_SPINDLE_OVR_COARSE_PLUS: { _adjust_override(&cm.gmx.spindle_override_factor, 0.10, SPINDLE_OVERRIDE_MIN, SPINDLE_OVERRIDE_MAX); cm_exec_spindle_override(); break; }
+		case CHAR_SPINDLE_OVR_COARSE_MINUS: { _adjust_override(&cm.gmx.spindle_override_factor, -0.10, SPINDLE_OVERRIDE_MIN, SPINDLE_OVERRIDE_MAX); cm_exec_spindle_override(); break; }
+		case CHAR_SPINDLE_OVR_FINE_PLUS: { _adjust_override(&cm.gmx.spindle_override_factor, 0.01, SPINDLE_OVERRIDE_MIN, SPINDLE_OVERRIDE_MAX); cm_exec_spindle_override(); break; }
+		case CHAR_SPINDLE_OVR_FINE_MINUS: { _adjust_override(&cm.gmx.spindle_override_factor, -0.01, SPINDLE_OVERRIDE_MIN, SPINDLE_OVERRIDE_MAX); cm_exec_spindle_override(); break; }
+		default: return;						// unassigned extended bytes are ignored
+	}
+	sr_request_status_report(SR_TIMED_REQUEST);	// report the new override values
+}
+
+static void _exec_safety_door(void)
+{
+	if (cm.cycle_start_requested == true) {		// hold off cycle starts while the door is open
+		cm.cycle_start_requested = false;
+		cm.door_resume_requested = true;
+	}
+	if (cm.door_state == DOOR_OPENED) {
+		if ((cm.motion_state == MOTION_STOP) ||
+			((cm.motion_state == MOTION_HOLD) && (cm.hold_state == FEEDHOLD_HOLD))) {
+			cm.door_spindle_mode = cm.gm.spindle_mode;
+			cm.door_mist_coolant = cm.gm.mist_coolant;
+			cm.door_flood_coolant = cm.gm.flood_coolant;
+			float value[AXES] = { 0,0,0,0,0,0 };
+			cm_exec_spindle_control(SPINDLE_OFF);
+			_exec_flood_coolant_control(value, value);	// also turns off mist
+			cm.door_state = DOOR_STOPPED;
+			sr_request_status_report(SR_IMMEDIATE_REQUEST);
+		}
+		return;
+	}
+	if (cm.door_state == DOOR_STOPPED) {
+		if (cm.door_resume_requested == false)
+			return;
+		cm.door_resume_requested = false;
+		float value[AXES] = { 0,0,0,0,0,0 };
+		value[0] = (float)cm.door_flood_coolant;
+		_exec_flood_coolant_control(value, value);
+		value[0] = (float)cm.door_mist_coolant;
+		_exec_mist_coolant_control(value, value);
+		cm_exec_spindle_control(cm.door_spindle_mode);
+		cm.door_resume_tick = SysTickTimer_getValue();
+		if (cm.door_spindle_mode != SPINDLE_OFF)
+			cm.door_resume_tick += SAFETY_DOOR_SPINUP_MS;
+		cm.door_state = DOOR_RESUMING;
+		sr_request_status_report(SR_IMMEDIATE_REQUEST);
+		return;
+	}
+	// DOOR_RESUMING
+	if ((int32_t)(SysTickTimer_getValue() - cm.door_resume_tick) < 0)
+		return;
+	cm.door_state = DOOR_CLOSED;
+	cm.cycle_start_requested = true;			// release the hold
+	sr_request_status_report(SR_IMMEDIATE_REQUEST);
+}
+
+stat_t cm_realtime_callback()
+{
+	while (cm.rt_tail != cm.rt_head) {
+		_exec_realtime(cm.rt_queue[cm.rt_tail]);
+		cm.rt_tail = (cm.rt_tail + 1) & (RT_QUEUE_SIZE-1);
+	}
+	float feed_factor = 1.0;
+	float traverse_factor = 1.0;
+	if ((cm.gmx.feed_rate_override_enable == true) && (cm.gmx.feed_rate_override_factor > 0))
+		feed_factor = cm.gmx.feed_rate_override_factor;
+	if ((cm.gmx.traverse_override_enable == true) && (cm.gmx.traverse_override_factor > 0))
+		traverse_factor = min(cm.gmx.traverse_override_factor, 1.0);
+	mp_set_runtime_override(feed_factor, traverse_factor);
+	if (cm.door_state != DOOR_CLOSED)
+		_exec_safety_door();
+	return (STAT_OK);
+}
+
 stat_t cm_feedhold_sequencing_callback()
 {
 	if (cm.feedhold_requested == true) {
@@ -1355,6 +1872,7 @@ void cm_optional_program_stop()
 
 void cm_program_end()
 {
+	cm_set_cutter_comp(CUTTER_COMP_OFF, 0);	// M2 and M30 cancel cutter compensation (G40)
 	float value[AXES] = { (float)MACHINE_PROGRAM_END, 0,0,0,0,0 };
 	mp_queue_command(_exec_program_finalize, value, value);
 }
@@ -1384,7 +1902,8 @@ static const char msg_am00[] PROGMEM = "[disabled]";
 static const char msg_am01[] PROGMEM = "[standard]";
 static const char msg_am02[] PROGMEM = "[inhibited]";
 static const char msg_am03[] PROGMEM = "[radius]";
-static const char *const msg_am[] PROGMEM = { msg_am00, msg_am01, msg_am02, msg_am03};
+static const char msg_am04[] PROGMEM = "[modulo]";
+static const char *const msg_am[] PROGMEM = { msg_am00, msg_am01, msg_am02, msg_am03, msg_am04};
 
 static const char msg_g20[] PROGMEM = "G20 - inches mode";
 static const char msg_g21[] PROGMEM = "G21 - millimeter mode";
@@ -1421,7 +1940,8 @@ static const char msg_cycs1[] PROGMEM = "Machining";
 static const char msg_cycs2[] PROGMEM = "Probe";
 static const char msg_cycs3[] PROGMEM = "Homing";
 static const char msg_cycs4[] PROGMEM = "Jog";
-static const char *const msg_cycs[] PROGMEM = { msg_cycs0, msg_cycs1, msg_cycs2, msg_cycs3,  msg_cycs4 };
+static const char msg_cycs5[] PROGMEM = "Tool change";
+static const char *const msg_cycs[] PROGMEM = { msg_cycs0, msg_cycs1, msg_cycs2, msg_cycs3,  msg_cycs4, msg_cycs5 };
 
 static const char msg_mots0[] PROGMEM = "Stop";
 static const char msg_mots1[] PROGMEM = "Run";
@@ -1558,6 +2078,7 @@ static int8_t _get_axis_type(const index_t index)
  * cm_get_ofs()  - get current work offset (runtime)
  * cm_get_pos()  - get current work position (runtime)
  * cm_get_mpos() - get current machine position (runtime)
+ * cm_get_epo()  - get actual machine position (from the steppers)
  *
  * cm_print_pos()- print work position (with proper units)
  * cm_print_mpos()- print machine position (always mm units)
@@ -1646,6 +2167,21 @@ stat_t cm_get_mpo(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t cm_get_trn(nvObj_t *nv)
+{
+	nv->value = mp_get_runtime_turns(_get_axis(nv->index));
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t cm_get_epo(nvObj_t *nv)
+{
+	nv->value = cm_get_actual_position(_get_axis(nv->index));
+	nv->precision = GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
 stat_t cm_get_ofs(nvObj_t *nv)
 {
 	nv->value = cm_get_work_offset(ACTIVE_MODEL, _get_axis(nv->index));
@@ -1685,6 +2221,7 @@ stat_t cm_set_am(nvObj_t *nv)		// axis mode
  *
  * cm_set_xjm()		  - set jerk max value
  * cm_set_xjh()		  - set jerk halt value (used by homing and other stops)
+ * cm_set_xjr()		  - set jerk traverse value (used by G0 moves, 0 uses jerk max)
  *
  *	Jerk values can be rather large, often in the billions. This makes for some pretty big
  *	numbers for people to deal with. Jerk values are stored in the system in truncated format;
@@ -1722,6 +2259,17 @@ stat_t cm_set_xjh(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+stat_t cm_set_xjr(nvObj_t *nv)
+{
+	if (nv->value > JERK_MULTIPLIER) nv->value /= JERK_MULTIPLIER;
+	set_flu(nv);
+	uint8_t axis = _get_axis(nv->index);
+	if (cm.a[axis].jerk_traverse > 0) {
+		cm.a[axis].recip_jerk_traverse = 1/(cm.a[axis].jerk_traverse * JERK_MULTIPLIER);
+	}
+	return(STAT_OK);
+}
+
 /*
  * Commands
  *
@@ -1808,6 +2356,67 @@ stat_t cm_run_joga(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+/***********************************************************************************
+ * POSITION-SYNCHRONIZED OUTPUT
+ ***********************************************************************************/
+/*
+ * cm_get_psi() - get the PSO pulse spacing in effect at the runtime (mm along the path)
+ * cm_run_psi() - queue a new PSO pulse spacing: {"psi":0.5}. 0 stops the pulses
+ *
+ *	The change is queued so it takes effect in sync with the moves around it.
+ *	The output is selected by $pso.
+ */
+
+static void _exec_pso_interval(float *value, float *flag)
+{
+	mp_set_pso_interval(value[0]);
+}
+
+stat_t cm_get_psi(nvObj_t *nv)
+{
+	nv->value = mr.pso_interval;
+	nv->valuetype = TYPE_FLOAT;
+	nv->precision = GET_TABLE_WORD(precision);
+	return (STAT_OK);
+}
+
+stat_t cm_run_psi(nvObj_t *nv)
+{
+	if (nv->value < 0) return (STAT_INPUT_VALUE_RANGE_ERROR);
+
+	float value[AXES] = { nv->value, 0,0,0,0,0 };
+	mp_queue_command(_exec_pso_interval, value, value);
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * HOST-PLANNED LINES
+ ***********************************************************************************/
+/*
+ * cm_run_ppl() - queue a host-planned line: {"ppl":"x,y,z,a,b,c,entry,cruise,exit"}
+ *
+ *	All nine values are required, comma separated. See cm_preplanned_line().
+ */
+stat_t cm_run_ppl(nvObj_t *nv)
+{
+	float value[AXES+3];
+	char_t *rd;
+	char_t *end;
+
+	if (nv->valuetype != TYPE_STRING) return (STAT_UNSUPPORTED_TYPE);
+	rd = *nv->stringp;
+	for (uint8_t i=0; i<AXES+3; i++) {
+		value[i] = strtod(rd, &end);
+		if (end == rd) return (STAT_BAD_NUMBER_FORMAT);
+		rd = end;
+		if (i < AXES+2) {
+			if (*rd++ != ',') return (STAT_BAD_NUMBER_FORMAT);
+		}
+	}
+	if (*rd != NUL) return (STAT_BAD_NUMBER_FORMAT);
+	return (cm_preplanned_line(value, value[AXES], value[AXES+1], value[AXES+2]));
+}
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -1837,8 +2446,10 @@ const char fmt_tool[] PROGMEM = "Tool number          %d\n";
 
 const char fmt_pos[] PROGMEM = "%c position:%15.3f%s\n";
 const char fmt_mpo[] PROGMEM = "%c machine posn:%11.3f%s\n";
+const char fmt_epo[] PROGMEM = "%c actual posn:%12.3f%s\n";
 const char fmt_ofs[] PROGMEM = "%c work offset:%12.3f%s\n";
 const char fmt_hom[] PROGMEM = "%c axis homing state:%2.0f\n";
+const char fmt_trn[] PROGMEM = "%c modulo turns:%12.0f\n";
 
 const char fmt_gpl[] PROGMEM = "[gpl] default gcode plane%10d [0=G17,1=G18,2=G19]\n";
 const char fmt_gun[] PROGMEM = "[gun] default gcode units mode%5d [0=G20,1=G21]\n";
@@ -1874,14 +2485,22 @@ void cm_print_gdi(nvObj_t *nv) { text_print_int(nv, fmt_gdi);}
 
 const char fmt_ja[] PROGMEM = "[ja]  junction acceleration%8.0f%s\n";
 const char fmt_ct[] PROGMEM = "[ct]  chordal tolerance%17.4f%s\n";
+const char fmt_spt[] PROGMEM = "[spt] arc spiral tolerance%14.4f%s\n";
 const char fmt_sl[] PROGMEM = "[sl]  soft limit enable%12d\n";
+const char fmt_tvm[] PROGMEM = "[tvm] traverse mode%16d [0=coordinated,1=dogleg,2=dogleg+safe Z]\n";
+const char fmt_tsz[] PROGMEM = "[tsz] traverse safe Z%19.3f%s\n";
+const char fmt_pas[] PROGMEM = "[pas] pressure advance smoothing%8.4f sec\n";
 const char fmt_ml[] PROGMEM = "[ml]  min line segment%17.3f%s\n";
 const char fmt_ma[] PROGMEM = "[ma]  min arc segment%18.3f%s\n";
 const char fmt_ms[] PROGMEM = "[ms]  min segment time%13.0f uSec\n";
 
 void cm_print_ja(nvObj_t *nv) { text_print_flt_units(nv, fmt_ja, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ct(nvObj_t *nv) { text_print_flt_units(nv, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_spt(nvObj_t *nv) { text_print_flt_units(nv, fmt_spt, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_sl(nvObj_t *nv) { text_print_ui8(nv, fmt_sl);}
+void cm_print_tvm(nvObj_t *nv) { text_print_ui8(nv, fmt_tvm);}
+void cm_print_tsz(nvObj_t *nv) { text_print_flt_units(nv, fmt_tsz, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_pas(nvObj_t *nv) { text_print_flt(nv, fmt_pas);}
 void cm_print_ml(nvObj_t *nv) { text_print_flt_units(nv, fmt_ml, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ma(nvObj_t *nv) { text_print_flt_units(nv, fmt_ma, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ms(nvObj_t *nv) { text_print_flt_units(nv, fmt_ms, GET_UNITS(ACTIVE_MODEL));}
@@ -1901,7 +2520,10 @@ void cm_print_ms(nvObj_t *nv) { text_print_flt_units(nv, fmt_ms, GET_UNITS(ACTIV
  *	cm_print_jm()
  *	cm_print_jh()
  *	cm_print_jd()
+ *	cm_print_jr()
+ *	cm_print_dr()
  *	cm_print_ra()
+ *	cm_print_pa()
  *	cm_print_sn()
  *	cm_print_sx()
  *	cm_print_lv()
@@ -1910,6 +2532,7 @@ void cm_print_ms(nvObj_t *nv) { text_print_flt_units(nv, fmt_ms, GET_UNITS(ACTIV
  *
  *	cm_print_pos() - print position with unit displays for MM or Inches
  * 	cm_print_mpo() - print position with fixed unit display - always in Degrees or MM
+ * 	cm_print_epo() - print actual position with fixed unit display - always in Degrees or MM
  */
 
 static const char fmt_Xam[] PROGMEM = "[%s%s] %s axis mode%18d %s\n";
@@ -1920,7 +2543,10 @@ static const char fmt_Xtn[] PROGMEM = "[%s%s] %s travel minimum%17.3f%s\n";
 static const char fmt_Xjm[] PROGMEM = "[%s%s] %s jerk maximum%15.0f%s/min^3 * 1 million\n";
 static const char fmt_Xjh[] PROGMEM = "[%s%s] %s jerk homing%16.0f%s/min^3 * 1 million\n";
 static const char fmt_Xjd[] PROGMEM = "[%s%s] %s junction deviation%14.4f%s (larger is faster)\n";
+static const char fmt_Xjr[] PROGMEM = "[%s%s] %s jerk traverse%14.0f%s/min^3 * 1 million (0=use jm)\n";
+static const char fmt_Xdr[] PROGMEM = "[%s%s] %s traverse junction dev%10.4f%s (0=use jd)\n";
 static const char fmt_Xra[] PROGMEM = "[%s%s] %s radius value%20.4f%s\n";
+static const char fmt_Xpa[] PROGMEM = "[%s%s] %s pressure advance%16.4f sec (0=off)\n";
 static const char fmt_Xsn[] PROGMEM = "[%s%s] %s switch min%17d [0=off,1=homing,2=limit,3=limit+homing]\n";
 static const char fmt_Xsx[] PROGMEM = "[%s%s] %s switch max%17d [0=off,1=homing,2=limit,3=limit+homing]\n";
 static const char fmt_Xsv[] PROGMEM = "[%s%s] %s search velocity%12.0f%s/min\n";
@@ -1978,7 +2604,10 @@ void cm_print_tn(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xtn);}
 void cm_print_jm(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjm);}
 void cm_print_jh(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjh);}
 void cm_print_jd(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjd);}
+void cm_print_jr(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjr);}
+void cm_print_dr(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xdr);}
 void cm_print_ra(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xra);}
+void cm_print_pa(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xpa);}
 void cm_print_sn(nvObj_t *nv) { _print_axis_ui8(nv, fmt_Xsn);}
 void cm_print_sx(nvObj_t *nv) { _print_axis_ui8(nv, fmt_Xsx);}
 void cm_print_sv(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xsv);}
@@ -1989,8 +2618,42 @@ void cm_print_zb(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xzb);}
 void cm_print_cofs(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cofs);}
 void cm_print_cpos(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cpos);}
 
+/*
+ * tool table and tool change print functions
+ */
+
+static const char fmt_ttl[] PROGMEM = "[%s%s] %s length offset%20.3f%s\n";
+static const char fmt_ttd[] PROGMEM = "[%s%s] %s diameter%25.3f%s\n";
+static const char fmt_ttw[] PROGMEM = "[%s%s] %s length wear%22.3f%s\n";
+static const char fmt_tcm[] PROGMEM = "[%s%s] tool change mode%11d [0=off,1=manual,2=probe]\n";
+static const char fmt_tcp[] PROGMEM = "[%s%s] tool change position%14.3f%s\n";
+static const char fmt_tcs[] PROGMEM = "[%s%s] tool setter position%13.3f%s\n";
+static const char fmt_tcf[] PROGMEM = "[%s%s] tool setter feedrate%12.0f%s/min\n";
+static const char fmt_tcr[] PROGMEM = "[%s%s] tool setter reference%11.3f%s\n";
+
+static void _print_tool_flt(nvObj_t *nv, const char *format)
+{
+	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value, GET_UNITS(MODEL));
+}
+
+static void _print_tc_flt(nvObj_t *nv, const char *format)
+{
+	fprintf_P(stderr, format, nv->group, nv->token, nv->value, GET_UNITS(MODEL));
+}
+
+void cm_print_ttl(nvObj_t *nv) { _print_tool_flt(nv, fmt_ttl);}
+void cm_print_ttd(nvObj_t *nv) { _print_tool_flt(nv, fmt_ttd);}
+void cm_print_ttw(nvObj_t *nv) { _print_tool_flt(nv, fmt_ttw);}
+void cm_print_tcm(nvObj_t *nv) { fprintf_P(stderr, fmt_tcm, nv->group, nv->token, (uint8_t)nv->value);}
+void cm_print_tcp(nvObj_t *nv) { _print_tc_flt(nv, fmt_tcp);}
+void cm_print_tcs(nvObj_t *nv) { _print_tc_flt(nv, fmt_tcs);}
+void cm_print_tcf(nvObj_t *nv) { _print_tc_flt(nv, fmt_tcf);}
+void cm_print_tcr(nvObj_t *nv) { _print_tc_flt(nv, fmt_tcr);}
+
 void cm_print_pos(nvObj_t *nv) { _print_pos(nv, fmt_pos, cm_get_units_mode(MODEL));}
 void cm_print_mpo(nvObj_t *nv) { _print_pos(nv, fmt_mpo, MILLIMETERS);}
+void cm_print_trn(nvObj_t *nv) { _print_pos(nv, fmt_trn, MILLIMETERS);}
+void cm_print_epo(nvObj_t *nv) { _print_pos(nv, fmt_epo, MILLIMETERS);}
 void cm_print_ofs(nvObj_t *nv) { _print_pos(nv, fmt_ofs, MILLIMETERS);}
 
 #endif // __TEXT_MODE
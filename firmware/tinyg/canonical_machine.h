@@ -47,6 +47,14 @@ extern "C"{
 #define _to_millimeters(a) ((cm.gm.units_mode == INCHES) ? (a * MM_PER_INCH) : a)
 
 #define JOGGING_START_VELOCITY ((float)10.0)
+
+#define RT_QUEUE_SIZE 8						// extended realtime command queue - must be a power of 2
+#define SAFETY_DOOR_SPINUP_MS 4000			// spindle spin-up dwell when resuming from a safety door
+
+#define FEED_OVERRIDE_MIN ((float)0.10)		// realtime override clamps
+#define FEED_OVERRIDE_MAX ((float)2.00)
+#define SPINDLE_OVERRIDE_MIN ((float)0.10)
+#define SPINDLE_OVERRIDE_MAX ((float)2.00)
 #define DISABLE_SOFT_LIMIT (-1000000)
 
 /*****************************************************************************
@@ -131,9 +139,11 @@ typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by
 	float spindle_override_factor;		// 1.0000 x S spindle speed. Go up or down from there
 	uint8_t	spindle_override_enable;	// TRUE = override enabled
 
-// unimplemented gcode parameters
-//	float cutter_radius;				// D - cutter radius compensation (0 is off)
-//	float cutter_length;				// H - cutter length compensation (0 is off)
+	float tool_length_offset;			// G43 - active tool length offset applied to Z (0 if G49)
+	uint8_t tool_length_mode;			// G43/G49 - TRUE = tool length offset is active
+
+	float cutter_radius;				// G41/G42 - active cutter compensation radius from the D tool (mm)
+	uint8_t cutter_comp_mode;			// G40/G41/G42 - see cmCutterCompMode
 
 	uint16_t magic_end;
 
@@ -181,9 +191,10 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
 	float arc_radius;					// R - radius value in arc radius mode
 	float arc_offset[3];  				// IJK - used by arc commands
 
-// unimplemented gcode parameters
-//	float cutter_radius;				// D - cutter radius compensation (0 is off)
-//	float cutter_length;				// H - cutter length compensation (0 is off)
+	uint8_t tool_length_mode;			// G43/G49 - TRUE = apply tool length offset, FALSE = cancel
+	uint8_t h_word;						// H - tool table index for G43 (defaults to current tool)
+	uint8_t cutter_comp_mode;			// G40/G41/G42 - see cmCutterCompMode
+	uint8_t d_word;						// D - tool table index for G41/G42 (defaults to current tool)
 
 } GCodeInput_t;
 
@@ -201,6 +212,10 @@ typedef struct cmAxis {
 	float jerk_homing;					// homing jerk (Jh) in mm/min^3 divided by 1 million
 	float recip_jerk;					// stored reciprocal of current jerk value - has the million in it
 	float junction_dev;					// aka cornering delta
+	float jerk_traverse;				// G0 jerk (Jr) in mm/min^3 divided by 1 million. 0 uses jerk_max
+	float recip_jerk_traverse;			// stored reciprocal of traverse jerk value - has the million in it
+	float junction_dev_traverse;		// G0 cornering delta. 0 uses junction_dev
+	float pressure_advance;				// extruder lead in seconds of commanded velocity. 0 = off
 	float radius;						// radius in mm for rotary axis modes
 	float search_velocity;				// homing search velocity
 	float latch_velocity;				// homing latch velocity
@@ -208,6 +223,12 @@ typedef struct cmAxis {
 	float zero_backoff;					// backoff from switches for machine zero
 } cfgAxis_t;
 
+typedef struct cmTool {					// tool table entry
+	float length;						// tool length offset - applied to Z by G43
+	float diameter;						// tool diameter
+	float wear;							// length wear - added to the length offset
+} cfgTool_t;
+
 typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	magic_t magic_start;				// magic number to test memory integrity
 
@@ -216,7 +237,11 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	// system group settings
 	float junction_acceleration;		// centripetal acceleration max for cornering
 	float chordal_tolerance;			// arc chordal accuracy setting in mm
+	float arc_spiral_tolerance;			// max start/end radius difference run as a spiral (mm)
 	uint8_t soft_limit_enable;
+	uint8_t traverse_mode;				// G0 planning - see cmTraverseMode
+	float traverse_safe_z;				// Z machine position to lift to for TRAVERSE_DOGLEG_SAFE_Z
+	float advance_smoothing;			// pressure advance filter time constant in seconds
 
 	// hidden system settings
 	float min_segment_len;				// line drawing resolution in mm
@@ -236,6 +261,14 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	// settings for axes X,Y,Z,A B,C
 	cfgAxis_t a[AXES];
 
+	// tool table and tool change settings
+	cfgTool_t tt[TOOLS+1];				// persistent tool table. Tool 0 is "no tool" and is always zero
+	uint8_t tool_change_mode;			// M6 behavior - see cmToolChangeMode
+	float tool_change_position[3];		// XYZ machine position to park at for a tool change
+	float tool_setter_position[3];		// XY machine position of the tool setter and Z probe endpoint
+	float tool_setter_feed;				// feed rate to probe the tool setter
+	float tool_setter_reference;		// Z machine position of the setter trigger for a zero length tool
+
 	/**** Runtime variables (PRIVATE) ****/
 
 	uint8_t combined_state;				// stat: combination of states for display purposes
@@ -255,6 +288,15 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	uint8_t feedhold_requested;			// feedhold character has been received
 	uint8_t queue_flush_requested;		// queue flush character has been received
 	uint8_t cycle_start_requested;		// cycle start character has been received (flag to end feedhold)
+	volatile uint8_t rt_head;			// extended realtime command queue - written by RX ISR
+	volatile uint8_t rt_tail;			// read by cm_realtime_callback()
+	uint8_t rt_queue[RT_QUEUE_SIZE];
+	uint8_t door_state;					// safety door sub-state machine
+	uint8_t door_resume_requested;		// cycle start latched while the door is open
+	uint8_t door_spindle_mode;			// spindle and coolant state saved when the door opened
+	uint8_t door_mist_coolant;
+	uint8_t door_flood_coolant;
+	uint32_t door_resume_tick;			// SysTick when spin-up dwell ends
 	float jogging_dest;					// jogging direction as a relative move from current position
 	struct GCodeState *am;				// active Gcode model is maintained by state management
 
@@ -333,7 +375,8 @@ enum cmCycleState {
 	CYCLE_MACHINING,				// in normal machining cycle
 	CYCLE_PROBE,					// in probe cycle
 	CYCLE_HOMING,					// homing is treated as a specialized cycle
-	CYCLE_JOG						// jogging is treated as a specialized cycle
+	CYCLE_JOG,						// jogging is treated as a specialized cycle
+	CYCLE_TOOL_CHANGE				// M6 tool change sequence
 };
 
 enum cmMotionState {
@@ -351,6 +394,13 @@ enum cmFeedholdState {				// feedhold_state machine
 	FEEDHOLD_END_HOLD				// end hold (transient state to OFF)
 };
 
+enum cmSafetyDoorState {			// applies to cm.door_state
+	DOOR_CLOSED = 0,				// normal operation
+	DOOR_OPENED,					// door opened - waiting for motion to stop
+	DOOR_STOPPED,					// motion stopped, spindle and coolant off - waiting for resume
+	DOOR_RESUMING					// spindle and coolant restored - waiting for spin-up
+};
+
 enum cmHomingState {				// applies to cm.homing_state
 	HOMING_NOT_HOMED = 0,			// machine is not homed (0=false)
 	HOMING_HOMED = 1,				// machine is homed (1=true)
@@ -455,6 +505,12 @@ enum cmPathControlMode {			// G Modal Group 13
 	PATH_CONTINUOUS					// G64 and typically the default mode
 };
 
+enum cmTraverseMode {				// G0 planning (not a gcode modal group)
+	TRAVERSE_COORDINATED = 0,		// straight line, all axes arrive together
+	TRAVERSE_DOGLEG,				// each axis runs at its own velocity_max
+	TRAVERSE_DOGLEG_SAFE_Z			// dogleg with Z lifted to the safe height first
+};
+
 enum cmDistanceMode {
 	ABSOLUTE_MODE = 0,				// G90
 	INCREMENTAL_MODE				// G91
@@ -484,6 +540,18 @@ enum cmSpindleState {				// spindle state settings (See hardware.h for bit setti
 	SPINDLE_CCW
 };
 
+enum cmToolChangeMode {				// M6 tool change sequence (cm.tool_change_mode)
+	TOOL_CHANGE_OFF = 0,			// M6 only records the tool number
+	TOOL_CHANGE_MANUAL,				// park, wait for cycle start, resume
+	TOOL_CHANGE_PROBE				// park, wait for cycle start, measure on the tool setter, resume
+};
+
+enum cmCutterCompMode {				// G40/G41/G42 (cm.gmx.cutter_comp_mode)
+	CUTTER_COMP_OFF = 0,			// G40 - programmed path is the tool center path
+	CUTTER_COMP_LEFT,				// G41 - tool is offset to the left of the programmed path
+	CUTTER_COMP_RIGHT				// G42 - tool is offset to the right of the programmed path
+};
+
 enum cmCoolantState {				// mist and flood coolant states
 	COOLANT_OFF = 0,				// all coolant off
 	COOLANT_ON,						// request coolant on or indicates both coolants are on
@@ -500,10 +568,11 @@ enum cmAxisMode {					// axis modes (ordered: see _cm_get_feed_time())
 	AXIS_DISABLED = 0,				// kill axis
 	AXIS_STANDARD,					// axis in coordinated motion w/standard behaviors
 	AXIS_INHIBITED,					// axis is computed but not activated
-	AXIS_RADIUS						// rotary axis calibrated to circumference
+	AXIS_RADIUS,					// rotary axis calibrated to circumference
+	AXIS_MODULO						// rotary axis positioned modulo 360 degrees, shortest path
 };	// ordering must be preserved. See cm_set_move_times()
 #define AXIS_MODE_MAX_LINEAR AXIS_INHIBITED
-#define AXIS_MODE_MAX_ROTARY AXIS_RADIUS
+#define AXIS_MODE_MAX_ROTARY AXIS_MODULO
 
 /*****************************************************************************
  * FUNCTION PROTOTYPES
@@ -551,6 +620,7 @@ float cm_get_work_offset(GCodeState_t *gcode_state, uint8_t axis);
 void cm_set_work_offsets(GCodeState_t *gcode_state);
 float cm_get_absolute_position(GCodeState_t *gcode_state, uint8_t axis);
 float cm_get_work_position(GCodeState_t *gcode_state, uint8_t axis);
+float cm_get_actual_position(uint8_t axis);
 
 // Critical helpers
 void cm_update_model_position_from_runtime(void);
@@ -575,6 +645,9 @@ stat_t cm_select_plane(uint8_t plane);							// G17, G18, G19
 stat_t cm_set_units_mode(uint8_t mode);							// G20, G21
 stat_t cm_set_distance_mode(uint8_t mode);						// G90, G91
 stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[]); // G10 L2
+stat_t cm_set_tool_table(uint8_t tool, float offset[], float flag[], float radius, uint8_t radius_flag); // G10 L1
+stat_t cm_set_tool_length_offset(uint8_t mode, uint8_t tool);	// G43, G49
+stat_t cm_set_cutter_comp(uint8_t mode, uint8_t tool);			// G40, G41, G42 (see plan_comp.c)
 
 void cm_set_position(uint8_t axis, float position);				// set absolute position - single axis
 stat_t cm_set_absolute_origin(float origin[], float flag[]);	// G28.3
@@ -588,6 +661,9 @@ stat_t cm_resume_origin_offsets(void);				 			// G92.3
 
 // Free Space Motion (4.3.4)
 stat_t cm_straight_traverse(float target[], float flags[]);		// G0
+stat_t cm_dogleg_callback(void);								// G0 dogleg segments from the main loop
+bool cm_dogleg_busy(void);
+void cm_abort_dogleg(void);
 stat_t cm_set_g28_position(void);								// G28.1
 stat_t cm_goto_g28_position(float target[], float flags[]); 	// G28
 stat_t cm_set_g30_position(void);								// G30.1
@@ -600,6 +676,7 @@ stat_t cm_set_path_control(uint8_t mode);						// G61, G61.1, G64
 
 // Machining Functions (4.3.6)
 stat_t cm_straight_feed(float target[], float flags[]);		    // G1
+stat_t cm_preplanned_line(const float travel[], const float entry, const float cruise, const float exit);
 stat_t cm_arc_feed(	float target[], float flags[],              // G2, G3
 					float i, float j, float k,
 					float radius, uint8_t motion_mode);
@@ -630,6 +707,9 @@ void cm_message(char_t *message);								// msg to console (e.g. Gcode comments)
 void cm_request_feedhold(void);
 void cm_request_queue_flush(void);
 void cm_request_cycle_start(void);
+void cm_request_realtime(uint8_t c);							// extended realtime byte from the RX ISR
+
+stat_t cm_realtime_callback(void);								// process realtime overrides and safety door
 
 stat_t cm_feedhold_sequencing_callback(void);					// process feedhold, cycle start and queue flush requests
 stat_t cm_queue_flush(void);									// flush serial and planner queues with coordinate resets
@@ -657,6 +737,10 @@ stat_t cm_jogging_callback(void);								// jogging cycle main loop
 stat_t cm_jogging_cycle_start(uint8_t axis);					// {"jogx":-100.3}
 float cm_get_jogging_dest(void);
 
+// Tool change cycle
+stat_t cm_tool_change_cycle_start(uint8_t tool);				// M6 with tool change mode enabled
+stat_t cm_tool_change_callback(void);							// M6 main loop callback
+
 /*--- cfgArray interface functions ---*/
 
 char_t cm_get_axis_char(const int8_t axis);
@@ -683,6 +767,8 @@ stat_t cm_get_vel(nvObj_t *nv);			// get runtime velocity...
 stat_t cm_get_feed(nvObj_t *nv);
 stat_t cm_get_pos(nvObj_t *nv);			// get runtime work position...
 stat_t cm_get_mpo(nvObj_t *nv);			// get runtime machine position...
+stat_t cm_get_trn(nvObj_t *nv);			// get runtime modulo axis turns...
+stat_t cm_get_epo(nvObj_t *nv);			// get actual machine position (from steppers)...
 stat_t cm_get_ofs(nvObj_t *nv);			// get runtime work offset...
 
 stat_t cm_run_qf(nvObj_t *nv);			// run queue flush
@@ -695,10 +781,15 @@ stat_t cm_run_jogy(nvObj_t *nv);		// start jogging cycle for y
 stat_t cm_run_jogz(nvObj_t *nv);		// start jogging cycle for z
 stat_t cm_run_joga(nvObj_t *nv);		// start jogging cycle for a
 
+stat_t cm_run_ppl(nvObj_t *nv);			// queue a host-planned line
+stat_t cm_get_psi(nvObj_t *nv);			// get PSO pulse spacing
+stat_t cm_run_psi(nvObj_t *nv);			// queue PSO pulse spacing
+
 stat_t cm_get_am(nvObj_t *nv);			// get axis mode
 stat_t cm_set_am(nvObj_t *nv);			// set axis mode
 stat_t cm_set_xjm(nvObj_t *nv);			// set jerk max with 1,000,000 correction
 stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
+stat_t cm_set_xjr(nvObj_t *nv);			// set jerk traverse with 1,000,000 correction
 
 /*--- text_mode support functions ---*/
 
@@ -731,11 +822,17 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_lin(nvObj_t *nv);		// generic print for linear values
 	void cm_print_pos(nvObj_t *nv);		// print runtime work position in prevailing units
 	void cm_print_mpo(nvObj_t *nv);		// print runtime work position always in MM units
+	void cm_print_trn(nvObj_t *nv);		// print runtime modulo axis turns
+	void cm_print_epo(nvObj_t *nv);		// print actual machine position always in MM units
 	void cm_print_ofs(nvObj_t *nv);		// print runtime work offset always in MM units
 
 	void cm_print_ja(nvObj_t *nv);		// global CM settings
 	void cm_print_ct(nvObj_t *nv);
+	void cm_print_spt(nvObj_t *nv);
 	void cm_print_sl(nvObj_t *nv);
+	void cm_print_tvm(nvObj_t *nv);
+	void cm_print_tsz(nvObj_t *nv);
+	void cm_print_pas(nvObj_t *nv);
 	void cm_print_ml(nvObj_t *nv);
 	void cm_print_ma(nvObj_t *nv);
 	void cm_print_ms(nvObj_t *nv);
@@ -749,7 +846,10 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_jm(nvObj_t *nv);
 	void cm_print_jh(nvObj_t *nv);
 	void cm_print_jd(nvObj_t *nv);
+	void cm_print_jr(nvObj_t *nv);
+	void cm_print_dr(nvObj_t *nv);
 	void cm_print_ra(nvObj_t *nv);
+	void cm_print_pa(nvObj_t *nv);
 	void cm_print_sn(nvObj_t *nv);
 	void cm_print_sx(nvObj_t *nv);
 	void cm_print_sv(nvObj_t *nv);
@@ -759,6 +859,15 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_cofs(nvObj_t *nv);
 	void cm_print_cpos(nvObj_t *nv);
 
+	void cm_print_ttl(nvObj_t *nv);		// tool table print functions
+	void cm_print_ttd(nvObj_t *nv);
+	void cm_print_ttw(nvObj_t *nv);
+	void cm_print_tcm(nvObj_t *nv);		// tool change settings
+	void cm_print_tcp(nvObj_t *nv);
+	void cm_print_tcs(nvObj_t *nv);
+	void cm_print_tcf(nvObj_t *nv);
+	void cm_print_tcr(nvObj_t *nv);
+
 #else // __TEXT_MODE
 
 	#define cm_print_vel tx_print_stub		// model state reporting
@@ -788,11 +897,17 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_lin tx_print_stub		// generic print for linear values
 	#define cm_print_pos tx_print_stub		// print runtime work position in prevailing units
 	#define cm_print_mpo tx_print_stub		// print runtime work position always in MM uints
+	#define cm_print_trn tx_print_stub		// print runtime modulo axis turns
+	#define cm_print_epo tx_print_stub		// print actual machine position always in MM uints
 	#define cm_print_ofs tx_print_stub		// print runtime work offset always in MM uints
 
 	#define cm_print_ja tx_print_stub		// global CM settings
 	#define cm_print_ct tx_print_stub
+	#define cm_print_spt tx_print_stub
 	#define cm_print_sl tx_print_stub
+	#define cm_print_tvm tx_print_stub
+	#define cm_print_tsz tx_print_stub
+	#define cm_print_pas tx_print_stub
 	#define cm_print_ml tx_print_stub
 	#define cm_print_ma tx_print_stub
 	#define cm_print_ms tx_print_stub
@@ -806,7 +921,10 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_jm tx_print_stub
 	#define cm_print_jh tx_print_stub
 	#define cm_print_jd tx_print_stub
+	#define cm_print_jr tx_print_stub
+	#define cm_print_dr tx_print_stub
 	#define cm_print_ra tx_print_stub
+	#define cm_print_pa tx_print_stub
 	#define cm_print_sn tx_print_stub
 	#define cm_print_sx tx_print_stub
 	#define cm_print_sv tx_print_stub
@@ -816,6 +934,15 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_cofs tx_print_stub
 	#define cm_print_cpos tx_print_stub
 
+	#define cm_print_ttl tx_print_stub		// tool table print functions
+	#define cm_print_ttd tx_print_stub
+	#define cm_print_ttw tx_print_stub
+	#define cm_print_tcm tx_print_stub		// tool change settings
+	#define cm_print_tcp tx_print_stub
+	#define cm_print_tcs tx_print_stub
+	#define cm_print_tcf tx_print_stub
+	#define cm_print_tcr tx_print_stub
+
 #endif // __TEXT_MODE
 /*
 #ifdef __cplusplus
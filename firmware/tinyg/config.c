@@ -51,8 +51,10 @@ static void _set_defa(nvObj_t *nv);
  **** STRUCTURE ALLOCATIONS ********************************************************
  ***********************************************************************************/
 
-nvStr_t nvStr;
-nvList_t nvl;
+nvArena_t nva[NV_ARENA_COUNT];			// response and report nvObj arenas
+nvArena_t *nv_arena = &nva[NV_ARENA_RESPONSE];
+static char_t nv_response_string[NV_SHARED_STRING_LEN];
+static char_t nv_report_string[NV_REPORT_STRING_LEN];
 
 /***********************************************************************************
  **** CODE *************************************************************************
@@ -113,6 +115,12 @@ stat_t nv_persist(nvObj_t *nv)	// nv_persist() cannot be called from an interrup
  */
 void config_init()
 {
+	nva[NV_ARENA_RESPONSE].str.string = nv_response_string;	// bind string storage to the arenas
+	nva[NV_ARENA_RESPONSE].str.size = NV_SHARED_STRING_LEN;
+	nva[NV_ARENA_REPORT].str.string = nv_report_string;
+	nva[NV_ARENA_REPORT].str.size = NV_REPORT_STRING_LEN;
+	nv_select_arena(NV_ARENA_RESPONSE);
+
 	nvObj_t *nv = nv_reset_nv_list();
 	config_init_assertions();
 
@@ -187,17 +195,21 @@ void config_init_assertions()
 {
 	cfg.magic_start = MAGICNUM;
 	cfg.magic_end = MAGICNUM;
-	nvl.magic_start = MAGICNUM;
-	nvl.magic_end = MAGICNUM;
-	nvStr.magic_start = MAGICNUM;
-	nvStr.magic_end = MAGICNUM;
+	for (uint8_t i=0; i<NV_ARENA_COUNT; i++) {
+		nva[i].list.magic_start = MAGICNUM;
+		nva[i].list.magic_end = MAGICNUM;
+		nva[i].str.magic_start = MAGICNUM;
+		nva[i].str.magic_end = MAGICNUM;
+	}
 }
 
 stat_t config_test_assertions()
 {
 	if ((cfg.magic_start	!= MAGICNUM) || (cfg.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
-	if ((nvl.magic_start	!= MAGICNUM) || (nvl.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
-	if ((nvStr.magic_start	!= MAGICNUM) || (nvStr.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+	for (uint8_t i=0; i<NV_ARENA_COUNT; i++) {
+		if ((nva[i].list.magic_start != MAGICNUM) || (nva[i].list.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+		if ((nva[i].str.magic_start	 != MAGICNUM) || (nva[i].str.magic_end  != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+	}
 	if (global_string_buf[MESSAGE_LEN-1] != NUL) return (STAT_CONFIG_ASSERTION_FAILURE);
 	return (STAT_OK);
 }
@@ -467,6 +479,7 @@ uint8_t nv_get_type(nvObj_t *nv)
  * nv_get_nvObj()		- setup a nv object by providing the index
  * nv_reset_nv()		- quick clear for a new nv object
  * nv_reset_nv_list()	- clear entire header, body and footer for a new use
+ * nv_select_arena()	- make the response or report arena the active one
  * nv_copy_string()		- used to write a string to shared string storage and link it
  * nv_add_object()		- write contents of parameter to  first free object in the body
  * nv_add_integer()		- add an integer value to end of nv body (Note 1)
@@ -535,6 +548,13 @@ nvObj_t *nv_reset_nv(nvObj_t *nv)			// clear a single nvObj structure
 	return (nv);							// return pointer to nv as a convenience to callers
 }
 
+uint8_t nv_select_arena(uint8_t arena)		// returns the previously active arena
+{
+	uint8_t previous = (uint8_t)(nv_arena - nva);
+	nv_arena = &nva[arena];
+	return (previous);
+}
+
 nvObj_t *nv_reset_nv_list()					// clear the header and response body
 {
 	nvStr.wp = 0;							// reset the shared string
@@ -559,7 +579,7 @@ nvObj_t *nv_reset_nv_list()					// clear the header and response body
 
 stat_t nv_copy_string(nvObj_t *nv, const char_t *src)
 {
-	if ((nvStr.wp + strlen(src)) > NV_SHARED_STRING_LEN)
+	if ((nvStr.wp + strlen(src)) >= nvStr.size)	// leave room for the NUL
         return (STAT_BUFFER_FULL);
 
 	char_t *dst = &nvStr.string[nvStr.wp];
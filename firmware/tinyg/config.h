@@ -154,6 +154,15 @@ extern "C"{
  *	the output buffer (typ 256 bytes), So some number less than that is sufficient for shared strings.
  *	This is all mediated through nv_copy_string(), nv_copy_string_P(), and nv_reset_nv_list().
  */
+/*  --- nvObj arenas ---
+ *
+ *	There are two independent list + string arenas. The response arena is used for command
+ *	responses and everything that runs in the command path. The report arena is used by
+ *	asynchronous reports (status report callback) so a report can be built and printed without
+ *	clobbering a response list that is still in use. The active arena is selected with
+ *	nv_select_arena(). nvl, nvStr, nv_header and nv_body always refer to the active arena.
+ *	Callers that switch arenas must switch back to the response arena when they are done.
+ */
 /*  --- Setting nvObj indexes ---
  *
  *	It's the responsibility of the object creator to set the index. Downstream functions
@@ -181,7 +190,8 @@ typedef uint16_t index_t;				// use this if there are > 255 indexed objects
 #define NV_MESSAGE_LEN 128				// sufficient space to contain end-user messages
 
 										// pre-allocated defines (take RAM permanently)
-#define NV_SHARED_STRING_LEN 512		// shared string for string values
+#define NV_SHARED_STRING_LEN 512		// shared string for string values (response arena)
+#define NV_REPORT_STRING_LEN 128		// shared string for string values (report arena)
 #define NV_BODY_LEN 30					// body elements - allow for 1 parent + N children
 										// (each body element takes about 30 bytes of RAM)
 
@@ -255,12 +265,9 @@ enum valueType {						// value typing for config and JSON
 
 typedef struct nvString {				// shared string object
 	uint16_t magic_start;
-  #if (NV_SHARED_STRING_LEN < 256)
-	uint8_t wp;							// use this string array index value if string len < 256 bytes
-  #else
-	uint16_t wp;						// use this string array index value is string len > 255 bytes
-  #endif
-	char_t string[NV_SHARED_STRING_LEN];
+	uint16_t wp;						// string array write index
+	uint16_t size;						// size of the string storage bound to this arena
+	char_t *string;						// string storage (allocated per arena in config.c)
 	uint16_t magic_end;					// guard to detect string buffer underruns
 } nvStr_t;
 
@@ -286,6 +293,17 @@ typedef struct nvList {
 	uint16_t magic_end;
 } nvList_t;
 
+enum nvArenaSelect {
+	NV_ARENA_RESPONSE = 0,				// command responses (default)
+	NV_ARENA_REPORT,					// asynchronous reports
+	NV_ARENA_COUNT
+};
+
+typedef struct nvArena {				// one independent list + string pool
+	nvList_t list;
+	nvStr_t str;
+} nvArena_t;
+
 typedef struct cfgItem {
 	char_t group[GROUP_LEN+1];			// group prefix (with NUL termination)
 	char_t token[TOKEN_LEN+1];			// token - stripped of group prefix (w/NUL termination)
@@ -300,10 +318,13 @@ typedef struct cfgItem {
 
 /**** static allocation and definitions ****/
 
-extern nvStr_t nvStr;
-extern nvList_t nvl;
+extern nvArena_t nva[NV_ARENA_COUNT];
+extern nvArena_t *nv_arena;				// active arena
 extern const cfgItem_t cfgArray[];
 
+#define nvl (nv_arena->list)
+#define nvStr (nv_arena->str)
+
 //#define nv_header nv.list
 #define nv_header (&nvl.list[0])
 #define nv_body   (&nvl.list[1])
@@ -353,6 +374,7 @@ stat_t get_grp(nvObj_t *nv);				// get data for a group
 void nv_get_nvObj(nvObj_t *nv);
 nvObj_t *nv_reset_nv(nvObj_t *nv);
 nvObj_t *nv_reset_nv_list(void);
+uint8_t nv_select_arena(uint8_t arena);
 stat_t nv_copy_string(nvObj_t *nv, const char_t *src);
 nvObj_t *nv_add_object(const char_t *token);
 nvObj_t *nv_add_integer(const char_t *token, const uint32_t value);
@@ -35,6 +35,10 @@
 #include "settings.h"
 #include "planner.h"
 #include "stepper.h"
+#include "step_stream.h"
+#include "kinematics.h"
+#include "persistence.h"
+#include "fw_stage.h"
 #include "switch.h"
 #include "pwm.h"
 #include "report.h"
@@ -63,7 +67,7 @@ cfgParameters_t cfg; 				// application specific configuration parameters
 
 static stat_t _do_motors(nvObj_t *nv);		// print parameters for all motor groups
 static stat_t _do_axes(nvObj_t *nv);		// print parameters for all axis groups
-static stat_t _do_offsets(nvObj_t *nv);		// print offset parameters for G54-G59,G92, G28, G30
+static stat_t _do_offsets(nvObj_t *nv);		// print offset parameters for G54-G59,G92, G28, G30, tool table
 static stat_t _do_all(nvObj_t *nv);			// print all parameters
 
 // communications settings and functions
@@ -135,6 +139,17 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "mpo","mpob",_f0, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 },			// B machine position
 	{ "mpo","mpoc",_f0, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 },			// C machine position
 
+	{ "trn","trna",_f0, 0, cm_print_trn, cm_get_trn, set_nul,(float *)&cs.null, 0 },			// A modulo axis turns
+	{ "trn","trnb",_f0, 0, cm_print_trn, cm_get_trn, set_nul,(float *)&cs.null, 0 },			// B modulo axis turns
+	{ "trn","trnc",_f0, 0, cm_print_trn, cm_get_trn, set_nul,(float *)&cs.null, 0 },			// C modulo axis turns
+
+	{ "epo","epox",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// X actual machine position
+	{ "epo","epoy",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// Y actual machine position
+	{ "epo","epoz",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// Z actual machine position
+	{ "epo","epoa",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// A actual machine position
+	{ "epo","epob",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// B actual machine position
+	{ "epo","epoc",_f0, 3, cm_print_epo, cm_get_epo, set_nul,(float *)&cs.null, 0 },			// C actual machine position
+
 	{ "pos","posx",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// X work position
 	{ "pos","posy",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// Y work position
 	{ "pos","posz",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// Z work position
@@ -188,9 +203,18 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "", "qr",  _f0, 0, qr_print_qr,  qr_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - planner buffers available
 	{ "", "qi",  _f0, 0, qr_print_qi,  qi_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - buffers added to queue
 	{ "", "qo",  _f0, 0, qr_print_qo,  qo_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - buffers removed from queue
+	{ "", "qt",  _f0, 3, qr_print_qt,  qt_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - planned time in queue (seconds)
 	{ "", "er",  _f0, 0, tx_print_nul, rpt_er,  set_nul,  (float *)&cs.null, 0 },	// invoke bogus exception report for testing
 	{ "", "qf",  _f0, 0, tx_print_nul, get_nul, cm_run_qf,(float *)&cs.null, 0 },	// queue flush
+	{ "", "ppl", _f0, 0, tx_print_nul, get_nul, cm_run_ppl,(float *)&cs.null, 0 },	// queue a host-planned line
+	{ "", "psi", _f0, 3, tx_print_flt, cm_get_psi, cm_run_psi,(float *)&cs.null, 0 },	// PSO pulse spacing (mm)
+	{ "", "sgm", _f0, 0, tx_print_int, ss_get_sgm, ss_set_sgm,(float *)&cs.null, 0 },	// step-stream mode
+	{ "", "sgs", _f0, 0, tx_print_int, get_nul, ss_run_sgs,(float *)&cs.null, 0 },	// queue step-stream segments
+	{ "", "sgc", _f0, 0, tx_print_int, ss_get_sgc, set_nul,(float *)&cs.null, 0 },	// step-stream buffer credits
+	{ "", "sgr", _f0, 0, tx_print_int, ss_get_sgr, ss_set_sgr,(float *)&cs.null, 0 },	// record exec output for replay
+	{ "", "sgh", _f0, 0, tx_print_str, ss_get_sgh, set_nul,(float *)&cs.null, 0 },	// settings hash for recordings
 	{ "", "rx",  _f0, 0, tx_print_int, get_rx,  set_nul,  (float *)&cs.null, 0 },	// space in RX buffer
+	{ "", "nvp", _f0, 0, tx_print_int, nvm_get_nvp, set_nul,(float *)&cs.null, 0 },	// NVM writes pending
 	{ "", "msg", _f0, 0, tx_print_str, get_nul, set_nul,  (float *)&cs.null, 0 },	// string for generic messages
 //	{ "", "clc", _f0, 0, tx_print_nul, st_clc,  st_clc,   (float *)&cs.null, 0 },	// clear diagnostic step counters
 	{ "", "clear",_f0,0, tx_print_nul, cm_clear,cm_clear, (float *)&cs.null, 0 },	// GET a clear to clear soft alarm
@@ -199,6 +223,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "", "test",_f0, 0, tx_print_nul, help_test, run_test, (float *)&cs.null,0 },	// run tests, print test help screen
 	{ "", "defa",_f0, 0, tx_print_nul, help_defa, set_defaults,(float *)&cs.null,0 },	// set/print defaults / help screen
 	{ "", "boot",_f0, 0, tx_print_nul, help_boot_loader,hw_run_boot, (float *)&cs.null,0 },
+	{ "", "fwb", _f0, 0, tx_print_int, fw_get_fwb, fw_set_fwb, (float *)&cs.null,0 },	// begin staging firmware image
+	{ "", "fwd", _f0, 0, tx_print_int, get_nul,    fw_run_fwd, (float *)&cs.null,0 },	// firmware image data
+	{ "", "fwv", _f0, 0, tx_print_int, fw_get_fwv, fw_set_fwv, (float *)&cs.null,0 },	// verify and install on next reset
 
 #ifdef __HELP_SCREENS
 	{ "", "help",_f0, 0, tx_print_nul, help_config, set_nul, (float *)&cs.null,0 },  // prints config help screen
@@ -279,6 +306,8 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "x","xjm",_fipc, 0, cm_print_jm, get_flt,   cm_set_xjm,(float *)&cm.a[AXIS_X].jerk_max,		X_JERK_MAX },
 	{ "x","xjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_X].jerk_homing,	X_JERK_HOMING },
 	{ "x","xjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].junction_dev,	X_JUNCTION_DEVIATION },
+	{ "x","xjr",_fipc, 0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_X].jerk_traverse,	X_JERK_TRAVERSE },
+	{ "x","xdr",_fipc, 4, cm_print_dr, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].junction_dev_traverse,X_JUNCTION_DEV_TRAVERSE },
 	{ "x","xsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[0],					X_SWITCH_MODE_MIN },
 	{ "x","xsx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[1],					X_SWITCH_MODE_MAX },
 //	{ "x","xsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_X][SW_MIN].mode,	X_SWITCH_MODE_MIN },	// new style
@@ -296,6 +325,8 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "y","yjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_Y].jerk_max,		Y_JERK_MAX },
 	{ "y","yjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_Y].jerk_homing,	Y_JERK_HOMING },
 	{ "y","yjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].junction_dev,	Y_JUNCTION_DEVIATION },
+	{ "y","yjr",_fipc, 0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_Y].jerk_traverse,	Y_JERK_TRAVERSE },
+	{ "y","ydr",_fipc, 4, cm_print_dr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].junction_dev_traverse,Y_JUNCTION_DEV_TRAVERSE },
 	{ "y","ysn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[2],					Y_SWITCH_MODE_MIN },
 	{ "y","ysx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[3],					Y_SWITCH_MODE_MAX },
 //	{ "y","ysn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Y][SW_MIN].mode,	Y_SWITCH_MODE_MIN },	// new style
@@ -313,6 +344,8 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "z","zjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_Z].jerk_max,		Z_JERK_MAX },
 	{ "z","zjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_Z].jerk_homing, 	Z_JERK_HOMING },
 	{ "z","zjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].junction_dev,	Z_JUNCTION_DEVIATION },
+	{ "z","zjr",_fipc, 0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_Z].jerk_traverse,	Z_JERK_TRAVERSE },
+	{ "z","zdr",_fipc, 4, cm_print_dr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].junction_dev_traverse,Z_JUNCTION_DEV_TRAVERSE },
 	{ "z","zsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[4],					Z_SWITCH_MODE_MIN },
 	{ "z","zsx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[5],					Z_SWITCH_MODE_MAX },
 //	{ "z","zsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_Z][SW_MIN].mode,	Z_SWITCH_MODE_MIN },	// new style
@@ -330,7 +363,10 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "a","ajm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_A].jerk_max,		A_JERK_MAX },
 	{ "a","ajh",_fip,  0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_A].jerk_homing, 	A_JERK_HOMING },
 	{ "a","ajd",_fip,  4, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].junction_dev,	A_JUNCTION_DEVIATION },
+	{ "a","ajr",_fip,  0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_A].jerk_traverse,	A_JERK_TRAVERSE },
+	{ "a","adr",_fip,  4, cm_print_dr, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].junction_dev_traverse,A_JUNCTION_DEV_TRAVERSE },
 	{ "a","ara",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].radius,			A_RADIUS},
+	{ "a","apa",_fip,  4, cm_print_pa, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].pressure_advance,A_PRESSURE_ADVANCE },
 	{ "a","asn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[6],					A_SWITCH_MODE_MIN },
 	{ "a","asx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[7],					A_SWITCH_MODE_MAX },
 //	{ "a","asn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_A][SW_MIN].mode,	A_SWITCH_MODE_MIN },	// new style
@@ -347,7 +383,10 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "b","btm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX },
 	{ "b","bjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_B].jerk_max,		B_JERK_MAX },
 	{ "b","bjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].junction_dev,	B_JUNCTION_DEVIATION },
+	{ "b","bjr",_fip,  0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_B].jerk_traverse,	B_JERK_TRAVERSE },
+	{ "b","bdr",_fip,  4, cm_print_dr, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].junction_dev_traverse,B_JUNCTION_DEV_TRAVERSE },
 	{ "b","bra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].radius,			B_RADIUS },
+	{ "b","bpa",_fip,  4, cm_print_pa, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].pressure_advance,B_PRESSURE_ADVANCE },
 #ifdef __ARM	// B axis extended parameters
 	{ "b","asn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_B][SW_MIN].mode,	B_SWITCH_MODE_MIN },
 	{ "b","asx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_B][SW_MAX].mode,	B_SWITCH_MODE_MAX },
@@ -365,7 +404,10 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "c","ctm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX },
 	{ "c","cjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_C].jerk_max,		C_JERK_MAX },
 	{ "c","cjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].junction_dev,	C_JUNCTION_DEVIATION },
+	{ "c","cjr",_fip,  0, cm_print_jr, get_flt,   cm_set_xjr,(float *)&cm.a[AXIS_C].jerk_traverse,	C_JERK_TRAVERSE },
+	{ "c","cdr",_fip,  4, cm_print_dr, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].junction_dev_traverse,C_JUNCTION_DEV_TRAVERSE },
 	{ "c","cra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].radius,			C_RADIUS },
+	{ "c","cpa",_fip,  4, cm_print_pa, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].pressure_advance,C_PRESSURE_ADVANCE },
 #ifdef __ARM	// C axis extended parameters
 	{ "c","csn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_C][SW_MIN].mode,	C_SWITCH_MODE_MIN },
 	{ "c","csx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.s[AXIS_C][SW_MAX].mode,	C_SWITCH_MODE_MAX },
@@ -453,6 +495,34 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "g30","g30b",_fi, 3, cm_print_cpos, get_flt, set_nul,(float *)&cm.gmx.g30_position[AXIS_B], 0 },
 	{ "g30","g30c",_fi, 3, cm_print_cpos, get_flt, set_nul,(float *)&cm.gmx.g30_position[AXIS_C], 0 },
 
+	// Tool table (T1-T4) - length offsets are applied by G43
+	{ "tt1","tt1l",_fipc, 3, cm_print_ttl, get_flt, set_flu,(float *)&cm.tt[1].length, TT1_LENGTH },
+	{ "tt1","tt1d",_fipc, 3, cm_print_ttd, get_flt, set_flu,(float *)&cm.tt[1].diameter, TT1_DIAMETER },
+	{ "tt1","tt1w",_fipc, 3, cm_print_ttw, get_flt, set_flu,(float *)&cm.tt[1].wear, TT1_WEAR },
+
+	{ "tt2","tt2l",_fipc, 3, cm_print_ttl, get_flt, set_flu,(float *)&cm.tt[2].length, TT2_LENGTH },
+	{ "tt2","tt2d",_fipc, 3, cm_print_ttd, get_flt, set_flu,(float *)&cm.tt[2].diameter, TT2_DIAMETER },
+	{ "tt2","tt2w",_fipc, 3, cm_print_ttw, get_flt, set_flu,(float *)&cm.tt[2].wear, TT2_WEAR },
+
+	{ "tt3","tt3l",_fipc, 3, cm_print_ttl, get_flt, set_flu,(float *)&cm.tt[3].length, TT3_LENGTH },
+	{ "tt3","tt3d",_fipc, 3, cm_print_ttd, get_flt, set_flu,(float *)&cm.tt[3].diameter, TT3_DIAMETER },
+	{ "tt3","tt3w",_fipc, 3, cm_print_ttw, get_flt, set_flu,(float *)&cm.tt[3].wear, TT3_WEAR },
+
+	{ "tt4","tt4l",_fipc, 3, cm_print_ttl, get_flt, set_flu,(float *)&cm.tt[4].length, TT4_LENGTH },
+	{ "tt4","tt4d",_fipc, 3, cm_print_ttd, get_flt, set_flu,(float *)&cm.tt[4].diameter, TT4_DIAMETER },
+	{ "tt4","tt4w",_fipc, 3, cm_print_ttw, get_flt, set_flu,(float *)&cm.tt[4].wear, TT4_WEAR },
+
+	// Tool change cycle (M6)
+	{ "tc","tcm", _fipn, 0, cm_print_tcm, get_ui8, set_012,(float *)&cm.tool_change_mode, TOOL_CHANGE_MODE },
+	{ "tc","tcx", _fipc, 3, cm_print_tcp, get_flt, set_flu,(float *)&cm.tool_change_position[AXIS_X], TOOL_CHANGE_X },
+	{ "tc","tcy", _fipc, 3, cm_print_tcp, get_flt, set_flu,(float *)&cm.tool_change_position[AXIS_Y], TOOL_CHANGE_Y },
+	{ "tc","tcz", _fipc, 3, cm_print_tcp, get_flt, set_flu,(float *)&cm.tool_change_position[AXIS_Z], TOOL_CHANGE_Z },
+	{ "tc","tcsx",_fipc, 3, cm_print_tcs, get_flt, set_flu,(float *)&cm.tool_setter_position[AXIS_X], TOOL_SETTER_X },
+	{ "tc","tcsy",_fipc, 3, cm_print_tcs, get_flt, set_flu,(float *)&cm.tool_setter_position[AXIS_Y], TOOL_SETTER_Y },
+	{ "tc","tcsz",_fipc, 3, cm_print_tcs, get_flt, set_flu,(float *)&cm.tool_setter_position[AXIS_Z], TOOL_SETTER_Z },
+	{ "tc","tcsf",_fipc, 0, cm_print_tcf, get_flt, set_flu,(float *)&cm.tool_setter_feed, TOOL_SETTER_FEED },
+	{ "tc","tcsr",_fipc, 3, cm_print_tcr, get_flt, set_flu,(float *)&cm.tool_setter_reference, TOOL_SETTER_REFERENCE },
+
 	// this is a 128bit UUID for identifying a previously committed job state
 	{ "jid","jida",_f0, 0, tx_print_nul, get_data, set_data, (float *)&cs.job_id[0], 0},
 	{ "jid","jidb",_f0, 0, tx_print_nul, get_data, set_data, (float *)&cs.job_id[1], 0},
@@ -462,9 +532,21 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// System parameters
 	{ "sys","ja",  _fipnc,0, cm_print_ja,  get_flt,   set_flu,    (float *)&cm.junction_acceleration,JUNCTION_ACCELERATION },
 	{ "sys","ct",  _fipnc,4, cm_print_ct,  get_flt,   set_flu,    (float *)&cm.chordal_tolerance,	CHORDAL_TOLERANCE },
+	{ "sys","spt", _fipnc,4, cm_print_spt, get_flt,   set_flu,    (float *)&cm.arc_spiral_tolerance,ARC_SPIRAL_TOLERANCE },
 	{ "sys","sl",  _fipn, 0, cm_print_sl,  get_ui8,   set_ui8,    (float *)&cm.soft_limit_enable,	SOFT_LIMIT_ENABLE },
+	{ "sys","tvm", _fipn, 0, cm_print_tvm, get_ui8,   set_012,    (float *)&cm.traverse_mode,		TRAVERSE_MODE },
+	{ "sys","tsz", _fipnc,3, cm_print_tsz, get_flt,   set_flu,    (float *)&cm.traverse_safe_z,		TRAVERSE_SAFE_Z },
+	{ "sys","pas", _fipn, 4, cm_print_pas, get_flt,   set_flt,    (float *)&cm.advance_smoothing,	PRESSURE_ADVANCE_SMOOTHING },
+	{ "sys","kin", _fipn, 0, kn_print_kin, get_ui8,   kn_set_kin, (float *)&kin.type,				KINEMATICS },
+	{ "sys","kpx", _fipnc,3, kn_print_kpx, get_flt,   kn_set_kp,  (float *)&kin.pivot[AXIS_X],		KINEMATIC_PIVOT_X },
+	{ "sys","kpy", _fipnc,3, kn_print_kpy, get_flt,   kn_set_kp,  (float *)&kin.pivot[AXIS_Y],		KINEMATIC_PIVOT_Y },
+	{ "sys","kpz", _fipnc,3, kn_print_kpz, get_flt,   kn_set_kp,  (float *)&kin.pivot[AXIS_Z],		KINEMATIC_PIVOT_Z },
+	{ "sys","kpl", _fipnc,3, kn_print_kpl, get_flt,   kn_set_kp,  (float *)&kin.pivot_length,		KINEMATIC_PIVOT_LENGTH },
+	{ "sys","kle", _fipnc,4, kn_print_kle, get_flt,   set_flu,    (float *)&kin.tolerance,			KINEMATIC_TOLERANCE },
+	{ "sys","kct", _f0,   1, kn_print_kct, kn_get_kct, kn_set_kct, (float *)&kin.cost,				0 },
 	{ "sys","st",  _fipn, 0, sw_print_st,  get_ui8,   sw_set_st,  (float *)&sw.switch_type,			SWITCH_TYPE },
 	{ "sys","mt",  _fipn, 2, st_print_mt,  get_flt,   st_set_mt,  (float *)&st_cfg.motor_power_timeout,MOTOR_IDLE_TIMEOUT},
+	{ "sys","pso", _fipn, 0, st_print_pso, get_ui8,   st_set_pso, (float *)&st_cfg.pso_output,	0 },
 	{ "",   "me",  _f0,   0, tx_print_str, st_set_me, st_set_me,  (float *)&cs.null, 0 },
 	{ "",   "md",  _f0,   0, tx_print_str, st_set_md, st_set_md,  (float *)&cs.null, 0 },
 
@@ -473,6 +555,7 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "sys","js",  _fipn, 0, js_print_js,  get_ui8,   set_01,     (float *)&js.json_syntax, 		JSON_SYNTAX_MODE },
 	{ "sys","tv",  _fipn, 0, tx_print_tv,  get_ui8,   set_01,     (float *)&txt.text_verbosity,		TEXT_VERBOSITY },
 	{ "sys","qv",  _fipn, 0, qr_print_qv,  get_ui8,   set_0123,   (float *)&qr.queue_report_verbosity,QUEUE_REPORT_VERBOSITY },
+	{ "sys","tlv", _fipn, 0, tl_print_tlv, get_ui8,   set_01,     (float *)&tl.timeline_report_verbosity,TIMELINE_REPORT_VERBOSITY },
 	{ "sys","sv",  _fipn, 0, sr_print_sv,  get_ui8,   set_012,    (float *)&sr.status_report_verbosity,STATUS_REPORT_VERBOSITY },
 	{ "sys","si",  _fipn, 0, sr_print_si,  get_int,   sr_set_si,  (float *)&sr.status_report_interval,STATUS_REPORT_INTERVAL_MS },
 //	{ "sys","spi", _fipn, 0, xio_print_spi,get_ui8,   xio_set_spi,(float *)&xio.spi_state,			0 },
@@ -481,7 +564,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "sys","ee",  _fipn, 0, cfg_print_ee,  get_ui8,   set_ee,     (float *)&cfg.enable_echo,		COM_ENABLE_ECHO },
 	{ "sys","ex",  _fipn, 0, cfg_print_ex,  get_ui8,   set_ex,     (float *)&cfg.enable_flow_control,COM_ENABLE_FLOW_CONTROL },
 	{ "sys","baud",_fn,   0, cfg_print_baud,get_ui8,   set_baud,   (float *)&cfg.usb_baud_rate,		XIO_BAUD_115200 },
-	{ "sys","net", _fipn, 0, cfg_print_net, get_ui8,   set_ui8,    (float *)&cs.network_mode,		NETWORK_MODE },
+	{ "sys","net", _fipn, 0, cfg_print_net, get_ui8,   tg_set_net, (float *)&cs.network_mode,		NETWORK_MODE },
+	{ "sys","pnd", _fipn, 0, tg_print_pnd,  get_ui8,   tg_set_pnd, (float *)&cs.secondary_src,		PENDANT_DEVICE },
+	{ "sys","pdl", _f0,   0, tg_print_pdl,  get_int,   tg_set_pdl, (float *)&cs.secondary_latency,	0 },
 
 	// switch state readouts
 /*
@@ -664,8 +749,15 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","g92",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// origin offsets
 	{ "","g28",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// g28 home position
 	{ "","g30",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// g30 home position
+	{ "","tt1",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// tool table groups
+	{ "","tt2",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt3",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt4",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tc", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// tool change settings
 
 	{ "","mpo",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// machine position group
+	{ "","trn",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// modulo axis turns group
+	{ "","epo",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// actual machine position group
 	{ "","pos",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// work position group
 	{ "","ofs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// work offset group
 	{ "","hom",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis homing state group
@@ -701,7 +793,7 @@ const cfgItem_t cfgArray[] PROGMEM = {
 /***** Make sure these defines line up with any changes in the above table *****/
 
 #define NV_COUNT_UBER_GROUPS 	4 		// count of uber-groups, above
-#define STANDARD_GROUPS 		33		// count of standard groups, excluding diagnostic parameter groups
+#define STANDARD_GROUPS 		40		// count of standard groups, excluding diagnostic parameter groups
 
 #if (MOTORS >= 5)
 #define MOTOR_GROUP_5			1
@@ -827,9 +919,9 @@ static stat_t _do_axes(nvObj_t *nv)	// print parameters for all axis groups
 	return (_do_group_list(nv, list));
 }
 
-static stat_t _do_offsets(nvObj_t *nv)	// print offset parameters for G54-G59,G92, G28, G30
+static stat_t _do_offsets(nvObj_t *nv)	// print offset parameters for G54-G59,G92, G28, G30 and the tool table
 {
-	char list[][TOKEN_LEN+1] = {"g54","g55","g56","g57","g58","g59","g92","g28","g30",""}; // must have a terminating element
+	char list[][TOKEN_LEN+1] = {"g54","g55","g56","g57","g58","g59","g92","g28","g30","tt1","tt2","tt3","tt4",""}; // must have a terminating element
 	return (_do_group_list(nv, list));
 }
 
@@ -846,6 +938,10 @@ static stat_t _do_all(nvObj_t *nv)	// print all parameters
 	get_grp(nv);
 	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
 
+	strcpy(nv->token,"tc");			// print tool change group
+	get_grp(nv);
+	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+
 	return (_do_offsets(nv));			// print all offsets
 }
 
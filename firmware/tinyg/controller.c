@@ -34,8 +34,12 @@
 #include "gcode_parser.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_comp.h"
 #include "planner.h"
 #include "stepper.h"
+#include "step_stream.h"
+#include "persistence.h"
+#include "network.h"
 
 #include "encoder.h"
 #include "hardware.h"
@@ -68,6 +72,7 @@ static stat_t _system_assertions(void);
 static stat_t _sync_to_planner(void);
 static stat_t _sync_to_tx_buffer(void);
 static stat_t _command_dispatch(void);
+static stat_t _secondary_dispatch(void);
 
 // prep for export to other modules:
 stat_t hardware_hard_reset_handler(void);
@@ -161,9 +166,11 @@ static void _controller_HSM()
 //	DISPATCH( poll_switches());					// 4. run a switch polling cycle
 	DISPATCH(_limit_switch_handler());			// 5. limit switch has been thrown
 
+	DISPATCH(cm_realtime_callback());			// extended realtime commands and safety door
 	DISPATCH(cm_feedhold_sequencing_callback());// 6a. feedhold state machine runner
 	DISPATCH(mp_plan_hold_callback());			// 6b. plan a feedhold from line runtime
 	DISPATCH(_system_assertions());				// 7. system integrity assertions
+	DISPATCH(_secondary_dispatch());			// 8. pendant input is serviced on every pass
 
 //----- planner hierarchy for gcode and cycles ---------------------------------------//
 
@@ -172,11 +179,18 @@ static void _controller_HSM()
 	DISPATCH(sr_status_report_callback());		// conditionally send status report
 	DISPATCH(qr_queue_report_callback());		// conditionally send queue report
 	DISPATCH(rx_report_callback());             // conditionally send rx report
+	DISPATCH(tl_timeline_report_callback());	// conditionally send line timeline report
+	DISPATCH(ss_record_callback());				// send recorded exec segments
 	DISPATCH(cm_arc_callback());				// arc generation runs behind lines
+	DISPATCH(cm_comp_callback());				// cutter compensated moves run behind arcs
+	DISPATCH(cm_dogleg_callback());				// dogleg traverse segments
+	DISPATCH(gc_deferred_block_callback());		// run a block held back for cutter compensation
 	DISPATCH(cm_homing_callback());				// G28.2 continuation
 	DISPATCH(cm_jogging_callback());			// jog function
 	DISPATCH(cm_probe_callback());				// G38.2 continuation
+	DISPATCH(cm_tool_change_callback());		// M6 tool change continuation
 	DISPATCH(cm_deferred_write_callback());		// persist G10 changes when not in machining cycle
+	DISPATCH(persistence_callback());			// write out deferred NVM writes when idle
 
 //----- command readers and parsers --------------------------------------------------//
 
@@ -275,10 +289,8 @@ static stat_t _command_dispatch()
 			break;
 		}
 		default: {										// anything else must be Gcode
-			if (cfg.comm_mode == JSON_MODE) {			// run it as JSON...
-				strncpy(cs.out_buf, cs.bufp, INPUT_BUFFER_LEN -8);					// use out_buf as temp
-				sprintf((char *)cs.bufp,"{\"gc\":\"%s\"}\n", (char *)cs.out_buf);	// '-8' is used for JSON chars
-				json_parser(cs.bufp);
+			if (cfg.comm_mode == JSON_MODE) {			// run it with a JSON response...
+				json_gcode_parser(cs.bufp);
 			} else {									//...or run it as text
 				text_response(gc_gcode_parser(cs.bufp), cs.saved_buf);
 			}
@@ -287,7 +299,114 @@ static stat_t _command_dispatch()
 	return (STAT_OK);
 }
 
-
+/*****************************************************************************
+ * _secondary_dispatch() - run a line from the secondary (pendant) input
+ *
+ *	Arbitration between the two inputs:
+ *	  - The secondary is polled on every controller pass, ahead of the cycle callbacks
+ *		and the planner and TX syncs, so it is answered while the primary stream is
+ *		blocked on a full planner queue or a running cycle.
+ *	  - At most one secondary line runs per pass, and it runs before the primary line
+ *		of the same pass.
+ *	  - The secondary is limited to commands that are safe during a primary job:
+ *			! ~ %		feedhold, cycle start and queue flush, as on the primary
+ *			?			text status report
+ *			{...}		JSON gets of any value. JSON sets only to jog, and only when idle
+ *		Gcode and text mode settings are refused. Extended realtime bytes (overrides,
+ *		jog cancel) are trapped by the RS485 RX ISR and do not wait for a pass.
+ *	  - A jog started from the secondary holds off the primary until it completes,
+ *		the same as any other cycle.
+ *
+ *	Responses go back to the secondary device. The primary's line length is not
+ *	touched so its flow control is not disturbed. The longest time between polls is
+ *	kept for tuning ($pdl) - set it to any value to reset it.
+ */
+
+static stat_t _secondary_dispatch()
+{
+#ifdef __AVR
+	uint32_t tick = SysTickTimer_getValue();
+
+	if ((cs.secondary_src == XIO_DEV_USB) || (cs.secondary_src == cs.primary_src)) {
+		return (STAT_NOOP);								// no secondary input
+	}
+	if ((cs.secondary_tick != 0) && ((tick - cs.secondary_tick) > cs.secondary_latency)) {
+		cs.secondary_latency = tick - cs.secondary_tick;
+	}
+	cs.secondary_tick = tick;
+
+	if (xio_gets(cs.secondary_src, cs.sec_buf, sizeof(cs.sec_buf)) != STAT_OK) {
+		return (STAT_NOOP);
+	}
+	FILE *out = stdout;
+	uint8_t err = xio_get_stderr();
+	xio_set_stdout(cs.secondary_src);					// answer the pendant, not the host
+	xio_set_stderr(cs.secondary_src);
+
+	switch (*cs.sec_buf) {
+		case '!': { cm_request_feedhold(); break; }
+		case '%': { cm_request_queue_flush(); break; }
+		case '~': { cm_request_cycle_start(); break; }
+		case NUL: { break; }
+		case '?': { sr_run_text_status_report(); break; }
+		case '{': { json_parser_restricted(cs.sec_buf); break; }
+		default: { text_response(STAT_COMMAND_NOT_ACCEPTED, cs.sec_buf); }
+	}
+	stdout = out;
+	xio_set_stderr(err);
+#endif // __AVR
+	return (STAT_OK);
+}
+
+/*
+ * tg_set_pnd() - set the secondary (pendant) input device
+ * tg_set_net() - set the network mode
+ * tg_set_pdl() - reset the secondary input latency (any value)
+ *
+ *	Master and slave network modes use the RS485 port, so it can only be the pendant
+ *	device in standalone mode. Each setter refuses the value that would share it.
+ */
+
+stat_t tg_set_pnd(nvObj_t *nv)
+{
+	uint8_t dev = (uint8_t)nv->value;
+
+	if ((dev != XIO_DEV_USB) && (dev != XIO_DEV_RS485) && (dev != XIO_DEV_SPI1) && (dev != XIO_DEV_SPI2)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	if ((dev == XIO_DEV_RS485) && (cs.network_mode != NETWORK_STANDALONE)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	set_ui8(nv);
+	cs.secondary_tick = 0;
+	return (STAT_OK);
+}
+
+stat_t tg_set_net(nvObj_t *nv)
+{
+	if (((uint8_t)nv->value != NETWORK_STANDALONE) && (cs.secondary_src == XIO_DEV_RS485)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	return (set_ui8(nv));
+}
+
+stat_t tg_set_pdl(nvObj_t *nv)
+{
+	cs.secondary_latency = 0;
+	nv->value = 0;
+	return (STAT_OK);
+}
+
+#ifdef __TEXT_MODE
+
+static const char fmt_pnd[] PROGMEM = "[pnd] pendant input device%9d [0=none,1=RS485,2=SPI1,3=SPI2]\n";
+static const char fmt_pdl[] PROGMEM = "[pdl] pendant poll latency%9lu ms\n";
+
+void tg_print_pnd(nvObj_t *nv) { text_print_ui8(nv, fmt_pnd);}
+void tg_print_pdl(nvObj_t *nv) { text_print_int(nv, fmt_pdl);}
+
+#endif // __TEXT_MODE
+
 /**** Local Utilities ********************************************************/
 /*
  * _shutdown_idler() - blink rapidly and prevent further activity from occurring
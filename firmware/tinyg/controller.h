@@ -34,6 +34,7 @@ extern "C"{
 
 #define INPUT_BUFFER_LEN 255			// text buffer size (255 max)
 #define SAVED_BUFFER_LEN 100			// saved buffer size (for reporting only)
+#define SECONDARY_BUFFER_LEN 64		// secondary (pendant) input buffer size
 #define OUTPUT_BUFFER_LEN 512			// text buffer size
 // see also: tinyg.h MESSAGE_LEN and config.h NV_ lengths
 
@@ -51,12 +52,14 @@ typedef struct controllerSingleton {	// main TG controller struct
 
 	// communications state variables
 	uint8_t primary_src;				// primary input source device
-	uint8_t secondary_src;				// secondary input source device
+	uint8_t secondary_src;				// secondary input source device. XIO_DEV_USB = none
 	uint8_t default_src;				// default source device
 	uint8_t network_mode;				// 0=master, 1=repeater, 2=slave
 
 	uint16_t linelen;					// length of currently processing line
 	uint16_t read_index;				// length of line being read
+	uint32_t secondary_tick;			// SysTick of the last secondary input poll
+	uint32_t secondary_latency;			// longest time between secondary input polls (ms)
 
 	// system state variables
 	uint8_t led_state;		// LEGACY	// 0=off, 1=on
@@ -74,6 +77,7 @@ typedef struct controllerSingleton {	// main TG controller struct
 	// controller serial buffers
 	char_t *bufp;						// pointer to primary or secondary in buffer
 	char_t in_buf[INPUT_BUFFER_LEN];	// primary input buffer
+	char_t sec_buf[SECONDARY_BUFFER_LEN];// secondary input buffer
 	char_t out_buf[OUTPUT_BUFFER_LEN];	// output buffer
 	char_t saved_buf[SAVED_BUFFER_LEN];	// save the input buffer
 	magic_t magic_end;
@@ -101,6 +105,22 @@ void tg_reset_source(void);
 void tg_set_primary_source(uint8_t dev);
 void tg_set_secondary_source(uint8_t dev);
 
+stat_t tg_set_pnd(nvObj_t *nv);
+stat_t tg_set_net(nvObj_t *nv);
+stat_t tg_set_pdl(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+
+	void tg_print_pnd(nvObj_t *nv);
+	void tg_print_pdl(nvObj_t *nv);
+
+#else
+
+	#define tg_print_pnd tx_print_stub
+	#define tg_print_pdl tx_print_stub
+
+#endif // __TEXT_MODE
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,311 @@
+/*
+ * cycle_toolchange.c - M6 tool change cycle extension to canonical_machine.c
+ * Part of TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "tinyg.h"
+#include "config.h"
+#include "json_parser.h"
+#include "text_parser.h"
+#include "canonical_machine.h"
+#include "spindle.h"
+#include "report.h"
+#include "util.h"
+#include "planner.h"
+
+/**** Tool change singleton structure ****/
+
+struct tcToolChangeSingleton {					// persistent tool change runtime variables
+	stat_t (*func)();							// binding for callback function state machine
+	uint8_t tool;								// tool being loaded
+
+	// state saved from gcode model
+	uint8_t saved_units_mode;					// G20,G21 global setting
+	uint8_t saved_distance_mode;				// G90,G91 global setting
+	uint8_t saved_feed_rate_mode;				// G93,G94 global setting
+	uint8_t saved_motion_mode;					// G0,G1... modal motion
+	uint8_t saved_spindle_mode;					// M3,M4,M5
+	uint8_t saved_mist_coolant;					// M7
+	uint8_t saved_flood_coolant;				// M8
+	uint8_t saved_origin_offset_enable;			// G92 offsets in effect
+	uint8_t saved_tool_length_mode;				// G43 in effect
+	float saved_feed_rate;						// F setting
+	float saved_position[AXES];					// machine position to return to
+};
+static struct tcToolChangeSingleton tc;
+
+/**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
+
+static stat_t _tc_init();
+static stat_t _tc_park_xy();
+static stat_t _tc_wait_start();
+static stat_t _tc_wait();
+static stat_t _tc_probe();
+static stat_t _tc_probe_finish();
+static stat_t _tc_resume();
+static void _tc_restore_settings();
+static stat_t _tc_finalize_exit();
+static stat_t _tc_error_exit(stat_t status);
+
+/**** HELPERS ***************************************************************************
+ * _set_tc_func() - a convenience for setting the next dispatch vector and exiting
+ * _tc_traverse() - traverse the given axes to a machine position (G53 G0)
+ */
+
+static stat_t _set_tc_func(stat_t (*func)())
+{
+	tc.func = func;
+	return (STAT_EAGAIN);
+}
+
+static stat_t _tc_traverse(const float position[], uint8_t first_axis, uint8_t last_axis)
+{
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	for (uint8_t axis = first_axis; axis <= last_axis; axis++) {
+		target[axis] = position[axis];
+		flags[axis] = 1;
+	}
+	cm_set_absolute_override(MODEL, true);		// moves are in machine coordinates
+	stat_t status = cm_straight_traverse(target, flags);
+	cm_set_absolute_override(MODEL, false);
+	return (status);
+}
+
+/****************************************************************************************
+ * cm_tool_change_cycle_start()	- M6 tool change cycle
+ * cm_tool_change_callback() 	- main loop callback for running the tool change cycle
+ *
+ *	The cycle is selected by the tool change mode ($tcm). With the mode off M6 only
+ *	records the tool number (see cm_change_tool()). Otherwise the sequence is:
+ *
+ *	  - stop spindle and coolant, suspend G92 and G43 offsets
+ *	  - raise Z to the tool change position ($tcz), then move XY there ($tcx, $tcy)
+ *	  - enter a feedhold and wait for cycle start (~) while the operator changes the tool
+ *	  - in probe mode ($tcm=2): move to the tool setter ($tcsx, $tcsy) and probe down
+ *		to $tcsz at $tcsf. The tool length is the trigger position minus the setter
+ *		reference ($tcsr), and is written to the tool table. Retract to $tcz
+ *	  - return to the XY position the cycle started from (Z stays at $tcz)
+ *	  - restore spindle, coolant, modes and offsets. G43 is re-applied for the new tool
+ *
+ *	Notes: Program T and M6 on their own line. Motion in the same block as M6 is queued
+ *	before the cycle starts. Positions are in machine coordinates and are always in mm.
+ *	A failed tool setter measurement puts the machine in alarm ($clear to recover).
+ *	A queue flush (%) while waiting for the tool aborts the cycle.
+ *
+ *	When coding a cycle (like this one) you get to perform one queued move per entry
+ *	into the continuation, then you must exit. See cycle_probing.c for more details.
+ */
+
+stat_t cm_tool_change_cycle_start(uint8_t tool)
+{
+	if (tool > TOOLS) {
+		return (STAT_T_WORD_IS_INVALID);
+	}
+	tc.tool = tool;
+	tc.func = _tc_init;							// bind initialization function - runs once motion stops
+	return (STAT_OK);
+}
+
+stat_t cm_tool_change_callback(void)
+{
+	if (tc.func == NULL) { return (STAT_NOOP);}	// exit if not in a tool change cycle or waiting for one
+	if (cm_get_runtime_busy() == true) { return (STAT_EAGAIN);}	// sync to planner move ends
+
+	stat_t status = tc.func();					// execute the current tool change state
+	if ((status != STAT_OK) && (status != STAT_EAGAIN) && (tc.func != NULL)) {
+		return (_tc_error_exit(status));		// a move was rejected (e.g. soft limits)
+	}
+	return (status);
+}
+
+/*
+ * _tc_init() - save state, make the machine safe and raise Z
+ */
+
+static stat_t _tc_init()
+{
+	cm.cycle_state = CYCLE_TOOL_CHANGE;
+
+	tc.saved_units_mode = cm_get_units_mode(MODEL);
+	tc.saved_distance_mode = cm_get_distance_mode(MODEL);
+	tc.saved_feed_rate_mode = cm_get_feed_rate_mode(MODEL);
+	tc.saved_motion_mode = cm_get_motion_mode(MODEL);
+	tc.saved_feed_rate = cm_get_feed_rate(MODEL);
+	tc.saved_spindle_mode = cm_get_spindle_mode(MODEL);
+	tc.saved_mist_coolant = cm.gm.mist_coolant;
+	tc.saved_flood_coolant = cm.gm.flood_coolant;
+	tc.saved_origin_offset_enable = cm.gmx.origin_offset_enable;
+	tc.saved_tool_length_mode = cm.gmx.tool_length_mode;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		tc.saved_position[axis] = cm_get_absolute_position(MODEL, axis);
+	}
+
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(ABSOLUTE_MODE);
+	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);
+
+	cm_spindle_control(SPINDLE_OFF);
+	cm_flood_coolant_control(false);				// also turns off mist
+	cm_suspend_origin_offsets();					// G92.2
+	cm_set_tool_length_offset(false, 0);			// G49
+
+	ritorno(_tc_traverse(cm.tool_change_position, AXIS_Z, AXIS_Z));
+	return (_set_tc_func(_tc_park_xy));
+}
+
+static stat_t _tc_park_xy()
+{
+	ritorno(_tc_traverse(cm.tool_change_position, AXIS_X, AXIS_Y));
+	return (_set_tc_func(_tc_wait_start));
+}
+
+/*
+ * _tc_wait_start() - prompt the operator and hold until cycle start
+ * _tc_wait()
+ */
+
+static stat_t _tc_wait_start()
+{
+	char message[NV_MESSAGE_LEN];
+	sprintf_P(message, PSTR("Tool change - load tool %d then cycle start"), tc.tool);
+	nv_reset_nv_list();
+	nv_add_conditional_message((char_t *)message);
+	nv_print_list(STAT_OK, TEXT_INLINE_VALUES, JSON_OBJECT_FORMAT);
+
+	cm.hold_state = FEEDHOLD_HOLD;				// motion has stopped - go straight to hold
+	cm_set_motion_state(MOTION_HOLD);
+	sr_request_status_report(SR_IMMEDIATE_REQUEST);
+	return (_set_tc_func(_tc_wait));
+}
+
+static stat_t _tc_wait()
+{
+	if (cm.hold_state != FEEDHOLD_OFF) { return (STAT_EAGAIN);}
+
+	// Cycle start ends the hold and sets MACHINE_CYCLE. A queue flush ends the hold
+	// with the machine in program stop, which cancels the tool change
+	if (cm.machine_state != MACHINE_CYCLE) {
+		_tc_restore_settings();
+		return (STAT_OK);
+	}
+	cm_set_tool_number(MODEL, tc.tool);
+	cm_set_tool_number(RUNTIME, tc.tool);
+
+	if ((cm.tool_change_mode == TOOL_CHANGE_PROBE) && (tc.tool != 0)) {
+		ritorno(_tc_traverse(cm.tool_setter_position, AXIS_X, AXIS_Y));
+		return (_set_tc_func(_tc_probe));
+	}
+	return (_set_tc_func(_tc_resume));
+}
+
+/*
+ * _tc_probe() 		  - measure the tool using the probe cycle (G38.2 in machine coordinates)
+ * _tc_probe_finish() - record the tool length and retract
+ */
+
+static stat_t _tc_probe()
+{
+	float target[AXES], flags[AXES];
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		target[axis] = cm_get_absolute_position(MODEL, axis);
+	}
+	target[AXIS_Z] = cm.tool_setter_position[AXIS_Z];
+	clear_vector(flags);
+	flags[AXIS_Z] = 1;
+
+	cm_set_feed_rate(cm.tool_setter_feed);
+	ritorno(cm_straight_probe(target, flags));
+	return (_set_tc_func(_tc_probe_finish));		// the probe callback runs the probe
+}
+
+static stat_t _tc_probe_finish()
+{
+	cm.cycle_state = CYCLE_TOOL_CHANGE;			// probe cycle exits with the cycle off
+
+	if (cm.probe_state != PROBE_SUCCEEDED) {
+		return (_tc_error_exit(STAT_TOOL_CHANGE_CYCLE_FAILED));
+	}
+	cm.tt[tc.tool].length = cm.probe_results[AXIS_Z] - cm.tool_setter_reference;
+	cm.tt[tc.tool].wear = 0;						// measured length includes wear
+	cm.deferred_write_flag = true;				// persist once the cycle is over
+
+	ritorno(_tc_traverse(cm.tool_change_position, AXIS_Z, AXIS_Z));
+	return (_set_tc_func(_tc_resume));
+}
+
+/*
+ * _tc_resume() - return to the starting XY position at tool change height
+ */
+
+static stat_t _tc_resume()
+{
+	ritorno(_tc_traverse(tc.saved_position, AXIS_X, AXIS_Y));
+	return (_set_tc_func(_tc_finalize_exit));
+}
+
+/*
+ * _tc_restore_settings()
+ * _tc_finalize_exit()
+ * _tc_error_exit()
+ *
+ *	Spindle and coolant are only restarted on a successful tool change. A queue flush
+ *	while waiting for the tool restores settings only.
+ */
+
+static void _tc_restore_settings()
+{
+	cm_set_units_mode(tc.saved_units_mode);
+	cm_set_distance_mode(tc.saved_distance_mode);
+	cm_set_feed_rate_mode(tc.saved_feed_rate_mode);
+	cm.gm.feed_rate = tc.saved_feed_rate;
+	cm_set_motion_mode(MODEL, tc.saved_motion_mode);
+
+	if (tc.saved_origin_offset_enable == true) {
+		cm_resume_origin_offsets();				// G92.3
+	}
+	if (tc.saved_tool_length_mode == true) {
+		cm_set_tool_length_offset(true, cm_get_tool(MODEL));	// G43 with the new tool
+	}
+	cm_cycle_end();
+	cm.cycle_state = CYCLE_OFF;
+	tc.func = NULL;
+}
+
+static stat_t _tc_finalize_exit()
+{
+	cm_spindle_control(tc.saved_spindle_mode);
+	cm_flood_coolant_control(tc.saved_flood_coolant);	// flood off also turns off mist, so do it first
+	cm_mist_coolant_control(tc.saved_mist_coolant);
+	_tc_restore_settings();
+	return (STAT_OK);
+}
+
+static stat_t _tc_error_exit(stat_t status)
+{
+	mp_flush_planner();
+	_tc_restore_settings();
+	return (cm_soft_alarm(status));				// machine must be cleared before continuing
+}
@@ -81,6 +81,26 @@ void en_set_encoder_steps(uint8_t motor, float steps)
 {
 	en.en[motor].encoder_steps = (int32_t)round(steps);
 }
+
+/*
+ * en_shift_encoder_steps() - subtract steps from the encoder position
+ *
+ *	Used to move the encoder into a new position frame while motors may be running.
+ *	The encoder is accumulated at LOAD (HI interrupt level) so the update is atomic.
+ */
+
+void en_shift_encoder_steps(uint8_t motor, float steps)
+{
+	int32_t shift = (int32_t)round(steps);
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+	en.en[motor].encoder_steps -= shift;
+	SREG = sreg;
+#else
+	en.en[motor].encoder_steps -= shift;
+#endif
+}
 
 /*
  * en_read_encoder()
@@ -125,6 +125,7 @@ void encoder_init_assertions(void);
 stat_t encoder_test_assertions(void);
 
 void en_set_encoder_steps(uint8_t motor, float steps);
+void en_shift_encoder_steps(uint8_t motor, float steps);
 float en_read_encoder(uint8_t motor);
 
 #endif	// End of include guard: ENCODER_H_ONCE
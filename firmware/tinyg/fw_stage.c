@@ -0,0 +1,284 @@
+/*
+ * fw_stage.c - background firmware staging through the xboot API
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* A new firmware image can be sent over the normal serial / JSON channel while TinyG keeps
+ * running. It is written to the upper half of the application section (the xboot temporary
+ * application section) through the xboot API, verified, and marked for install. xboot copies
+ * it over the running firmware on the next reset, so the machine is only down for the reset.
+ *
+ *	{"fwb":n}	begin staging an image of n bytes. {"fwb":null} returns the bytes received
+ *				so far, which is also the offset to resume from after an error.
+ *	{"fwd":"offset,hexdata"}
+ *				image data at byte offset (decimal). hexdata is 2 hex digits per byte. The
+ *				offset must be the next expected byte. The response is the bytes received.
+ *	{"fwv":crc}	verify and stage. crc is the CRC16 of the n image bytes as computed by
+ *				avr-libc _crc16_update() starting from 0. {"fwv":null} returns the
+ *				fwStageState. 3 means installed - reset to run the new firmware.
+ *
+ *	Programming the application section stalls the CPU and the interrupt vectors live in it,
+ *	so flash pages are only written in idle gaps: when the machine is not in a cycle and the
+ *	steppers are stopped. Every chunk is written straight to flash, so a chunk that arrives
+ *	at any other time is rejected and can be resent. Interrupts are off for each page write
+ *	(a few ms), so the host must wait for the response to each chunk before sending more.
+ *
+ *	No RAM is kept for the page being assembled. A chunk is merged with what the page
+ *	already holds (read back from flash) in cs.out_buf, which is free while a command runs,
+ *	and the page is erased and rewritten. A page is erased once per chunk that touches it,
+ *	so use large chunks - 16 chunks a page at most uses 0.2% of the flash endurance for an
+ *	update. fw keeps 13 bytes of state.
+ *
+ *	The image cannot be larger than the temp section (half the application section, less
+ *	the install marker). The running firmware must also fit below the temp section, or fwb
+ *	returns STAT_FIRMWARE_UPDATE_UNAVAILABLE. On the ATxmega192A3 the temp section is 96K,
+ *	which the current TinyG image (over 100K) does not fit in, so this is only available on
+ *	ATxmega256A3 boards (128K temp section) or with a build trimmed below 96K.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "stepper.h"
+#include "fw_stage.h"
+#include "controller.h"						// cs.out_buf is borrowed to assemble pages
+#include "util.h"
+#include "xio.h"							// for char definitions
+
+#ifdef __AVR
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "xmega/xbootapi.h"
+
+extern uint8_t __data_load_end;				// linker symbol: end of the running image in flash
+
+#if (OUTPUT_BUFFER_LEN < FW_PAGE_SIZE)
+#error "fw_stage.c assembles flash pages in cs.out_buf, which is smaller than a page"
+#endif
+#endif
+
+fwStage_t fw;
+
+/*
+ * fw_stage_init() - initialize firmware staging (idle)
+ */
+
+void fw_stage_init()
+{
+	memset(&fw, 0, sizeof(fw));
+	fw.magic_start = MAGICNUM;
+	fw.magic_end = MAGICNUM;
+}
+
+#ifdef __AVR
+
+/*
+ * _is_idle()		 - true if flash can be written without disturbing motion
+ * _xb_status()		 - map an xboot API return code to a status code
+ * _write_page()	 - write a page to the temp section at offset
+ * _erase_if_used()	 - erase a temp section page unless it is already blank
+ * _hex_nibble()	 - convert a hex digit, returns 0xFF if it is not one
+ */
+
+static uint8_t _is_idle()
+{
+	return ((cm.cycle_state == CYCLE_OFF) && (st_runtime_isbusy() == false));
+}
+
+static stat_t _xb_status(uint8_t ret)
+{
+	if (ret == XB_SUCCESS) return (STAT_OK);
+	if (ret == XB_INVALID_ADDRESS) return (STAT_INVALID_ADDRESS);
+	return (STAT_FIRMWARE_UPDATE_UNAVAILABLE);
+}
+
+static stat_t _write_page(uint32_t offset, uint8_t *page)
+{
+	uint8_t sreg = SREG;
+	cli();									// vectors are in the section being programmed
+	uint8_t ret = xboot_app_temp_write_page(offset, page, true);
+	SREG = sreg;
+	return (_xb_status(ret));
+}
+
+static stat_t _erase_if_used(uint32_t offset)
+{
+	for (uint16_t i=0; i<FW_PAGE_SIZE; i++) {
+		if (pgm_read_byte_far(XB_APP_TEMP_START + offset + i) != 0xFF) {
+			uint8_t sreg = SREG;
+			cli();
+			uint8_t ret = xboot_erase_application_page(XB_APP_TEMP_START + offset);
+			SREG = sreg;
+			return (_xb_status(ret));
+		}
+	}
+	return (STAT_OK);
+}
+
+static uint8_t _hex_nibble(char_t c)
+{
+	if ((c >= '0') && (c <= '9')) return (c - '0');
+	if ((c >= 'a') && (c <= 'f')) return (c - 'a' + 10);
+	if ((c >= 'A') && (c <= 'F')) return (c - 'A' + 10);
+	return (0xFF);
+}
+
+/*
+ * fw_get_fwb() - get bytes received
+ * fw_set_fwb() - begin staging an image of the given size
+ */
+
+stat_t fw_get_fwb(nvObj_t *nv)
+{
+	nv->value = (float)fw.received;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t fw_set_fwb(nvObj_t *nv)
+{
+	uint8_t api_version;
+
+	if (_is_idle() == false) return (STAT_COMMAND_NOT_ACCEPTED);
+	if (xboot_get_api_version(&api_version) != XB_SUCCESS) return (STAT_FIRMWARE_UPDATE_UNAVAILABLE);
+	if (pgm_get_far_address(__data_load_end) > XB_APP_TEMP_START) return (STAT_FIRMWARE_UPDATE_UNAVAILABLE);
+	if (nv->value < 1) return (STAT_INPUT_LESS_THAN_MIN_VALUE);
+	if (nv->value > (XB_APP_TEMP_SIZE - FW_INSTALL_MARKER_LEN)) return (STAT_FILE_SIZE_EXCEEDED);
+
+	// remove the install marker of an earlier image so a reset during the transfer is harmless
+	fw.state = FW_STAGE_IDLE;
+	ritorno(_erase_if_used(XB_APP_TEMP_SIZE - FW_PAGE_SIZE));
+
+	fw.size = (uint32_t)nv->value;
+	fw.received = 0;
+	fw.state = FW_STAGE_RECEIVING;
+	return (STAT_OK);
+}
+
+/*
+ * fw_run_fwd() - receive image data
+ *
+ *	The chunk is checked whole before any of it is used, so a rejected chunk can be resent
+ *	as-is. It is written one page at a time: the bytes already in the page are read back
+ *	from flash, the rest is filled from the chunk and padded with 0xFF (blank), and the
+ *	page is erased and written. A failed page write abandons the transfer - start again
+ *	with fwb.
+ */
+
+stat_t fw_run_fwd(nvObj_t *nv)
+{
+	if (fw.state != FW_STAGE_RECEIVING) return (STAT_COMMAND_NOT_ACCEPTED);
+	if (nv->valuetype != TYPE_STRING) return (STAT_UNSUPPORTED_TYPE);
+
+	char_t *rd = *nv->stringp;
+	char_t *end;
+	uint32_t offset = strtoul((char *)rd, (char **)&end, 10);
+	if ((end == rd) || (*end != FW_DATA_SEPARATOR)) return (STAT_BAD_NUMBER_FORMAT);
+	if (offset != fw.received) return (STAT_INPUT_VALUE_RANGE_ERROR);
+	rd = end + 1;
+
+	uint16_t len = 0;
+	for (; rd[len] != NUL; len++) {
+		if (_hex_nibble(rd[len]) == 0xFF) return (STAT_BAD_NUMBER_FORMAT);
+	}
+	if ((len == 0) || (len & 1)) return (STAT_BAD_NUMBER_FORMAT);
+	len >>= 1;
+	if ((fw.received + len) > fw.size) return (STAT_FILE_SIZE_EXCEEDED);
+	if (_is_idle() == false) return (STAT_COMMAND_NOT_ACCEPTED);	// would write flash - resend when idle
+
+	uint8_t *page = (uint8_t *)cs.out_buf;
+	while (len > 0) {
+		uint16_t fill = fw.received % FW_PAGE_SIZE;			// bytes already in this page
+		uint32_t offset = fw.received - fill;
+		for (uint16_t i=0; i<fill; i++) {
+			page[i] = pgm_read_byte_far(XB_APP_TEMP_START + offset + i);
+		}
+		for (; (fill < FW_PAGE_SIZE) && (len > 0); fill++, len--, rd += 2) {
+			page[fill] = (_hex_nibble(rd[0]) << 4) | _hex_nibble(rd[1]);
+			fw.received++;
+		}
+		memset(&page[fill], 0xFF, FW_PAGE_SIZE - fill);
+		stat_t status = _write_page(offset, page);
+		if (status != STAT_OK) {
+			fw.state = FW_STAGE_IDLE;
+			return (status);
+		}
+	}
+	if (fw.received == fw.size) {
+		fw.state = FW_STAGE_RECEIVED;
+	}
+	nv->value = (float)fw.received;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/*
+ * fw_get_fwv() - get staging state
+ * fw_set_fwv() - verify the image CRC and mark it for install on the next reset
+ *
+ *	xboot checks the CRC of the whole temp section (with the marker bytes taken as blank)
+ *	before it installs, so any pages past the image are erased first and the CRC is carried
+ *	on over them.
+ */
+
+stat_t fw_get_fwv(nvObj_t *nv)
+{
+	nv->value = (float)fw.state;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t fw_set_fwv(nvObj_t *nv)
+{
+	if (fw.state != FW_STAGE_RECEIVED) return (STAT_COMMAND_NOT_ACCEPTED);
+	if (_is_idle() == false) return (STAT_COMMAND_NOT_ACCEPTED);
+
+	uint32_t offset = ((fw.size + FW_PAGE_SIZE - 1) / FW_PAGE_SIZE) * FW_PAGE_SIZE;
+	for (; offset < XB_APP_TEMP_SIZE; offset += FW_PAGE_SIZE) {
+		ritorno(_erase_if_used(offset));
+	}
+	uint16_t crc = 0;
+	for (offset = 0; offset < fw.size; offset++) {
+		crc = _crc16_update(crc, pgm_read_byte_far(XB_APP_TEMP_START + offset));
+	}
+	if (crc != (uint16_t)nv->value) {
+		fw.state = FW_STAGE_IDLE;
+		return (STAT_FIRMWARE_CRC_MISMATCH);
+	}
+	for (; offset < (XB_APP_TEMP_SIZE - FW_INSTALL_MARKER_LEN); offset++) {
+		crc = _crc16_update(crc, pgm_read_byte_far(XB_APP_TEMP_START + offset));
+	}
+	for (uint8_t i=0; i<FW_INSTALL_MARKER_LEN; i++) {
+		crc = _crc16_update(crc, 0xFF);
+	}
+	uint8_t sreg = SREG;
+	cli();
+	uint8_t ret = xboot_install_firmware(crc);
+	SREG = sreg;
+	ritorno(_xb_status(ret));
+	fw.state = FW_STAGE_INSTALLED;
+	return (STAT_OK);
+}
+
+#else // __ARM
+
+stat_t fw_get_fwb(nvObj_t *nv) { return (STAT_FUNCTION_IS_STUBBED);}
+stat_t fw_set_fwb(nvObj_t *nv) { return (STAT_FUNCTION_IS_STUBBED);}
+stat_t fw_run_fwd(nvObj_t *nv) { return (STAT_FUNCTION_IS_STUBBED);}
+stat_t fw_get_fwv(nvObj_t *nv) { return (STAT_FUNCTION_IS_STUBBED);}
+stat_t fw_set_fwv(nvObj_t *nv) { return (STAT_FUNCTION_IS_STUBBED);}
+
+#endif // __AVR
@@ -0,0 +1,59 @@
+/*
+ * fw_stage.h - background firmware staging through the xboot API
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FW_STAGE_H_ONCE
+#define FW_STAGE_H_ONCE
+
+#ifdef __AVR
+#include <avr/io.h>
+#define FW_PAGE_SIZE SPM_PAGESIZE			// flash page size (512 bytes on the xmega192/256)
+#else
+#define FW_PAGE_SIZE 1
+#endif
+#define FW_INSTALL_MARKER_LEN 6				// "XBIF" + CRC written at the end of the temp section
+#define FW_DATA_SEPARATOR ','				// separates the offset from the hex data
+
+enum fwStageState {
+	FW_STAGE_IDLE = 0,						// nothing staged
+	FW_STAGE_RECEIVING,						// image transfer in progress
+	FW_STAGE_RECEIVED,						// all bytes are in flash, waiting for verify
+	FW_STAGE_INSTALLED						// verified and marked for install on next reset
+};
+
+typedef struct fwStageSingleton {
+	magic_t magic_start;
+	uint8_t state;							// fwStageState
+	uint32_t size;							// image size in bytes
+	uint32_t received;						// bytes received and written (next expected offset)
+	magic_t magic_end;
+} fwStage_t;
+
+extern fwStage_t fw;
+
+/**** function prototypes ****/
+
+void fw_stage_init(void);
+
+stat_t fw_get_fwb(nvObj_t *nv);
+stat_t fw_set_fwb(nvObj_t *nv);
+stat_t fw_run_fwd(nvObj_t *nv);
+stat_t fw_get_fwv(nvObj_t *nv);
+stat_t fw_set_fwv(nvObj_t *nv);
+
+#endif // End of include guard: FW_STAGE_H_ONCE
@@ -21,6 +21,10 @@
 #include "controller.h"
 #include "gcode_parser.h"
 #include "canonical_machine.h"
+#include "plan_comp.h"
+#include "planner.h"
+#include "step_stream.h"
+#include "report.h"
 #include "spindle.h"
 #include "util.h"
 #include "xio.h"			// for char definitions
@@ -29,8 +33,15 @@
 extern "C"{
 #endif
 
+enum gcDeferredBlock {				  // parts of a block held back for cutter compensation
+	DEFER_NONE = 0,
+	DEFER_BLOCK,					  // run the entire block
+	DEFER_PROGRAM_FLOW				  // run the program stop or end (M0, M1, M2, M30, M60)
+};
+
 struct gcodeParserSingleton {	 	  // struct to manage globals
 	uint8_t modals[MODAL_GROUP_COUNT];// collects modal groups in a block
+	uint8_t deferred;				  // see gcDeferredBlock and gc_deferred_block_callback()
 }; struct gcodeParserSingleton gp;
 
 // local helper functions and macros
@@ -40,6 +51,8 @@ static stat_t _point(float value);
 static stat_t _validate_gcode_block(void);
 static stat_t _parse_gcode_block(char_t *line);	// Parse the block into the GN/GF structs
 static stat_t _execute_gcode_block(void);		// Execute the gcode block
+static void _execute_program_flow(void);		// Execute program stops and ends
+static bool _block_ends_comp_lookahead(void);
 
 #define SET_MODAL(m,parm,val) ({cm.gn.parm=val; cm.gf.parm=1; gp.modals[m]+=1; break;})
 #define SET_NON_MODAL(parm,val) ({cm.gn.parm=val; cm.gf.parm=1; break;})
@@ -60,6 +73,7 @@ stat_t gc_gcode_parser(char_t *block)
 
 	// don't process Gcode blocks if in alarmed state
 	if (cm.machine_state == MACHINE_ALARM) return (STAT_MACHINE_ALARMED);
+	if (ss_get_mode() == true) return (STAT_COMMAND_NOT_ACCEPTED);	// the host owns the steppers
 
 	_normalize_gcode_block(str, &com, &msg, &block_delete_flag);
 
@@ -226,6 +240,25 @@ static stat_t _validate_gcode_block()
 //		if (_axis_changed() == false)
 //		return (STAT_GCODE_AXIS_IS_MISSING);
 //	}
+
+	// Commands that can't run with cutter radius compensation. A G40 in the block turns it off first
+	uint8_t cutter_comp_mode = (cm.gf.cutter_comp_mode ? cm.gn.cutter_comp_mode : cm.gmx.cutter_comp_mode);
+	if (cutter_comp_mode != CUTTER_COMP_OFF) {
+		if ((cm.gf.tool_change == true) || (cm.gn.absolute_override == true)) {
+			return (STAT_CUTTER_COMPENSATION_NOT_ALLOWED);
+		}
+		switch (cm.gn.next_action) {
+			case NEXT_ACTION_SEARCH_HOME: case NEXT_ACTION_SET_ABSOLUTE_ORIGIN: case NEXT_ACTION_HOMING_NO_SET:
+			case NEXT_ACTION_GOTO_G28_POSITION: case NEXT_ACTION_GOTO_G30_POSITION: case NEXT_ACTION_STRAIGHT_PROBE:
+				return (STAT_CUTTER_COMPENSATION_NOT_ALLOWED);
+		}
+		if ((cm.gf.select_plane ? cm.gn.select_plane : cm.gm.select_plane) != CANON_PLANE_XY) {
+			return (STAT_GCODE_ACTIVE_PLANE_IS_INVALID);
+		}
+		if ((cm.gf.feed_rate_mode ? cm.gn.feed_rate_mode : cm.gm.feed_rate_mode) == INVERSE_TIME_MODE) {
+			return (STAT_GCODE_INVERSE_TIME_MODE_CANNOT_BE_USED);
+		}
+	}
 	return (STAT_OK);
 }
 
@@ -294,8 +327,17 @@ static stat_t _parse_gcode_block(char_t *buf)
 					}
 					break;
 				}
-				case 40: break;	// ignore cancel cutter radius compensation
-				case 49: break;	// ignore cancel tool length offset comp.
+				case 40: SET_MODAL (MODAL_GROUP_G7, cutter_comp_mode, CUTTER_COMP_OFF);
+				case 41: SET_MODAL (MODAL_GROUP_G7, cutter_comp_mode, CUTTER_COMP_LEFT);
+				case 42: SET_MODAL (MODAL_GROUP_G7, cutter_comp_mode, CUTTER_COMP_RIGHT);
+				case 43: {
+					switch (_point(value)) {
+						case 0: SET_MODAL (MODAL_GROUP_G8, tool_length_mode, true);
+						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+					}
+					break;
+				}
+				case 49: SET_MODAL (MODAL_GROUP_G8, tool_length_mode, false);
 				case 53: SET_NON_MODAL (absolute_override, true);
 				case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
 				case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
@@ -387,7 +429,9 @@ static stat_t _parse_gcode_block(char_t *buf)
 			case 'K': SET_NON_MODAL (arc_offset[2], value);
 			case 'R': SET_NON_MODAL (arc_radius, value);
 			case 'N': SET_NON_MODAL (linenum,(uint32_t)value);		// line number
-			case 'L': break;										// not used for anything
+			case 'L': SET_NON_MODAL (l_word, (uint8_t)trunc(value));	// G10 L1 (tool table) or L2 (coord offsets)
+			case 'H': SET_NON_MODAL (h_word, (uint8_t)trunc(value));	// G43 tool table index
+			case 'D': SET_NON_MODAL (d_word, (uint8_t)trunc(value));	// G41/G42 tool table index
 			default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 		}
 		if(status != STAT_OK) break;
@@ -434,12 +478,26 @@ static stat_t _parse_gcode_block(char_t *buf)
  *
  *	Values in gn are in original units and should not be unit converted prior
  *	to calling the canonical functions (which do the unit conversions)
+ *
+ *	Cutter radius compensation holds the last move until the next one is known. Commands
+ *	queued ahead of the motion (or instead of it) must run after the held move, so the
+ *	held move is flushed first. If that leaves compensated moves still to be issued (arcs
+ *	run from the main loop) the block is deferred and run by gc_deferred_block_callback().
+ *	Program stops and ends are handled the same way after the block's motion, and wait
+ *	the same way for a dogleg traverse that is still being issued (cm_dogleg_callback()).
  */
 
 static stat_t _execute_gcode_block()
 {
 	stat_t status = STAT_OK;
 
+	if ((cm_comp_holding() == true) && (_block_ends_comp_lookahead() == true)) {
+		ritorno(cm_comp_flush());
+		if (cm_comp_busy() == true) {
+			gp.deferred = DEFER_BLOCK;
+			return (STAT_OK);
+		}
+	}
 	cm_set_model_linenum(cm.gn.linenum);
 	EXEC_FUNC(cm_set_feed_rate_mode, feed_rate_mode);
 	EXEC_FUNC(cm_set_feed_rate, feed_rate);
@@ -462,8 +520,12 @@ static stat_t _execute_gcode_block()
 	}
 	EXEC_FUNC(cm_select_plane, select_plane);
 	EXEC_FUNC(cm_set_units_mode, units_mode);
-	//--> cutter radius compensation goes here
-	//--> cutter length compensation goes here
+	if (cm.gf.cutter_comp_mode == true) {					// G40, G41, G42 - D defaults to the current tool
+		ritorno(cm_set_cutter_comp(cm.gn.cutter_comp_mode, (cm.gf.d_word ? cm.gn.d_word : cm.gm.tool)));
+	}
+	if (cm.gf.tool_length_mode == true) {					// G43, G49 - H defaults to the current tool
+		ritorno(cm_set_tool_length_offset(cm.gn.tool_length_mode, (cm.gf.h_word ? cm.gn.h_word : cm.gm.tool)));
+	}
 	EXEC_FUNC(cm_set_coord_system, coord_system);
 	EXEC_FUNC(cm_set_path_control, path_control);
 	EXEC_FUNC(cm_set_distance_mode, distance_mode);
@@ -481,7 +543,14 @@ static stat_t _execute_gcode_block()
 
 		case NEXT_ACTION_STRAIGHT_PROBE: { status = cm_straight_probe(cm.gn.target, cm.gf.target); break;}			// G38.2
 
-		case NEXT_ACTION_SET_COORD_DATA: { status = cm_set_coord_offsets(cm.gn.parameter, cm.gn.target, cm.gf.target); break;}
+		case NEXT_ACTION_SET_COORD_DATA: {
+			if (cm.gn.l_word == 1) {								// G10 L1 - tool table
+				status = cm_set_tool_table(cm.gn.parameter, cm.gn.target, cm.gf.target, cm.gn.arc_radius, fp_TRUE(cm.gf.arc_radius));
+			} else {												// G10 L2 - coordinate offsets
+				status = cm_set_coord_offsets(cm.gn.parameter, cm.gn.target, cm.gf.target);
+			}
+			break;
+		}
 		case NEXT_ACTION_SET_ORIGIN_OFFSETS: { status = cm_set_origin_offsets(cm.gn.target, cm.gf.target); break;}
 		case NEXT_ACTION_RESET_ORIGIN_OFFSETS: { status = cm_reset_origin_offsets(); break;}
 		case NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS: { status = cm_suspend_origin_offsets(); break;}
@@ -504,15 +573,86 @@ static stat_t _execute_gcode_block()
 
 	// do the program stops and ends : M0, M1, M2, M30, M60
 	if (cm.gf.program_flow == true) {
-		if (cm.gn.program_flow == PROGRAM_STOP) {
-			cm_program_stop();
-		} else {
-			cm_program_end();
+		if (cm_comp_holding() == true) {		// the held move must run before the stop
+			ritorno(cm_comp_flush());
+			if (cm_comp_busy() == true) {
+				gp.deferred = DEFER_PROGRAM_FLOW;
+				return (status);
+			}
 		}
+		if (cm_dogleg_busy() == true) {			// so must the rest of a dogleg traverse
+			gp.deferred = DEFER_PROGRAM_FLOW;
+			return (status);
+		}
+		_execute_program_flow();
 	}
 	return (status);
 }
 
+static void _execute_program_flow()
+{
+	if (cm.gn.program_flow == PROGRAM_STOP) {
+		cm_program_stop();
+	} else {
+		cm_program_end();
+	}
+}
+
+/*
+ * _block_ends_comp_lookahead() - true if the block does more than compensated motion
+ *
+ *	These blocks queue commands ahead of their motion or change compensation itself.
+ *	Blocks that only set the model (feed rate, units, distance mode...) don't count.
+ *	Program stops and ends are not included as they run after the block's motion.
+ */
+static bool _block_ends_comp_lookahead()
+{
+	if (cm.gn.next_action != NEXT_ACTION_DEFAULT) return (true);
+	if ((cm.gn.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) && (cm.gn.motion_mode != MOTION_MODE_STRAIGHT_FEED) &&
+		(cm.gn.motion_mode != MOTION_MODE_CW_ARC) && (cm.gn.motion_mode != MOTION_MODE_CCW_ARC)) return (true);
+
+	return ((fp_TRUE(cm.gf.spindle_speed)) || (fp_TRUE(cm.gf.spindle_override_factor)) ||
+			(fp_TRUE(cm.gf.feed_rate_override_factor)) || (fp_TRUE(cm.gf.traverse_override_factor)) ||
+			(cm.gf.tool_select) || (cm.gf.tool_change) || (cm.gf.spindle_mode) ||
+			(cm.gf.mist_coolant) || (cm.gf.flood_coolant) ||
+			(cm.gf.feed_rate_override_enable) || (cm.gf.traverse_override_enable) ||
+			(cm.gf.spindle_override_enable) || (cm.gf.override_enables) ||
+			(cm.gf.select_plane) || (cm.gf.cutter_comp_mode) || (cm.gf.tool_length_mode) ||
+			(cm.gf.coord_system) || (cm.gf.absolute_override));
+}
+
+/*
+ * gc_deferred_block_callback() - run a block held back for cutter compensation
+ *
+ *	Runs from the main loop once compensated moves have been issued (the arc and
+ *	cutter compensation callbacks return EAGAIN until then). Command dispatch is
+ *	blocked in the meantime so gn and gf still hold the block. The block has already
+ *	been acknowledged, so errors are reported as exceptions.
+ */
+stat_t gc_deferred_block_callback()
+{
+	if (gp.deferred == DEFER_NONE) {
+		return (STAT_NOOP);
+	}
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+		return (STAT_EAGAIN);
+	}
+	uint8_t deferred = gp.deferred;
+	gp.deferred = DEFER_NONE;
+	if (cm.machine_state == MACHINE_ALARM) {
+		return (STAT_OK);								// drop the block
+	}
+	if (deferred == DEFER_PROGRAM_FLOW) {
+		_execute_program_flow();
+		return (STAT_OK);
+	}
+	stat_t status = _execute_gcode_block();
+	if (status != STAT_OK) {
+		rpt_exception(status);
+	}
+	return (STAT_OK);
+}
+
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
@@ -28,6 +28,7 @@ extern "C"{
  * Global Scope Functions
  */
 stat_t gc_gcode_parser(char_t *block);
+stat_t gc_deferred_block_callback(void);
 stat_t gc_get_gc(nvObj_t *nv);
 stat_t gc_run_gc(nvObj_t *nv);
 
@@ -55,6 +55,7 @@
 #include "hardware.h"
 //#include "switch.h"
 #include "gpio.h"
+#include "pwm.h"
 #include "canonical_machine.h"
 #include "xio.h"						// signals
 
@@ -155,9 +156,12 @@ void gpio_led_toggle(uint8_t led)
  * gpio_set_bit_on() - turn bit on
  * gpio_set_bit_off() - turn bit on
  *
- *	These functions have an inner remap depending on what hardware is running
+ *	These functions have an inner remap depending on what hardware is running.
+ *	Set and clear skip any bits reserved by gpio_reserve_bit().
  */
 
+static uint8_t gpio_reserved;	// output bits taken over by another function (PSO)
+
 uint8_t gpio_read_bit(uint8_t b)
 {
 	if (b & 0x08) { return (hw.out_port[0]->IN & GPIO1_OUT_BIT_bm); }
@@ -169,6 +173,7 @@ uint8_t gpio_read_bit(uint8_t b)
 
 void gpio_set_bit_on(uint8_t b)
 {
+	b &= ~gpio_reserved;
 	if (b & 0x08) { hw.out_port[0]->OUTSET = GPIO1_OUT_BIT_bm; }
 	if (b & 0x04) { hw.out_port[1]->OUTSET = GPIO1_OUT_BIT_bm; }
 	if (b & 0x02) { hw.out_port[2]->OUTSET = GPIO1_OUT_BIT_bm; }
@@ -177,8 +182,28 @@ void gpio_set_bit_on(uint8_t b)
 
 void gpio_set_bit_off(uint8_t b)
 {
+	b &= ~gpio_reserved;
 	if (b & 0x08) { hw.out_port[0]->OUTCLR = GPIO1_OUT_BIT_bm; }
 	if (b & 0x04) { hw.out_port[1]->OUTCLR = GPIO1_OUT_BIT_bm; }
 	if (b & 0x02) { hw.out_port[2]->OUTCLR = GPIO1_OUT_BIT_bm; }
 	if (b & 0x01) { hw.out_port[3]->OUTCLR = GPIO1_OUT_BIT_bm; }
 }
+
+/*
+ * gpio_reserve_bit() - take output bits away from spindle, coolant and the LEDs
+ *
+ *	Used by PSO, which drives its output directly from the DDA ISR. Pass 0 to release.
+ *	The spindle PWM timer is also disconnected if it drives a reserved bit.
+ */
+
+void gpio_reserve_bit(uint8_t b)
+{
+	gpio_reserved = b;
+#ifdef __AVR
+	uint8_t pwm_bit = 0;
+	for (uint8_t i=0; i<4; i++) {
+		if (hw.out_port[i] == &PORT_PWM1) pwm_bit = (0x08 >> i);
+	}
+	pwm_set_output(PWM_1, ((b & pwm_bit) == 0));
+#endif
+}
@@ -39,5 +39,6 @@ void gpio_led_toggle(uint8_t led);
 uint8_t gpio_read_bit(uint8_t b);
 void gpio_set_bit_on(uint8_t b);
 void gpio_set_bit_off(uint8_t b);
+void gpio_reserve_bit(uint8_t b);
 
 #endif
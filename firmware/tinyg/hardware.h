@@ -178,6 +178,8 @@ enum cfgPortBits {			// motor control port bit positions
 
 /* Bit assignments for GPIO1_OUTs for spindle, PWM and coolant */
 
+#define GPIO1_OUTPUTS		4			// out_port[0..3] - one GPIO1 output bit per axis port
+
 #define SPINDLE_BIT			0x08		// spindle on/off
 #define SPINDLE_DIR			0x04		// spindle direction, 1=CW, 0=CCW
 #define SPINDLE_PWM			0x02		// spindle PWMs output bit
@@ -197,9 +199,10 @@ enum cfgPortBits {			// motor control port bit positions
 #define TIMER_DWELL	 		TCD0		// Dwell timer	(see stepper.h)
 #define TIMER_LOAD			TCE0		// Loader timer	(see stepper.h)
 #define TIMER_EXEC			TCF0		// Exec timer	(see stepper.h)
-#define TIMER_5				TCC1		// unallocated timer
+#define TIMER_KIN			TCC1		// Kinematics cost timer (see kinematics.c)
 #define TIMER_PWM1			TCD1		// PWM timer #1 (see pwm.c)
 #define TIMER_PWM2			TCE1		// PWM timer #2	(see pwm.c)
+#define PORT_PWM1			PORTD		// PWM timer #1 drives the GPIO1 output bit on this port
 
 /* Timer setup for stepper and dwells */
 
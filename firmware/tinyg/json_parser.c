@@ -31,6 +31,8 @@
 #include "json_parser.h"
 #include "text_parser.h"
 #include "canonical_machine.h"
+#include "gcode_parser.h"
+#include "planner.h"
 #include "report.h"
 #include "util.h"
 #include "xio.h"					// for char definitions
@@ -45,15 +47,15 @@ jsSingleton_t js;
 
 /**** local scope stuff ****/
 
-static stat_t _json_parser_kernal(char_t *str);
+static stat_t _json_parser_kernal(char_t *str, uint8_t restricted);
 static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth);
-static stat_t _normalize_json_string(char_t *str, uint16_t size);
 
 /****************************************************************************
  * json_parser() - exposed part of JSON parser
+ * json_parser_restricted() - JSON parser for the secondary (pendant) input
+ * json_gcode_parser() - run a bare Gcode block received in JSON mode
  * _json_parser_kernal()
- * _normalize_json_string()
- * _get_nv_pair_strict()
+ * _get_nv_pair()
  *
  *	This is a dumbed down JSON parser to fit in limited memory with no malloc
  *	or practical way to do recursion ("depth" tracks parent/child levels).
@@ -69,8 +71,7 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
  *	  "value" can be a string, number, true, false, or null (2 types)
  *
  *	Numbers
- *	  - number values are not quoted and can start with a digit or -.
- *	  - numbers cannot start with + or . (period)
+ *	  - number values are not quoted and can start with a digit, -, + or . (period)
  *	  - exponentiated numbers are handled OK.
  *	  - hexadecimal or other non-decimal number bases are not supported
  *
@@ -89,12 +90,51 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
 
 void json_parser(char_t *str)
 {
-	stat_t status = _json_parser_kernal(str);
+	stat_t status = _json_parser_kernal(str, false);
 	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
 	sr_request_status_report(SR_IMMEDIATE_REQUEST); // generate incremental status report to show any changes
 }
 
-static stat_t _json_parser_kernal(char_t *str)
+/*
+ *	json_parser_restricted() allows gets of any value but only sets that start a jog,
+ *	and those only while the machine is idle. Other sets are refused with
+ *	STAT_COMMAND_NOT_ACCEPTED. See _secondary_dispatch() in controller.c.
+ */
+void json_parser_restricted(char_t *str)
+{
+	stat_t status = _json_parser_kernal(str, true);
+	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+}
+
+/*
+ *	json_gcode_parser() is the fast path for plain Gcode lines in JSON mode. It produces
+ *	the same response as {"gc":"<block>"} without wrapping the block in JSON and parsing
+ *	it back out. The block is only copied into the nv list if it will be echoed.
+ */
+void json_gcode_parser(char_t *block)
+{
+	stat_t status = STAT_OK;
+	nvObj_t *nv = nv_reset_nv_list();				// get a fresh nvObj list
+
+	strcpy(nv->token, "gc");						// the response needs the gc object even if empty
+	if (js.echo_json_gcode_block == true) {		// echo shows the block as the parser leaves it
+		if ((status = nv_copy_string(nv, block)) == STAT_OK) {
+			nv->valuetype = TYPE_STRING;
+			block = *nv->stringp;
+		}
+	}
+	if (status == STAT_OK) {
+		if (cm.machine_state == MACHINE_ALARM) {
+			status = STAT_MACHINE_ALARMED;
+		} else {
+			status = gc_gcode_parser(block);
+		}
+	}
+	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+	sr_request_status_report(SR_IMMEDIATE_REQUEST); // generate incremental status report to show any changes
+}
+
+static stat_t _json_parser_kernal(char_t *str, uint8_t restricted)
 {
 	stat_t status;
 	int8_t depth;
@@ -102,7 +142,8 @@ static stat_t _json_parser_kernal(char_t *str)
 	char_t group[GROUP_LEN+1] = {""};				// group identifier - starts as NUL
 	int8_t i = NV_BODY_LEN;
 
-	ritorno(_normalize_json_string(str, JSON_OUTPUT_STRING_MAX));	// return if error
+	if (strlen(str) > JSON_OUTPUT_STRING_MAX)
+        return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
 
 	// parse the JSON command into the nv body
 	do {
@@ -134,58 +175,36 @@ static stat_t _json_parser_kernal(char_t *str)
 	if (nv->valuetype == TYPE_NULL){				// means GET the value
 		ritorno(nv_get(nv));						// ritorno returns w/status on any errors
 	} else {
-		if (cm.machine_state == MACHINE_ALARM)
-            return (STAT_MACHINE_ALARMED);
+		if (cm.machine_state == MACHINE_ALARM)
+            return (STAT_MACHINE_ALARMED);
+		if ((restricted == true) && ((strncmp(nv->token, "jog", 3) != 0) || (cm.cycle_state != CYCLE_OFF) ||
+			(mp_planner_is_empty() == false) || (cm_get_runtime_busy() == true))) {
+			return (STAT_COMMAND_NOT_ACCEPTED);
+		}
 		ritorno(nv_set(nv));						// set value or call a function (e.g. gcode)
 		nv_persist(nv);
 	}
 	return (STAT_OK);								// only successful commands exit through this point
 }
 
-/*
- * _normalize_json_string - normalize a JSON string in place
- *
- *	Validate string size limits, remove all whitespace and convert
- *	to lower case, with the exception of gcode comments
- */
-
-static stat_t _normalize_json_string(char_t *str, uint16_t size)
-{
-	char_t *wr;								// write pointer
-	uint8_t in_comment = false;
-
-	if (strlen(str) > size)
-        return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
-
-	for (wr = str; *str != NUL; str++) {
-		if (!in_comment) {					// normal processing
-			if (*str == '(') in_comment = true;
-			if ((*str <= ' ') || (*str == DEL)) continue; // toss ctrls, WS & DEL
-			*wr++ = tolower(*str);
-		} else {							// Gcode comment processing
-			if (*str == ')') in_comment = false;
-			*wr++ = *str;
-		}
-	}
-	*wr = NUL;
-	return (STAT_OK);
-}
-
 /*
  * _get_nv_pair() - get the next name-value pair w/relaxed JSON rules. Also parses strict JSON.
  *
  *	Parse the next statement and populate the command object (nvObj).
  *
+ *	This is a single pass tokenizer that works directly on the raw input line. Whitespace
+ *	and control characters are skipped and names and bare values are lowercased as they
+ *	are read. String values are compacted in place using the rules of the old normalizer:
+ *	lower case with whitespace removed, except Gcode comments, which are copied verbatim.
+ *
  *	Leaves string pointer (str) on the first character following the object.
- *	Which is the character just past the ',' separator if it's a multi-valued
- *	object or the terminating NUL if single object or the last in a multi.
+ *	Which is the ',' separator if it's a multi-valued object or the terminating
+ *	NUL if single object or the last in a multi.
  *
  *	Keeps track of tree depth and closing braces as much as it has to.
  *	If this were to be extended to track multiple parents or more than two
  *	levels deep it would have to track closing curlies - which it does not.
  *
- *	ASSUMES INPUT STRING HAS FIRST BEEN NORMALIZED BY _normalize_json_string()
- *
  *	If a group prefix is passed in it will be pre-pended to any name parsed
  *	to form a token string. For example, if "x" is provided as a group and
  *	"fr" is found in the name string the parser will search for "xfr" in the
@@ -194,109 +213,134 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size)
 /*	RELAXED RULES
  *
  *	Quotes are accepted but not needed on names
- *	Quotes are required for string values
- *
+ *	Quotes are required for string values
+ *
  *	See build 406.xx or earlier for strict JSON parser - deleted in 407.03
- */
-
-#define MAX_PAD_CHARS 8
-#define MAX_NAME_CHARS 32
-
+ */
+
+#define MAX_PAD_CHARS 8
+#define MAX_NAME_CHARS 32
+
+#define _is_json_ws(c) (((c) <= ' ') || ((c) == DEL))	// NUL also matches - test for it first
+
+static char_t *_skip_ws(char_t *str)
+{
+	while ((*str != NUL) && _is_json_ws(*str)) { str++;}
+	return (str);
+}
+
 static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 {
 	uint8_t i;
+	uint8_t len = 0;
+	char_t *str = *pstr;
 	char_t *tmp;
-	char_t leaders[] = {"{,\""};				// open curly, quote and leading comma
-	char_t separators[] = {":\""};				// colon and quote
-	char_t terminators[] = {"},\""};			// close curly, comma and quote
-	char_t value[] = {"{\".-+"};				// open curly, quote, period, minus and plus
+	char_t value[] = {"{[\".-+"};				// open curly, open bracket, quote, period, minus and plus
 
 	nv_reset_nv(nv);							// wipes the object and sets the depth
 
 	// --- Process name part ---
-	// Find, terminate and set pointers for the name. Allow for leading and trailing name quotes.
-	char_t * name = *pstr;
-	for (i=0; true; i++, (*pstr)++) {
-		if (strchr(leaders, (int)**pstr) == NULL) { 		// find leading character of name
-			name = (*pstr)++;
-			break;
-		}
-		if (i == MAX_PAD_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
+	// Skip leading curlies, commas and whitespace, and an opening name quote if present
+	for (i=0; true; i++, str++) {
+		str = _skip_ws(str);
+		if ((*str != '{') && (*str != ',') && (*str != '\"'))
+			break;
+		if (i == MAX_PAD_CHARS)
+            return (STAT_JSON_SYNTAX_ERROR);
+	}
+
+	// Read the name up to the separator, lowercasing it into the token
+	for (i=0; (*str != ':') && (*str != '\"'); i++, str++) {
+		if ((*str == NUL) || (i == MAX_NAME_CHARS))
+            return (STAT_JSON_SYNTAX_ERROR);
+		if (_is_json_ws(*str))
+			continue;
+		if (len == TOKEN_LEN)
+			return (STAT_UNRECOGNIZED_NAME);	// too long to be a token
+		nv->token[len++] = tolower(*str);
+	}
+	nv->token[len] = NUL;
+	if (*str == '\"') { str++;}					// step over closing name quote
+
+	// --- Process value part ---  (organized from most to least frequently encountered)
+
+	// Find the start of the value part - skips the colon and any whitespace
+	for (i=0; true; i++, str++) {
+		str = _skip_ws(str);
+		if ((*str == NUL) || isalnum((int)*str) || (strchr(value, (int)*str) != NULL))
+			break;
+		if (i == MAX_PAD_CHARS)
+            return (STAT_JSON_SYNTAX_ERROR);
+	}
 
-	// Find the end of name, NUL terminate and copy token
-	for (i=0; true; i++, (*pstr)++) {
-		if (strchr(separators, (int)**pstr) != NULL) {
-			*(*pstr)++ = NUL;
-			strncpy(nv->token, name, TOKEN_LEN+1);			// copy the string to the token
-			break;
-		}
-		if (i == MAX_NAME_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
-
-	// --- Process value part ---  (organized from most to least frequently encountered)
-
-	// Find the start of the value part
-	for (i=0; true; i++, (*pstr)++) {
-		if (isalnum((int)**pstr)) break;
-		if (strchr(value, (int)**pstr) != NULL) break;
-		if (i == MAX_PAD_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
-
 	// nulls (gets)
-	if ((**pstr == 'n') || ((**pstr == '\"') && (*(*pstr+1) == '\"'))) { // process null value
+	if ((tolower(*str) == 'n') || ((*str == '\"') && (*(str+1) == '\"'))) { // process null value
 		nv->valuetype = TYPE_NULL;
 		nv->value = TYPE_NULL;
+		if (*str == '\"') { str += 2;}			// step over the empty string
 
 	// numbers
-	} else if (isdigit(**pstr) || (**pstr == '-')) {// value is a number
-		nv->value = (float)strtod(*pstr, &tmp);	// tmp is the end pointer
-		if(tmp == *pstr)
+	} else if (isdigit((int)*str) || (*str == '-') || (*str == '+') || (*str == '.')) {
+		nv->value = (float)strtod((char *)str, (char **)&tmp);	// tmp is the end pointer
+		if (tmp == str)
             return (STAT_BAD_NUMBER_FORMAT);
 		nv->valuetype = TYPE_FLOAT;
+		str = tmp;
 
 	// object parent
-	} else if (**pstr == '{') {
+	} else if (*str == '{') {
 		nv->valuetype = TYPE_PARENT;
 //		*depth += 1;							// nv_reset_nv() sets the next object's level so this is redundant
-		(*pstr)++;
+		*pstr = ++str;
 		return(STAT_EAGAIN);					// signal that there is more to parse
 
-	// strings
-	} else if (**pstr == '\"') { 				// value is a string
-		(*pstr)++;
+	// strings - compact in place: lowercase and strip whitespace outside of Gcode comments
+	} else if (*str == '\"') {
+		uint8_t in_comment = false;
+		char_t *wr = ++str;
+		tmp = str;								// start of the string value
+		for (; *str != '\"'; str++) {
+			if (*str == NUL)
+                return (STAT_JSON_SYNTAX_ERROR);// no closing quote
+			if (!in_comment) {
+				if (*str == '(') in_comment = true;
+				if (_is_json_ws(*str)) continue;// toss ctrls, WS & DEL
+				*wr++ = tolower(*str);
+			} else {
+				if (*str == ')') in_comment = false;
+				*wr++ = *str;
+			}
+		}
+		*wr = NUL;								// may overwrite the closing quote...
+		str++;									//...which has already been consumed
 		nv->valuetype = TYPE_STRING;
-		if ((tmp = strchr(*pstr, '\"')) == NULL)
-            return (STAT_JSON_SYNTAX_ERROR);    // find the end of the string
-		*tmp = NUL;
-
-		// if string begins with 0x it might be data, needs to be at least 3 chars long
-		if( strlen(*pstr)>=3 && (*pstr)[0]=='0' && (*pstr)[1]=='x')
-		{
-			uint32_t *v = (uint32_t*)&nv->value;
-			*v = strtoul((const char *)*pstr, 0L, 0);
-			nv->valuetype = TYPE_DATA;
-		} else {
-			ritorno(nv_copy_string(nv, *pstr));
-		}
-
-		*pstr = ++tmp;
+
+		// a string that compacts to nothing is a null, same as ""
+		if (wr == tmp) {
+			nv->valuetype = TYPE_NULL;
+			nv->value = TYPE_NULL;
+
+		// if string begins with 0x it might be data, needs to be at least 3 chars long
+		} else if ((wr - tmp) >= 3 && tmp[0]=='0' && tmp[1]=='x') {
+			uint32_t *v = (uint32_t*)&nv->value;
+			*v = strtoul((const char *)tmp, 0L, 0);
+			nv->valuetype = TYPE_DATA;
+		} else {
+			ritorno(nv_copy_string(nv, tmp));
+		}
 
 	// boolean true/false
-	} else if (**pstr == 't') {
+	} else if (tolower(*str) == 't') {
 		nv->valuetype = TYPE_BOOL;
 		nv->value = true;
-	} else if (**pstr == 'f') {
+	} else if (tolower(*str) == 'f') {
 		nv->valuetype = TYPE_BOOL;
 		nv->value = false;
 
 	// arrays
-	} else if (**pstr == '[') {
+	} else if (*str == '[') {
 		nv->valuetype = TYPE_ARRAY;
-		ritorno(nv_copy_string(nv, *pstr));		// copy array into string for error displays
+		ritorno(nv_copy_string(nv, str));		// copy array into string for error displays
 		return (STAT_UNSUPPORTED_TYPE);	        // return error as the parser doesn't do input arrays yet
 
 	// general error condition
@@ -304,18 +348,17 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
         return (STAT_JSON_SYNTAX_ERROR);	    // ill-formed JSON
     }
 
-	// process comma separators and end curlies
-	if ((*pstr = strpbrk(*pstr, terminators)) == NULL) { // advance to terminator or err out
-		return (STAT_JSON_SYNTAX_ERROR);
-	}
-	if (**pstr == '}') {
+	// process comma separators and end curlies - skips the tail of bare words (e.g. "rue")
+	// A missing final curly is tolerated; the end of the line also ends the object
+	while ((*str != '}') && (*str != ',') && (*str != NUL)) { str++;}
+	if (*str == '}') {
 		*depth -= 1;							// pop up a nesting level
-		(*pstr)++;								// advance to comma or whatever follows
+		str = _skip_ws(str+1);					// advance to comma or whatever follows
 	}
-	if (**pstr == ',')
+	*pstr = str;
+	if (*str == ',')
         return (STAT_EAGAIN);                   // signal that there is more to parse
 
-	(*pstr)++;
 	return (STAT_OK);							// signal that parsing is complete
 }
 
@@ -436,8 +479,8 @@ void json_print_object(nvObj_t *nv)
 	return;
 #endif
 
-	json_serialize(nv, cs.out_buf, sizeof(cs.out_buf));
-	fprintf(stderr, "%s", (char *)cs.out_buf);
+	int16_t strcount = json_serialize(nv, cs.out_buf, sizeof(cs.out_buf));
+	if (strcount > 0) xio_write_stderr((char *)cs.out_buf, strcount);
 }
 
 /*
@@ -544,8 +587,8 @@ void json_print_response(uint8_t status)
 	strcpy(tail, cs.out_buf + strcount + 1);				// save the json termination
 
 	while (cs.out_buf[strcount2] != ',') { strcount2--; }// find start of checksum
-	sprintf((char *)cs.out_buf + strcount2 + 1, "%d%s", compute_checksum(cs.out_buf, strcount2), tail);
-	fprintf(stderr, "%s", cs.out_buf);
+	strcount = sprintf((char *)cs.out_buf + strcount2 + 1, "%d%s", compute_checksum(cs.out_buf, strcount2), tail);
+	xio_write_stderr((char *)cs.out_buf, strcount2 + 1 + strcount);
 }
 
 /***********************************************************************************
@@ -605,6 +648,181 @@ void js_print_fs(nvObj_t *nv) { text_print_ui8(nv, fmt_fs);}
 
 #endif // __TEXT_MODE
 
+/***********************************************************************************
+ * UNIT TESTS
+ *
+ *	Define __UNIT_TESTS and __UNIT_TEST_JSON to run these at startup (see JSON_UNITS). They only call
+ *	the tokenizer and json_serialize(). Names are not looked up and nothing is
+ *	executed, so they can run on a live machine or a host build.
+ *
+ *	_js_round_trip()  - every case must tokenize to its expected status and (relaxed)
+ *						serialization. Reparsing the relaxed and the strict serialization
+ *						must give the same strict and relaxed output again.
+ *	_js_fuzz()		  - mutates the cases with a fixed pseudo-random sequence. The
+ *						tokenizer must stop inside the line and not write past it.
+ *	_js_throughput()  - tokenizes the test_008_json.h lines repeatedly and reports
+ *						lines/sec. The time includes copying each line out of FLASH.
+ ***********************************************************************************/
+
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_JSON)
+
+#ifdef __CANNED_TESTS
+extern const char test_json[] PROGMEM;		// already linked in by test.c
+#else
+#include "tests/test_008_json.h"
+#endif
+
+#define JSON_TEST_LEN 80					// longest test line + margin
+#define JSON_FUZZ_LINES 2000
+#define JSON_SPEED_PASSES 20
+
+typedef struct jsTestCase {
+	const char *in;
+	stat_t status;
+	const char *out;						// relaxed serialization if status is STAT_OK
+} jsTestCase_t;
+
+static const jsTestCase_t js_cases[] = {
+	{ "{\"gc\":\"g0x10y20\"}",					STAT_OK, "{gc:\"g0x10y20\"}\n" },
+	{ "{gc:\"G0 X10 (Msg Hello World)\"}",		STAT_OK, "{gc:\"g0x10(Msg Hello World)\"}\n" },
+	{ " { \"XVM\" : 1200 } ",					STAT_OK, "{xvm:1200.000}\n" },
+	{ "{\"sr\":{\"posx\":1.5,\"posy\":-0.25}}",	STAT_OK, "{sr:{posx:1.500,posy:-0.250}}\n" },
+	{ "{sr:{posx:t,posy:n,stat:\"\"}}",			STAT_OK, "{sr:{posx:true,posy:null,stat:null}}\n" },
+	{ "{xvm:null}",								STAT_OK, "{xvm:null}\n" },
+	{ "{\"ej\":false}",							STAT_OK, "{ej:false}\n" },
+	{ "{\"id\":\"0x1f\"}",						STAT_OK, "{id:\"0x1f\"}\n" },
+	{ "{a:+.5,\"b\":2}",						STAT_OK, "{a:0.500,b:2.000}\n" },
+	{ "{xvm:10",								STAT_OK, "{xvm:10.000}\n" },
+	{ "{\"xvm\":[1,2]}",						STAT_UNSUPPORTED_TYPE, NULL },
+	{ "{\"gc\":\"g0",							STAT_JSON_SYNTAX_ERROR, NULL },
+	{ "{xvm}",									STAT_JSON_SYNTAX_ERROR, NULL },
+	{ "{abcdefgh:1}",							STAT_UNRECOGNIZED_NAME, NULL },
+	{ "{xvm:-}",								STAT_BAD_NUMBER_FORMAT, NULL },
+	{ NULL, STAT_OK, NULL }
+};
+
+static char_t js_line[JSON_TEST_LEN+1];		// +1 is a guard byte for the fuzzer
+static char_t js_relaxed[JSON_TEST_LEN];
+static char_t js_strict[JSON_TEST_LEN];
+static char_t js_check[JSON_TEST_LEN];
+
+static stat_t _js_tokenize(char_t *str, char_t **stop)
+{
+	stat_t status;
+	int8_t depth;
+	nvObj_t *nv = nv_reset_nv_list();
+	int8_t i = NV_BODY_LEN;
+
+	do {
+		if (--i == 0) break;
+		if ((status = _get_nv_pair(nv, &str, &depth)) > STAT_EAGAIN) break;
+		if (nv->valuetype == TYPE_FLOAT) { nv->precision = 3;}
+		if ((nv = nv->nx) == NULL) break;
+	} while (status != STAT_OK);
+	*stop = str;
+	return ((i == 0) || (nv == NULL) ? STAT_JSON_TOO_MANY_PAIRS : status);
+}
+
+static stat_t _js_reparse(char_t *out, const char_t *in, uint8_t syntax)
+{
+	char_t *stop;
+	stat_t status;
+
+	strncpy(js_line, in, JSON_TEST_LEN);
+	if ((status = _js_tokenize(js_line, &stop)) != STAT_OK) return (status);
+	js.json_syntax = syntax;
+	json_serialize(nv_body, out, JSON_TEST_LEN);
+	return (STAT_OK);
+}
+
+static void _js_round_trip()
+{
+	char_t *stop;
+
+	for (const jsTestCase_t *t = js_cases; t->in != NULL; t++) {
+		strncpy(js_line, t->in, JSON_TEST_LEN);
+		stat_t status = _js_tokenize(js_line, &stop);
+		ut_check(PSTR("status"), t->in, status == t->status);
+		if ((status != STAT_OK) || (t->status != STAT_OK)) continue;
+
+		js.json_syntax = JSON_SYNTAX_RELAXED;
+		json_serialize(nv_body, js_relaxed, JSON_TEST_LEN);
+		js.json_syntax = JSON_SYNTAX_STRICT;
+		json_serialize(nv_body, js_strict, JSON_TEST_LEN);
+		ut_check(PSTR("parse"), t->in, strcmp(js_relaxed, t->out) == 0);
+
+		ut_check(PSTR("strict to relaxed"), t->in, (_js_reparse(js_check, js_strict, JSON_SYNTAX_RELAXED) == STAT_OK) &&
+			(strcmp(js_check, js_relaxed) == 0));
+		ut_check(PSTR("relaxed to strict"), t->in, (_js_reparse(js_check, js_relaxed, JSON_SYNTAX_STRICT) == STAT_OK) &&
+			(strcmp(js_check, js_strict) == 0));
+	}
+}
+
+static void _js_fuzz()
+{
+	static const char mutants[] = "{}[]\":,.-+ 0en(";
+	uint32_t seed = 1;
+	char_t *stop;
+	uint8_t cases = 0;
+
+	while (js_cases[cases].in != NULL) { cases++;}
+	for (uint16_t n=0; n < JSON_FUZZ_LINES; n++) {
+		seed = seed * 1103515245 + 12345;
+		strncpy(js_line, js_cases[(seed >> 16) % cases].in, JSON_TEST_LEN);
+		js_line[JSON_TEST_LEN] = '#';
+		uint8_t len = strlen(js_line);
+		for (uint8_t m = (seed >> 8) % 4; m <= 3; m++) {
+			seed = seed * 1103515245 + 12345;
+			uint8_t c = (seed >> 16) & 0xFF;
+			js_line[(seed >> 8) % len] = ((c & 1) ? mutants[c % (sizeof(mutants)-1)] : (c | 1));
+		}
+		if ((seed >> 24) < 32) { js_line[(seed >> 16) % len] = NUL;}	// truncate some lines
+		len = strlen(js_line);
+		_js_tokenize(js_line, &stop);
+		ut_check(PSTR("fuzz bounds"), "", (stop >= js_line) && (stop <= js_line + len) && (js_line[JSON_TEST_LEN] == '#'));
+	}
+}
+
+static void _js_throughput()
+{
+	uint16_t lines = 0;
+	char_t *stop;
+	uint32_t start = SysTickTimer_getValue();
+
+	for (uint8_t pass=0; pass < JSON_SPEED_PASSES; pass++) {
+		for (const char *p = test_json; pgm_read_byte(p) != NUL; ) {
+			uint8_t i = 0;
+			char c;
+			while (((c = pgm_read_byte(p)) != NUL) && (c != '\n')) {
+				if (i < JSON_TEST_LEN) { js_line[i++] = c;}
+				p++;
+			}
+			if (c == '\n') { p++;}
+			js_line[i] = NUL;
+			_js_tokenize(js_line, &stop);
+			lines++;
+		}
+	}
+	uint32_t ms = SysTickTimer_getValue() - start;
+	printf_P(PSTR("JSON tokenizer: %u test_008 lines in %lu ms"), lines, ms);
+	if (ms > 0) { printf_P(PSTR(", %lu lines/sec"), ((uint32_t)lines * 1000) / ms);}
+	printf_P(PSTR("\n"));
+}
+
+void js_unit_tests()
+{
+	uint8_t syntax = js.json_syntax;
+
+	_js_round_trip();
+	_js_fuzz();
+	js.json_syntax = syntax;
+	ut_report(PSTR("JSON"));
+	_js_throughput();
+	nv_reset_nv_list();
+}
+
+#endif // __UNIT_TESTS && __UNIT_TEST_JSON
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -87,6 +87,8 @@ extern jsSingleton_t js;
 /**** Function Prototypes ****/
 
 void json_parser(char_t *str);
+void json_parser_restricted(char_t *str);
+void json_gcode_parser(char_t *block);
 uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size);
 void json_print_object(nvObj_t *nv);
 void json_print_response(uint8_t status);
@@ -110,8 +112,16 @@ stat_t json_set_jv(nvObj_t *nv);
 
 #endif // __TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+//#define __UNIT_TEST_JSON			// run tokenizer round-trip, fuzz and lines/sec tests at startup
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_JSON)
+void js_unit_tests(void);
+#define	JSON_UNITS js_unit_tests();
+#else
+#define	JSON_UNITS
+#endif // __UNIT_TEST_JSON
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // End of include guard: JSON_PARSER_H_ONCE
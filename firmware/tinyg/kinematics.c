@@ -28,14 +28,36 @@
 #include "tinyg.h"
 #include "config.h"
 #include "canonical_machine.h"
+#include "planner.h"
 #include "stepper.h"
 #include "kinematics.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "util.h"
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+kin_t kin;
 
-//static void _inverse_kinematics(float travel[], float joint[]);
+static void _inverse_kinematics(const float travel[], float joint[]);
+static void _forward_kinematics(const float joint[], float travel[]);
+
+/*
+ * kinematics_init() - start the cost timer
+ *
+ *	TIMER_KIN free-runs at 4 MHz and wraps every 16 ms, which is longer than any segment,
+ *	so the 16 bit difference of two readings is always a valid elapsed time.
+ */
+
+void kinematics_init()
+{
+#ifdef __AVR
+	TIMER_KIN.PER = 0xFFFF;
+	TIMER_KIN.CTRLA = TC_CLKSEL_DIV8_gc;
+#endif
+}
 
 /*
  * ik_kinematics() - wrapper routine for inverse kinematics
@@ -53,8 +75,11 @@ void ik_kinematics(const float travel[], float steps[])
 {
 	float joint[AXES];
 
-//	_inverse_kinematics(travel, joint);				// you can insert inverse kinematics transformations here
-	memcpy(joint, travel, sizeof(float)*AXES);		//...or just do a memcpy for Cartesian machines
+	if (kin.type != KIN_CARTESIAN) {
+		_inverse_kinematics(travel, joint);			// tool center point transformation
+	} else {
+		memcpy(joint, travel, sizeof(float)*AXES);	//...or just do a memcpy for Cartesian machines
+	}
 
 	// Map motors to axes and convert length units to steps
 	// Most of the conversion math has already been done in during config in steps_per_unit()
@@ -85,24 +110,343 @@ void ik_kinematics(const float travel[], float steps[])
 }
 
 /*
- * _inverse_kinematics() - inverse kinematics - example is for a cartesian machine
- *
- *	You can glue in inverse kinematics here, but be aware of time budget constrants.
- *	This function is run during the _exec() portion of the cycle and will therefore
- *	be run once per interpolation segment. The total time for the segment load,
- *	including the inverse kinematics transformation cannot exceed the segment time,
- *	and ideally should be no more than 25-50% of the segment time. Currently segments
- *	run avery 5 ms, but this might be lowered. To profile this time look at the
- *	time it takes to complete the mp_exec_move() function.
+ * ik_kinematics_segment() - ik_kinematics() for an exec segment, keeping the peak cost
+ *
+ *	Only the once-per-segment call from the exec is timed, and only for non-Cartesian
+ *	types, so $kct is the cost of the transform against the segment time budget.
+ *	Foreground calls (e.g. resetting the step position) do not count.
  */
+
+void ik_kinematics_segment(const float travel[], float steps[])
+{
+#ifdef __AVR
+	if (kin.type != KIN_CARTESIAN) {
+		uint16_t start = TIMER_KIN.CNT;
+		ik_kinematics(travel, steps);
+		uint16_t cost = TIMER_KIN.CNT - start;
+		if (cost > kin.cost) { kin.cost = cost;}
+		return;
+	}
+#endif
+	ik_kinematics(travel, steps);
+}
+
 /*
-static void _inverse_kinematics(float travel[], float joint[])
+ * fk_kinematics() - wrapper routine for forward kinematics
+ *
+ *	The inverse of ik_kinematics(). Converts motor steps to axis positions. Only axes
+ *	that have a motor mapped to them (and are not inhibited) are written; the caller
+ *	should pre-load travel[] with values to use for the others. If more than one motor
+ *	is mapped to an axis the last one wins. Used for reporting, not in the step path.
+ */
+
+void fk_kinematics(const float steps[], float travel[])
 {
-	for (uint8_t i=0; i<AXES; i++) {
-		joint[i] = travel[i];
+	float joint[AXES];
+
+	if (kin.type != KIN_CARTESIAN) {
+		_inverse_kinematics(travel, joint);			// pre-loaded values are tool tip positions
+	} else {
+		memcpy(joint, travel, sizeof(float)*AXES);
+	}
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		uint8_t axis = st_cfg.mot[motor].motor_map;
+		if ((axis >= AXES) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) { continue;}
+		joint[axis] = steps[motor] / st_cfg.mot[motor].steps_per_unit;
+	}
+	if (kin.type != KIN_CARTESIAN) {
+		_forward_kinematics(joint, travel);
+	} else {
+		memcpy(travel, joint, sizeof(float)*AXES);
 	}
 }
-*/
+
+/*
+ * _inverse_kinematics() - tool tip position to joint positions
+ * _forward_kinematics() - joint positions to tool tip position
+ *
+ *	Be aware of time budget constraints. The inverse runs during the _exec() portion of
+ *	the cycle once per interpolation segment, and the segment load including the transform
+ *	should be no more than 25-50% of the segment time. The peak cost is kept in kin.cost
+ *	($kct). Rotaries are in degrees; positive angles turn counter-clockwise looking down
+ *	the positive axis (right hand rule). O is the pivot, P the tool tip in the workpiece.
+ *
+ *	  Table A/C:  joint = O + Rx(a) * Rz(c) * (P - O)
+ *	  Head B, table C:  joint = O + Rz(c) * (P - O) + L * (sin(b), 0, cos(b) - 1)
+ *
+ *	For head/table only the XY of the pivot is used (the C centerline). The joint XYZ
+ *	equals the tip position when the rotaries are at zero, so homing and offsets work
+ *	as they do on a Cartesian machine.
+ */
+
+static void _inverse_kinematics(const float travel[], float joint[])
+{
+	memcpy(joint, travel, sizeof(float)*AXES);		// rotaries pass through
+	float x = travel[AXIS_X] - kin.pivot[AXIS_X];
+	float y = travel[AXIS_Y] - kin.pivot[AXIS_Y];
+	float z = travel[AXIS_Z] - kin.pivot[AXIS_Z];
+	float c = travel[AXIS_C] / RADIAN;
+	float sin_c = sin(c);
+	float cos_c = cos(c);
+	float xr = x * cos_c - y * sin_c;				// turn the table
+	float yr = x * sin_c + y * cos_c;
+
+	if (kin.type == KIN_TABLE_AC) {
+		float a = travel[AXIS_A] / RADIAN;
+		float sin_a = sin(a);
+		float cos_a = cos(a);
+		joint[AXIS_X] = kin.pivot[AXIS_X] + xr;
+		joint[AXIS_Y] = kin.pivot[AXIS_Y] + yr * cos_a - z * sin_a;
+		joint[AXIS_Z] = kin.pivot[AXIS_Z] + yr * sin_a + z * cos_a;
+	} else {
+		float b = travel[AXIS_B] / RADIAN;
+		joint[AXIS_X] = kin.pivot[AXIS_X] + xr + kin.pivot_length * sin(b);
+		joint[AXIS_Y] = kin.pivot[AXIS_Y] + yr;
+		joint[AXIS_Z] = travel[AXIS_Z] + kin.pivot_length * (cos(b) - 1);
+	}
+}
+
+static void _forward_kinematics(const float joint[], float travel[])
+{
+	memcpy(travel, joint, sizeof(float)*AXES);
+	float x = joint[AXIS_X] - kin.pivot[AXIS_X];
+	float y = joint[AXIS_Y] - kin.pivot[AXIS_Y];
+	float c = joint[AXIS_C] / RADIAN;
+	float sin_c = sin(c);
+	float cos_c = cos(c);
+
+	if (kin.type == KIN_TABLE_AC) {
+		float z = joint[AXIS_Z] - kin.pivot[AXIS_Z];
+		float a = joint[AXIS_A] / RADIAN;
+		float sin_a = sin(a);
+		float cos_a = cos(a);
+		float yr = y * cos_a + z * sin_a;			// untilt
+		travel[AXIS_Z] = kin.pivot[AXIS_Z] - y * sin_a + z * cos_a;
+		y = yr;
+	} else {
+		float b = joint[AXIS_B] / RADIAN;
+		x -= kin.pivot_length * sin(b);
+		travel[AXIS_Z] = joint[AXIS_Z] - kin.pivot_length * (cos(b) - 1);
+	}
+	travel[AXIS_X] = kin.pivot[AXIS_X] + x * cos_c + y * sin_c;	// unturn the table
+	travel[AXIS_Y] = kin.pivot[AXIS_Y] - x * sin_c + y * cos_c;
+}
+
+/*
+ * kn_get_segment_length() - longest segment that holds the linearization error in tolerance
+ *
+ *	The steps of a segment are interpolated linearly in joint space, but a point the
+ *	rotaries swing through radius R follows an arc. Turning by theta in one segment leaves
+ *	a chord error of R * (1 - cos(theta/2)), about R * theta^2 / 8, so a segment may turn
+ *	at most sqrt(8 * tolerance / R) radians. R is bounded by the tip's distance from the
+ *	pivot at either end of the move (plus the pivot length for a tilting head).
+ *
+ *	Returns the limit as a length along the move (the units of unit[]), or 0 for no limit.
+ */
+
+static float _get_swing_radius(const float position[])
+{
+	float x = position[AXIS_X] - kin.pivot[AXIS_X];
+	float y = position[AXIS_Y] - kin.pivot[AXIS_Y];
+
+	if (kin.type == KIN_TABLE_AC) {
+		float z = position[AXIS_Z] - kin.pivot[AXIS_Z];
+		return (sqrt(square(x) + square(y) + square(z)));
+	}
+	return (sqrt(square(x) + square(y)) + fabs(kin.pivot_length));
+}
+
+float kn_get_segment_length(const float position[], const float target[], const float unit[])
+{
+	if ((kin.type == KIN_CARTESIAN) || (kin.tolerance < EPSILON)) { return (0);}
+
+	uint8_t tilt = (kin.type == KIN_TABLE_AC) ? AXIS_A : AXIS_B;
+	float rotation = fabs(unit[tilt]) + fabs(unit[AXIS_C]);			// degrees per unit of move length
+	float radius = max(_get_swing_radius(position), _get_swing_radius(target));
+	if ((rotation < EPSILON) || (radius < EPSILON)) { return (0);}
+	return (sqrt(8 * kin.tolerance / radius) * RADIAN / rotation);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * kn_set_kin() - set kinematics type
+ * kn_set_kp()  - set pivot geometry
+ * kn_get_kct() - get the peak segment cost in uSec
+ * kn_set_kct() - reset the peak segment cost (any value)
+ *
+ *	Changing the geometry changes where the tool tip is for the same motor positions.
+ *	The motors are left where they are and the position is recomputed from them, so the
+ *	machine does not jump. Only accepted while no motion is queued or running.
+ *
+ *	During config_init() the machine is still initializing. The planner and the canonical
+ *	machine are not set up and there is no position to preserve, so the persisted value
+ *	is applied as is.
+ *
+ *	The cost is written by the exec interrupt, so it is read and reset with interrupts off.
+ */
+
+static stat_t _set_geometry(nvObj_t *nv, stat_t (*setter)(nvObj_t *nv))
+{
+	float position[AXES];
+	float steps[MOTORS];
+
+	if (cm.machine_state == MACHINE_INITIALIZING) {
+		return (setter(nv));
+	}
+	if ((mp_planner_is_empty() == false) || (cm_get_runtime_busy() == true) || (cm.cycle_state != CYCLE_OFF)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+		position[axis] = mp_get_runtime_absolute_position(axis);
+	}
+	ik_kinematics(position, steps);
+	ritorno(setter(nv));
+	fk_kinematics(steps, position);
+	for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+		cm_set_position(axis, position[axis]);
+	}
+	return (STAT_OK);
+}
+
+stat_t kn_set_kin(nvObj_t *nv)
+{
+	if ((uint8_t)nv->value > KIN_TYPE_MAX) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	return (_set_geometry(nv, set_ui8));
+}
+
+stat_t kn_set_kp(nvObj_t *nv) { return (_set_geometry(nv, set_flu));}
+
+stat_t kn_get_kct(nvObj_t *nv)
+{
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t cost = kin.cost;
+	SREG = sreg;
+#else
+	uint16_t cost = kin.cost;
+#endif
+	nv->value = (float)cost * KIN_TIMER_USEC;
+	nv->precision = (int8_t)GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t kn_set_kct(nvObj_t *nv)
+{
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+	kin.cost = 0;
+	SREG = sreg;
+#else
+	kin.cost = 0;
+#endif
+	nv->value = 0;
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char msg_units0[] PROGMEM = " in";	// used by generic print functions
+static const char msg_units1[] PROGMEM = " mm";
+static const char msg_units2[] PROGMEM = " deg";
+static const char *const msg_units[] PROGMEM = { msg_units0, msg_units1, msg_units2 };
+
+static const char fmt_kin[] PROGMEM = "[kin] kinematics%19d [0=cartesian,1=table A/C,2=head B/table C]\n";
+static const char fmt_kpx[] PROGMEM = "[kpx] kinematic pivot X%17.3f%s\n";
+static const char fmt_kpy[] PROGMEM = "[kpy] kinematic pivot Y%17.3f%s\n";
+static const char fmt_kpz[] PROGMEM = "[kpz] kinematic pivot Z%17.3f%s\n";
+static const char fmt_kpl[] PROGMEM = "[kpl] kinematic pivot length%12.3f%s\n";
+static const char fmt_kle[] PROGMEM = "[kle] kinematic linear error%12.4f%s\n";
+static const char fmt_kct[] PROGMEM = "[kct] kinematic segment cost%7.0f uSec\n";
+
+void kn_print_kin(nvObj_t *nv) { text_print_ui8(nv, fmt_kin);}
+void kn_print_kpx(nvObj_t *nv) { text_print_flt_units(nv, fmt_kpx, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kpy(nvObj_t *nv) { text_print_flt_units(nv, fmt_kpy, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kpz(nvObj_t *nv) { text_print_flt_units(nv, fmt_kpz, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kpl(nvObj_t *nv) { text_print_flt_units(nv, fmt_kpl, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kle(nvObj_t *nv) { text_print_flt_units(nv, fmt_kle, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kct(nvObj_t *nv) { text_print_flt(nv, fmt_kct);}
+
+#endif // __TEXT_MODE
+
+/***********************************************************************************
+ * UNIT TESTS
+ *
+ *	Define __UNIT_TESTS and __UNIT_TEST_KIN to run these at startup (see KIN_UNITS).
+ *	For each non-Cartesian type, tool tip positions go through the inverse and back
+ *	through the forward transform, then through ik_kinematics() and fk_kinematics()
+ *	(steps and back). Both must return the starting position. The joints must equal
+ *	the tip when the rotaries are at zero. kin is saved and restored. The steps round
+ *	trip needs a motor on each of X, Y and Z, as in the default motor map.
+ ***********************************************************************************/
+
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_KIN)
+
+#define KIN_TEST_TOLERANCE 0.001			// mm (or degrees)
+
+static const float kin_test_positions[][AXES] = {
+	{   0,    0,   0,   0,   0,    0 },
+	{  25,  -40,  12,  30, -20,   90 },
+	{ -60,   15,  -8, -45,  35, -135 },
+	{ 100,  100, -50,  89,  60,  270 },
+	{ 5.5, -0.25,  3,   0,   0,    0 }
+};
+#define KIN_TEST_POSITIONS (sizeof(kin_test_positions) / sizeof(kin_test_positions[0]))
+
+static uint8_t _kin_match(const float a[], const float b[])
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (fabs(a[axis] - b[axis]) > KIN_TEST_TOLERANCE) { return (false);}
+	}
+	return (true);
+}
+
+void ik_unit_tests()
+{
+	kin_t save = kin;
+	float joint[AXES];
+	float travel[AXES];
+	float steps[MOTORS];
+
+	kin.pivot[AXIS_X] = 10;
+	kin.pivot[AXIS_Y] = -20;
+	kin.pivot[AXIS_Z] = 5;
+	kin.pivot_length = 50;
+
+	for (kin.type = KIN_TABLE_AC; kin.type <= KIN_TYPE_MAX; kin.type++) {
+		for (uint8_t i=0; i<KIN_TEST_POSITIONS; i++) {
+			const float *position = kin_test_positions[i];
+
+			_inverse_kinematics(position, joint);
+			_forward_kinematics(joint, travel);
+			ut_check(PSTR("ik/fk round trip"), "", _kin_match(position, travel));
+			if (fp_ZERO(position[AXIS_A]) && fp_ZERO(position[AXIS_B]) && fp_ZERO(position[AXIS_C])) {
+				ut_check(PSTR("zero rotation"), "", _kin_match(position, joint));
+			}
+
+			ik_kinematics(position, steps);
+			copy_vector(travel, position);			// pre-load axes with no motor
+			for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) { travel[axis] = 0;}
+			fk_kinematics(steps, travel);
+			ut_check(PSTR("steps round trip"), "", _kin_match(position, travel));
+		}
+	}
+	kin = save;
+	ut_report(PSTR("Kinematics"));
+}
+
+#endif // __UNIT_TESTS && __UNIT_TEST_KIN
 
 #ifdef __cplusplus
 }
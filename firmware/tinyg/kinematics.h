@@ -32,15 +32,76 @@
 extern "C"{
 #endif
 
+/*
+ * Kinematics configuration
+ *
+ *	Non-Cartesian types take the XYZ of a move as the tool tip position in the workpiece
+ *	(tool center point) and move the linear joints so the tip stays on the path while the
+ *	rotaries turn. Rotary positions are in degrees and pass through to their motors.
+ */
+
+enum kinType {
+	KIN_CARTESIAN = 0,						// joints are the axes (default)
+	KIN_TABLE_AC,							// table/table: A tilts about X, C turns about Z on the A table
+	KIN_HEAD_B_TABLE_C						// head/table: head tilts about Y (B), table turns about Z (C)
+};
+#define KIN_TYPE_MAX KIN_HEAD_B_TABLE_C
+
+#define KIN_TIMER_USEC	0.25				// cost timer tick (32 MHz / 8)
+
+typedef struct kinSingleton {
+	uint8_t type;							// kinType
+	float pivot[3];							// machine XYZ of the rotary centerline intersection (C axis for head/table)
+	float pivot_length;						// head/table: B pivot to tool tip at B=0
+	float tolerance;						// max linearization error in a segment (mm). 0 = no subdivision
+	uint16_t cost;							// peak TIMER_KIN ticks in ik_kinematics_segment(). Written by the exec
+} kin_t;
+extern kin_t kin;
+
 /*
  * Global Scope Functions
  */
 
+void kinematics_init(void);
 void ik_kinematics(const float travel[], float steps[]);
+void ik_kinematics_segment(const float travel[], float steps[]);
+void fk_kinematics(const float steps[], float travel[]);
+float kn_get_segment_length(const float position[], const float target[], const float unit[]);
+
+stat_t kn_set_kin(nvObj_t *nv);
+stat_t kn_set_kp(nvObj_t *nv);
+stat_t kn_get_kct(nvObj_t *nv);
+stat_t kn_set_kct(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+
+	void kn_print_kin(nvObj_t *nv);
+	void kn_print_kpx(nvObj_t *nv);
+	void kn_print_kpy(nvObj_t *nv);
+	void kn_print_kpz(nvObj_t *nv);
+	void kn_print_kpl(nvObj_t *nv);
+	void kn_print_kle(nvObj_t *nv);
+	void kn_print_kct(nvObj_t *nv);
+
+#else
+
+	#define kn_print_kin tx_print_stub
+	#define kn_print_kpx tx_print_stub
+	#define kn_print_kpy tx_print_stub
+	#define kn_print_kpz tx_print_stub
+	#define kn_print_kpl tx_print_stub
+	#define kn_print_kle tx_print_stub
+	#define kn_print_kct tx_print_stub
+
+#endif // __TEXT_MODE
 
-//#ifdef __UNIT_TESTS
-//void ik_unit_tests(void);
-//#endif
+//#define __UNIT_TEST_KIN				// run ik/fk round-trip tests at startup - requires __UNIT_TESTS
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_KIN)
+void ik_unit_tests(void);
+#define	KIN_UNITS ik_unit_tests();
+#else
+#define	KIN_UNITS
+#endif // __UNIT_TEST_KIN
 
 #ifdef __cplusplus
 }
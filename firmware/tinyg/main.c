@@ -25,10 +25,14 @@
 #include "hardware.h"
 #include "persistence.h"
 #include "controller.h"
+#include "json_parser.h"
 #include "canonical_machine.h"
 #include "report.h"
 #include "planner.h"
 #include "stepper.h"
+#include "step_stream.h"
+#include "kinematics.h"
+#include "fw_stage.h"
 #include "encoder.h"
 #include "network.h"
 #include "switch.h"
@@ -39,6 +43,7 @@
 #ifdef __AVR
 #include <avr/interrupt.h>
 #include "xmega/xmega_interrupts.h"
+#include "xmega/xmega_eeprom.h"
 #endif // __AVR
 
 #ifdef __ARM
@@ -132,6 +137,9 @@ static void _application_init(void)
 	config_init();					// config records from eeprom 		- must be next app init
 	network_init();					// reset std devices if required	- must follow config_init()
 	planner_init();					// motion planning subsystem
+	kinematics_init();				// kinematics cost timer
+	step_stream_init();				// host step-stream mode (off)
+	fw_stage_init();				// background firmware staging (idle)
 	canonical_machine_init();		// canonical machine				- must follow config_init()
 
 	// now bring up the interrupts and get started
@@ -140,6 +148,9 @@ static void _application_init(void)
 	PMIC_EnableMediumLevel();
 	PMIC_EnableLowLevel();
 	sei();							// enable global interrupts
+	EEPROM_UNITS;					// EEPROM queue unit tests (if enabled)
+	JSON_UNITS;						// JSON tokenizer unit tests (if enabled)
+	KIN_UNITS;						// kinematics round-trip unit tests (if enabled)
 	rpt_print_system_ready_message();// (LAST) announce system is ready
 }
 
@@ -220,7 +231,7 @@ static const char stat_32[] PROGMEM = "Float is infinite";
 static const char stat_33[] PROGMEM = "Float is NAN";
 static const char stat_34[] PROGMEM = "Persistence error";
 static const char stat_35[] PROGMEM = "Bad status report setting";
-static const char stat_36[] PROGMEM = "36";
+static const char stat_36[] PROGMEM = "Step rate exceeds DDA frequency";
 static const char stat_37[] PROGMEM = "37";
 static const char stat_38[] PROGMEM = "38";
 static const char stat_39[] PROGMEM = "39";
@@ -302,8 +313,8 @@ static const char stat_110[] PROGMEM = "Input value range error";
 static const char stat_111[] PROGMEM = "JSON syntax error";
 static const char stat_112[] PROGMEM = "JSON input has too many pairs";
 static const char stat_113[] PROGMEM = "JSON string too long";
-static const char stat_114[] PROGMEM = "114";
-static const char stat_115[] PROGMEM = "115";
+static const char stat_114[] PROGMEM = "Firmware image CRC mismatch";
+static const char stat_115[] PROGMEM = "Firmware staging unavailable";
 static const char stat_116[] PROGMEM = "116";
 static const char stat_117[] PROGMEM = "117";
 static const char stat_118[] PROGMEM = "118";
@@ -375,10 +386,10 @@ static const char stat_177[] PROGMEM = "R word is invalid";
 static const char stat_178[] PROGMEM = "T word is missing";
 static const char stat_179[] PROGMEM = "T word is invalid";
 
-static const char stat_180[] PROGMEM = "180";
-static const char stat_181[] PROGMEM = "181";
-static const char stat_182[] PROGMEM = "182";
-static const char stat_183[] PROGMEM = "183";
+static const char stat_180[] PROGMEM = "Cutter compensation would gouge";
+static const char stat_181[] PROGMEM = "Command not allowed with cutter compensation";
+static const char stat_182[] PROGMEM = "Preplanned line exceeds jerk limits";
+static const char stat_183[] PROGMEM = "Preplanned line entry velocity mismatch";
 static const char stat_184[] PROGMEM = "184";
 static const char stat_185[] PROGMEM = "185";
 static const char stat_186[] PROGMEM = "186";
@@ -454,6 +465,7 @@ static const char stat_249[] PROGMEM = "249";
 static const char stat_250[] PROGMEM = "Probe cycle failed";
 static const char stat_251[] PROGMEM = "Probe endpoint is starting point";
 static const char stat_252[] PROGMEM = "Jogging cycle failed";
+static const char stat_253[] PROGMEM = "Tool change cycle failed";
 
 static const char *const stat_msg[] PROGMEM = {
 	stat_00, stat_01, stat_02, stat_03, stat_04, stat_05, stat_06, stat_07, stat_08, stat_09,
@@ -481,7 +493,7 @@ static const char *const stat_msg[] PROGMEM = {
 	stat_220, stat_221, stat_222, stat_223, stat_224, stat_225, stat_226, stat_227, stat_228, stat_229,
 	stat_230, stat_231, stat_232, stat_233, stat_234, stat_235, stat_236, stat_237, stat_238, stat_239,
 	stat_240, stat_241, stat_242, stat_243, stat_244, stat_245, stat_246, stat_247, stat_248, stat_249,
-	stat_250, stat_251, stat_252
+	stat_250, stat_251, stat_252, stat_253
 };
 
 char *get_status_message(stat_t status)
@@ -28,6 +28,7 @@
 #include "persistence.h"
 #include "report.h"
 #include "canonical_machine.h"
+#include "stepper.h"
 #include "util.h"
 
 #ifdef __AVR
@@ -44,6 +45,13 @@ nvmSingleton_t nvm;
  **** GENERIC STATIC FUNCTIONS AND VARIABLES ***************************************
  ***********************************************************************************/
 
+#ifdef __AVR
+static uint8_t _is_idle()
+{
+	return ((cm.cycle_state == CYCLE_OFF) && (st_runtime_isbusy() == false));
+}
+#endif
+
 
 /***********************************************************************************
  **** CODE *************************************************************************
@@ -63,6 +71,11 @@ void persistence_init()
  * write_persistent_value() - write to NVM by index, but only if the value has changed
  *
  *	It's the responsibility of the caller to make sure the index does not exceed range
+ *
+ *	On the AVR writes are queued, and persistence_callback() writes them out once the
+ *	machine is idle. Values set while the machine is moving stay in the queue until
+ *	the cycle ends. Reads return queued values that have not reached the EEPROM yet.
+ *	If the queue is full the write waits for room when idle and is refused otherwise.
  */
 
 #ifdef __AVR
@@ -86,9 +99,6 @@ stat_t read_persistent_value(nvObj_t *nv)
 #ifdef __AVR
 stat_t write_persistent_value(nvObj_t *nv)
 {
-	if (cm.cycle_state != CYCLE_OFF)
-        return(rpt_exception(STAT_FILE_NOT_OPEN));	// can't write when machine is moving
-
 /* not needed
 	if (nv->valuetype == TYPE_FLOAT) {
 		if (isnan((double)nv->value)) return(rpt_exception(STAT_FLOAT_IS_NAN));		// bad floating point value
@@ -100,7 +110,14 @@ stat_t write_persistent_value(nvObj_t *nv)
 	if ((isnan((double)nv->value)) || (isinf((double)nv->value)) || (fp_NE(nv->value, nvm.tmp_value))) {
 		memcpy(&nvm.byte_array, &nvm.tmp_value, NVM_VALUE_LEN);
 		nvm.address = nvm.profile_base + (nv->index * NVM_VALUE_LEN);
-		(void)EEPROM_WriteBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
+		if (EEPROM_QueueBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN) == false) {
+			if (_is_idle() == false) {
+				nv->value = nvm.tmp_value;
+				return(rpt_exception(STAT_FILE_NOT_OPEN));	// can't wait for room when machine is moving
+			}
+			EEPROM_QueueFlush();
+			(void)EEPROM_QueueBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
+		}
 	}
 	nv->value =nvm.tmp_value;		// always restore value
 	return (STAT_OK);
@@ -123,6 +140,41 @@ stat_t write_persistent_value(nvObj_t *nv)
 }
 #endif // __ARM
 
+/************************************************************************************
+ * persistence_callback() - write out the next queued NVM write when the machine is idle
+ * nvm_get_nvp()		  - get number of NVM writes not yet completed
+ *
+ *	This is a deferred write, not a background one. Page writes only run when the cycle
+ *	is off and the steppers are idle, and each one blocks the foreground for a few ms,
+ *	one per controller pass. The AVR1008 EEPROM workaround sleeps through the write with
+ *	HI level interrupts enabled, and the DDA, dwell and load interrupts would wake it
+ *	early and corrupt the write.
+ *
+ *	nvp reads zero once every persisted value has reached the NVM. Hosts can poll it
+ *	or add it to status reports to be notified of completion.
+ */
+
+stat_t persistence_callback()
+{
+#ifdef __AVR
+	if (_is_idle() == true) {
+		EEPROM_QueueService();
+	}
+#endif
+	return (STAT_OK);
+}
+
+stat_t nvm_get_nvp(nvObj_t *nv)
+{
+#ifdef __AVR
+	nv->value = (float)EEPROM_QueuePending();
+#else
+	nv->value = 0;
+#endif
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
 #ifdef __cplusplus
 }
 #endif
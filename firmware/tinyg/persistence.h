@@ -48,5 +48,7 @@ typedef struct nvmSingleton {
 void persistence_init(void);
 stat_t read_persistent_value(nvObj_t *nv);
 stat_t write_persistent_value(nvObj_t *nv);
+stat_t persistence_callback(void);
+stat_t nvm_get_nvp(nvObj_t *nv);
 
 #endif // End of include guard: PERSISTENCE_H_ONCE
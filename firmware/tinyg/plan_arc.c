@@ -25,6 +25,7 @@
 #include "config.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_comp.h"
 #include "planner.h"
 #include "util.h"
 
@@ -43,6 +44,7 @@ static void _estimate_arc_time(void);
  *
  * cm_arc_init()	 - initialize arcs
  * cm_arc_feed() 	 - canonical machine entry point for arc
+ * cm_arc_run()		 - start an arc from an explicit start position and center
  * cm_arc_callback() - mail-loop callback for arc generation
  * cm_abort_arc()	 - stop an arc in process
  */
@@ -167,6 +169,13 @@ stat_t cm_arc_feed(float target[], float flags[],       // arc endpoints
         return (STAT_MINIMUM_LENGTH_MOVE);          // trap zero length arcs that _compute_arc can throw
     }
 
+	// cutter compensation offsets the arc once the next move is known, then runs it with cm_arc_run()
+	if (cm_comp_engaged()) {
+		stat_t status = cm_comp_arc(&cm.gm, arc.center_0, arc.center_1, arc.rotations, arc.full_circle);
+		cm_finalize_move();
+		return (status);
+	}
+
 /*	// test arc soft limits
 	stat_t status = _test_arc_soft_limits();
 	if (status != STAT_OK) {
@@ -181,6 +190,49 @@ stat_t cm_arc_feed(float target[], float flags[],       // arc endpoints
 	return (STAT_OK);
 }
 
+/*
+ * cm_arc_run() - start an arc from an explicit start position and center
+ *
+ *	Used by cutter compensation to run arcs whose endpoints have been offset from
+ *	the programmed path. The gcode state provides the target, plane and direction.
+ *	Position is the start of the arc and center is in the plane of the arc, both
+ *	in machine coordinates (mm). The arc must not already be running.
+ */
+stat_t cm_arc_run(GCodeState_t *gm_in, float position[], float center_0, float center_1,
+				  uint32_t rotations, uint8_t full_circle)
+{
+	if (gm_in->select_plane == CANON_PLANE_XZ) {
+		arc.plane_axis_0 = AXIS_X;
+		arc.plane_axis_1 = AXIS_Z;
+		arc.linear_axis  = AXIS_Y;
+	} else if (gm_in->select_plane == CANON_PLANE_YZ) {
+		arc.plane_axis_0 = AXIS_Y;
+		arc.plane_axis_1 = AXIS_Z;
+		arc.linear_axis  = AXIS_X;
+	} else {
+		arc.plane_axis_0 = AXIS_X;
+		arc.plane_axis_1 = AXIS_Y;
+		arc.linear_axis  = AXIS_Z;
+	}
+	memcpy(&arc.gm, gm_in, sizeof(GCodeState_t));
+	copy_vector(arc.position, position);
+
+	arc.radius = 0;									// center format - radius is computed from the offsets
+	arc.offset[arc.plane_axis_0] = center_0 - position[arc.plane_axis_0];
+	arc.offset[arc.plane_axis_1] = center_1 - position[arc.plane_axis_1];
+	arc.offset[arc.linear_axis] = 0;
+	arc.rotations = rotations;
+	arc.full_circle = full_circle;
+
+	ritorno(_compute_arc());
+	if (fp_ZERO(arc.length)) {
+        return (STAT_MINIMUM_LENGTH_MOVE);
+    }
+	cm_cycle_start();
+	arc.run_state = MOVE_RUN;
+	return (STAT_OK);
+}
+
 /*
  * cm_arc_callback() - generate an arc
  *
@@ -199,6 +251,7 @@ stat_t cm_arc_callback()
         return (STAT_EAGAIN);
 
 	arc.theta += arc.arc_segment_theta;
+	arc.radius += arc.arc_segment_radius;
 	arc.gm.target[arc.plane_axis_0] = arc.center_0 + sin(arc.theta) * arc.radius;
 	arc.gm.target[arc.plane_axis_1] = arc.center_1 + cos(arc.theta) * arc.radius;
 	arc.gm.target[arc.linear_axis] += arc.arc_segment_linear_travel;
@@ -237,6 +290,17 @@ void cm_abort_arc()
  *                *   /
  *                  C   <- theta_start (e.g. -145 degrees: theta_start == -PI*(3/4))
  *
+ *	If the end radius differs from the start radius by more than the circular arc test
+ *	allows (ARC_RADIUS_ERROR_MIN or 0.1% of radius), but by no more than
+ *	cm.arc_spiral_tolerance, the arc is run as an Archimedean spiral: the radius changes
+ *	linearly with angle, by a constant amount per segment. With the spiral tolerance set
+ *	to zero mismatches up to ARC_RADIUS_ERROR_MAX are run as circles, as before spirals.
+ *
+ *	A mistyped I or J also looks like a radius mismatch, so the default tolerance
+ *	(ARC_SPIRAL_TOLERANCE) is no larger than ARC_RADIUS_ERROR_MAX. It accepts the same arcs
+ *	a circle-only build would, and only changes how the small mismatches are run. Larger
+ *	intentional spirals need a larger $spt.
+ *
  *  Parts of this routine were originally sourced from the grbl project.
  */
 
@@ -258,11 +322,17 @@ static stat_t _compute_arc()
     // Compute end radius from the center of circle (offsets) to target endpoint
     float end_0 = arc.gm.target[arc.plane_axis_0] - arc.position[arc.plane_axis_0] - arc.offset[arc.plane_axis_0];
     float end_1 = arc.gm.target[arc.plane_axis_1] - arc.position[arc.plane_axis_1] - arc.offset[arc.plane_axis_1];
-    float err = fabs(hypotf(end_0, end_1) - arc.radius);   // end radius - start radius
-    if ( (err > ARC_RADIUS_ERROR_MAX) || 
-        ((err < ARC_RADIUS_ERROR_MIN) && 
-         (err > arc.radius * ARC_RADIUS_TOLERANCE)) ) {
-//        return (STAT_ARC_HAS_IMPOSSIBLE_CENTER_POINT);
+    float radius_end = hypotf(end_0, end_1);
+    float err = fabs(radius_end - arc.radius);      // end radius - start radius
+    if ((err <= ARC_RADIUS_ERROR_MIN) || (err <= arc.radius * ARC_RADIUS_TOLERANCE)) {
+        radius_end = arc.radius;                    // close enough - run it as a circle
+    } else if (fp_ZERO(cm.arc_spiral_tolerance)) {  // spirals disabled
+        if (err > ARC_RADIUS_ERROR_MAX) {
+//            return (STAT_ARC_HAS_IMPOSSIBLE_CENTER_POINT);
+            return (STAT_ARC_SPECIFICATION_ERROR);
+        }
+        radius_end = arc.radius;
+    } else if (err > cm.arc_spiral_tolerance) {     // otherwise run it as a spiral
         return (STAT_ARC_SPECIFICATION_ERROR);
     }
 
@@ -271,7 +341,7 @@ static stat_t _compute_arc()
     arc.theta = atan2(-arc.offset[arc.plane_axis_0], -arc.offset[arc.plane_axis_1]);
 
     // g18_correction is used to invert G18 XZ plane arcs for proper CW orientation
-    float g18_correction = (cm.gm.select_plane == CANON_PLANE_XZ) ? -1 : 1;
+    float g18_correction = (arc.gm.select_plane == CANON_PLANE_XZ) ? -1 : 1;
 
 	if (arc.full_circle) {                                  // if full circle you can skip the stuff in the else clause
     	arc.angular_travel = 0;                             // angular travel always starts as zero for full circles
@@ -289,14 +359,14 @@ static stat_t _compute_arc()
                 arc.theta_end += (2*M_PI * g18_correction);
             }
 	        arc.angular_travel = arc.theta_end - arc.theta; // compute positive angular travel
-    	    if (cm.gm.motion_mode == MOTION_MODE_CCW_ARC) { // reverse travel direction if it's CCW arc
+    	    if (arc.gm.motion_mode == MOTION_MODE_CCW_ARC) { // reverse travel direction if it's CCW arc
                 arc.angular_travel -= (2*M_PI * g18_correction);
             }
         }
 	}
 
     // Add in travel for rotations
-    if (cm.gm.motion_mode == MOTION_MODE_CW_ARC) {
+    if (arc.gm.motion_mode == MOTION_MODE_CW_ARC) {
         arc.angular_travel += (2*M_PI * arc.rotations * g18_correction);
     } else {
         arc.angular_travel -= (2*M_PI * arc.rotations * g18_correction);
@@ -305,12 +375,13 @@ static stat_t _compute_arc()
 	// Calculate travel in the depth axis of the helix and compute the time it should take to perform the move
 	// arc.length is the total mm of travel of the helix (or just a planar arc)
 	arc.linear_travel = arc.gm.target[arc.linear_axis] - arc.position[arc.linear_axis];
-	arc.planar_travel = arc.angular_travel * arc.radius;
+	arc.planar_travel = arc.angular_travel * (arc.radius + radius_end) / 2;   // exact for circles, close for spirals
 	arc.length = hypotf(arc.planar_travel, arc.linear_travel);  // NB: hypot is insensitive to +/- signs
 	_estimate_arc_time();	// get an estimate of execution time to inform arc_segment calculation
 
 	// Find the minimum number of arc_segments that meets these constraints...
-	float arc_segments_for_chordal_accuracy = arc.length / sqrt(4*cm.chordal_tolerance * (2 * arc.radius - cm.chordal_tolerance));
+	float chord_radius = max(min(arc.radius, radius_end), cm.chordal_tolerance);	// tightest curvature of a spiral
+	float arc_segments_for_chordal_accuracy = arc.length / sqrt(4*cm.chordal_tolerance * (2 * chord_radius - cm.chordal_tolerance));
 	float arc_segments_for_minimum_distance = arc.length / cm.arc_segment_len;
 	float arc_segments_for_minimum_time = arc.arc_time * MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC;
 
@@ -323,6 +394,7 @@ static stat_t _compute_arc()
 	arc.arc_segment_count = (int32_t)arc.arc_segments;
 	arc.arc_segment_theta = arc.angular_travel / arc.arc_segments;
 	arc.arc_segment_linear_travel = arc.linear_travel / arc.arc_segments;
+	arc.arc_segment_radius = (radius_end - arc.radius) / arc.arc_segments;
     arc.center_0 = arc.position[arc.plane_axis_0] - sin(arc.theta) * arc.radius;
     arc.center_1 = arc.position[arc.plane_axis_1] - cos(arc.theta) * arc.radius;
 	arc.gm.target[arc.linear_axis] = arc.position[arc.linear_axis];	// initialize the linear target
@@ -407,8 +479,8 @@ static stat_t _compute_arc()
 static stat_t _compute_arc_offsets_from_radius()
 {
 	// Calculate the change in position along each selected axis
-	float x = cm.gm.target[arc.plane_axis_0] - cm.gmx.position[arc.plane_axis_0];
-	float y = cm.gm.target[arc.plane_axis_1] - cm.gmx.position[arc.plane_axis_1];
+	float x = arc.gm.target[arc.plane_axis_0] - arc.position[arc.plane_axis_0];
+	float y = arc.gm.target[arc.plane_axis_1] - arc.position[arc.plane_axis_1];
 
 	// *** From Forrest Green - Other Machine Co, 3/27/14
 	// If the distance between endpoints is greater than the arc diameter, disc
@@ -426,7 +498,7 @@ static stat_t _compute_arc_offsets_from_radius()
 	float h_x2_div_d = (disc > 0) ? -sqrt(disc) / hypotf(x,y) : 0;
 
 	// Invert the sign of h_x2_div_d if circle is counter clockwise (see header notes)
-	if (cm.gm.motion_mode == MOTION_MODE_CCW_ARC) { h_x2_div_d = -h_x2_div_d;}
+	if (arc.gm.motion_mode == MOTION_MODE_CCW_ARC) { h_x2_div_d = -h_x2_div_d;}
 
 	// Negative R is g-code-alese for "I want a circle with more than 180 degrees
 	// of travel" (go figure!), even though it is advised against ever generating
@@ -455,12 +527,12 @@ static stat_t _compute_arc_offsets_from_radius()
 static void _estimate_arc_time ()
 {
 	// Determine move time at requested feed rate
-	if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {
-		arc.arc_time = cm.gm.feed_rate;	                // inverse feed rate has been normalized to minutes
+	if (arc.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		arc.arc_time = arc.gm.feed_rate;	            // inverse feed rate has been normalized to minutes
 		cm.gm.feed_rate = 0;                            // reset feed rate so next block requires an explicit feed rate setting
 		cm.gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
 	} else {
-		arc.arc_time = arc.length / cm.gm.feed_rate;
+		arc.arc_time = arc.length / arc.gm.feed_rate;
 	}
 
 	// Downgrade the time if there is a rate-limiting axis
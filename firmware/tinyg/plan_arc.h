@@ -22,7 +22,8 @@
 
 // Arc radius tests. See http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
 //#define ARC_RADIUS_ERROR_MAX    ((float)0.5)        // max allowable mm between start and end radius
-#define ARC_RADIUS_ERROR_MAX    ((float)1.0)        // max allowable mm between start and end radius
+#define ARC_RADIUS_ERROR_MAX    ((float)1.0)        // max mm between start and end radius run as a circle if $spt=0
+													// otherwise differences above the 0.1% rule run as spirals up to $spt
 #define ARC_RADIUS_ERROR_MIN    ((float)0.005)      // min mm where 1% rule applies
 #define ARC_RADIUS_TOLERANCE    ((float)0.001)      // 0.1% radius variance test
 
@@ -54,6 +55,7 @@ typedef struct arArcSingleton {	    // persistent planner and runtime variables
 	int32_t arc_segment_count;		// count of running segments
 	float arc_segment_theta;		// angular motion per segment
 	float arc_segment_linear_travel;// linear motion per segment
+	float arc_segment_radius;		// radius change per segment - non-zero for spirals
 	float center_0;				    // center of circle at plane axis 0 (e.g. X for G17)
 	float center_1;				    // center of circle at plane axis 1 (e.g. Y for G17)
 
@@ -71,6 +73,8 @@ extern arc_t arc;
 /* arc function prototypes */	// NOTE: See canonical_machine.h for cm_arc_feed() prototype
 
 void cm_arc_init(void);
+stat_t cm_arc_run(GCodeState_t *gm_in, float position[], float center_0, float center_1,
+				  uint32_t rotations, uint8_t full_circle);
 stat_t cm_arc_callback(void);
 void cm_abort_arc(void);
 
@@ -0,0 +1,661 @@
+/*
+ * plan_comp.c - cutter radius compensation (G40, G41, G42)
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Cutter radius compensation offsets the programmed XY path by the radius of the
+ * D tool so the edge of the cutter, not its center, follows the programmed contour.
+ * G41 puts the tool to the left of the path (climb milling an outside contour),
+ * G42 to the right.
+ *
+ * The offset path at a junction depends on the move that follows it, so each move
+ * is held for one block of look-ahead before it is sent to the planner:
+ *
+ *	- Tangent junctions: both moves meet at the offset point.
+ *	- Outside corners: the first move ends normal to its endpoint and an arc of the
+ *	  cutter radius is inserted around the programmed corner to the start of the next.
+ *	- Inside corners: both moves end at the intersection of their offset paths. It
+ *	  is an error (gouge) if the offset paths do not intersect within the moves.
+ *
+ *	The first move after G41/G42 is the entry move. It runs from the current position
+ *	to the offset start of the move that follows it. Arcs cannot be entry moves.
+ *	G40 finishes the held move normal to its endpoint. The first move after G40 is
+ *	the exit move and runs from there to its (uncompensated) target.
+ *
+ *	Compensation only runs in the XY plane (G17) and moves are offset in XY only -
+ *	Z and rotary axes ride along. Moves with no XY travel run at the current offset
+ *	position and end the look-ahead, as do blocks that queue commands (spindle,
+ *	coolant, offsets...) ahead of their motion. After an interruption outside corners
+ *	are rolled as usual, but inside corners are reported as gouges.
+ *
+ *	Offset moves are queued in a small output queue. Lines go straight to the planner.
+ *	Arcs (offset and corner arcs) are run by the arc generator, so the output queue is
+ *	drained from cm_comp_callback() and command dispatch waits for it to empty. The
+ *	planner itself is never drained - moves continue to blend through compensated corners.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "plan_arc.h"
+#include "plan_comp.h"
+#include "planner.h"
+#include "util.h"
+
+// Allocate cutter compensation singleton structure
+
+comp_t comp;
+
+typedef struct ccPath {				// offset path of an element - a line or a circle
+	uint8_t type;					// COMP_LINE or COMP_ARC
+	float p[2];						// point on the line, or center of the circle
+	float d[2];						// unit direction of the line
+	float r;						// radius of the circle
+} ccPath_t;
+
+// Local functions
+static stat_t _add_element(ccElement_t *el);
+static stat_t _junction(ccElement_t *k, ccElement_t *n, const float p[], const float ts[], const float ps[]);
+static stat_t _resume(ccElement_t *n, const float p[], const float ts[], const float ps[]);
+static stat_t _stop(void);
+static stat_t _queue_element(ccElement_t *el, const float end[]);
+static stat_t _queue_corner(ccElement_t *el, const float start[], const float end[], const float center[]);
+static stat_t _drain(void);
+static ccElement_t *_load_element(GCodeState_t *gm_in, uint8_t type);
+static void _tangent(ccElement_t *el, const float pt[], float t[]);
+static void _offset(const float pt[], const float t[], float out[]);
+static float _arc_travel(ccElement_t *el, const float from[], const float to[]);
+static stat_t _intersect(ccPath_t *a, ccPath_t *b, const float near[], float x[]);
+static uint8_t _line_circle(ccPath_t *l, ccPath_t *c, float pts[2][2]);
+
+/*****************************************************************************
+ * Canonical Machining cutter compensation functions
+ *
+ * cm_comp_init()		- initialize cutter compensation
+ * cm_set_cutter_comp()	- G40, G41, G42
+ * cm_comp_aline()		- canonical machine entry point for lines
+ * cm_comp_arc()		- canonical machine entry point for arcs
+ * cm_comp_flush()		- finish the held move normal to its endpoint
+ * cm_comp_callback()	- main-loop callback to issue queued compensated moves
+ * cm_abort_comp()		- drop held and queued moves
+ */
+
+void cm_comp_init()
+{
+	memset(&comp, 0, sizeof(comp));
+	comp.magic_start = MAGICNUM;
+	comp.magic_end = MAGICNUM;
+}
+
+/*
+ * cm_comp_engaged() - true if moves are being compensated
+ * cm_comp_holding() - true if a move is held for look-ahead
+ * cm_comp_busy()	 - true if compensated moves are still to be issued to the planner
+ *
+ *	Cycles (homing, probing, jogging, tool change) always run uncompensated.
+ */
+bool cm_comp_engaged()
+{
+	return ((comp.state != COMP_OFF) &&
+		   ((cm.cycle_state == CYCLE_OFF) || (cm.cycle_state == CYCLE_MACHINING)));
+}
+
+bool cm_comp_holding() { return (comp.state == COMP_PENDING); }
+
+bool cm_comp_busy() { return ((comp.out_count > 0) || (arc.run_state != MOVE_OFF)); }
+
+/*
+ * cm_set_cutter_comp() - G40, G41, G42
+ *
+ *	The compensation radius is half the diameter of the tool table entry selected by
+ *	the D word, or of the current tool if D is not provided. Compensation must be
+ *	turned off before it can be turned on again (e.g. to change sides or tools).
+ *	Any held move must have been flushed before calling (see gcode_parser.c).
+ */
+stat_t cm_set_cutter_comp(uint8_t mode, uint8_t tool)
+{
+	if (tool > TOOLS) {
+		return (STAT_D_WORD_IS_INVALID);
+	}
+	if (comp.state == COMP_PENDING) {					// should already be flushed - but finish the move
+		ritorno(_stop());
+		stat_t status = _drain();
+		if (status != STAT_EAGAIN) ritorno(status);
+	}
+	if (mode == CUTTER_COMP_OFF) {
+		cm.gmx.cutter_comp_mode = CUTTER_COMP_OFF;
+		cm.gmx.cutter_radius = 0;
+		comp.state = COMP_OFF;
+		return (STAT_OK);
+	}
+	if (comp.state != COMP_OFF) {
+		return (STAT_CUTTER_COMPENSATION_CANNOT_BE_ENABLED);
+	}
+	cm.gmx.cutter_comp_mode = mode;
+	cm.gmx.cutter_radius = cm.tt[tool].diameter / 2;
+	comp.radius = cm.gmx.cutter_radius;
+	comp.side = (mode == CUTTER_COMP_LEFT) ? 1 : -1;
+	comp.position[0] = mm.position[AXIS_X];				// the planner position is where the tool will be
+	comp.position[1] = mm.position[AXIS_Y];
+	comp.state = COMP_IDLE;
+	return (STAT_OK);
+}
+
+/*
+ * cm_comp_aline() - canonical machine entry point for lines
+ *
+ *	Called in place of mp_aline() by the straight feed and traverse functions.
+ *	Passes the move through to the planner if compensation is not engaged.
+ */
+stat_t cm_comp_aline(GCodeState_t *gm_in)
+{
+	if (cm_comp_engaged() == false) {
+		return (mp_aline(gm_in));
+	}
+	uint8_t axis;
+	for (axis=AXIS_X; axis<AXES; axis++) {
+		if (fp_NE(gm_in->target[axis], cm.gmx.position[axis])) break;
+	}
+	if (axis == AXES) {
+		return (STAT_OK);								// zero length moves don't affect the look-ahead
+	}
+	ccElement_t *el = _load_element(gm_in, COMP_LINE);
+
+	// moves with no XY travel run at the current offset position and stop the look-ahead
+	if ((fp_EQ(el->start[AXIS_X], gm_in->target[AXIS_X])) && (fp_EQ(el->start[AXIS_Y], gm_in->target[AXIS_Y]))) {
+		if (comp.state == COMP_PENDING) {
+			ritorno(_stop());
+		}
+		el->ostart[0] = comp.position[0];
+		el->ostart[1] = comp.position[1];
+		ritorno(_queue_element(el, comp.position));
+		stat_t status = _drain();
+		return ((status == STAT_EAGAIN) ? STAT_OK : status);
+	}
+	return (_add_element(el));
+}
+
+/*
+ * cm_comp_arc() - canonical machine entry point for arcs
+ *
+ *	Called by cm_arc_feed() once the arc has been validated and its center found.
+ */
+stat_t cm_comp_arc(GCodeState_t *gm_in, float center_0, float center_1, uint32_t rotations, uint8_t full_circle)
+{
+	ccElement_t *el = _load_element(gm_in, COMP_ARC);
+	el->center[0] = center_0;
+	el->center[1] = center_1;
+	el->rotations = rotations;
+	el->full_circle = full_circle;
+	return (_add_element(el));
+}
+
+/*
+ * cm_comp_flush() - finish the held move normal to its endpoint
+ *
+ *	Used before commands that are queued to the planner so they run after the held
+ *	move. The caller must wait for cm_comp_busy() to go false before queuing them.
+ */
+stat_t cm_comp_flush()
+{
+	if (comp.state != COMP_PENDING) {
+		return (STAT_OK);
+	}
+	ritorno(_stop());
+	stat_t status = _drain();
+	return ((status == STAT_EAGAIN) ? STAT_OK : status);
+}
+
+/*
+ * cm_comp_callback() - issue queued compensated moves
+ *
+ *	Runs from the controller main loop right behind the arc generator. Returns EAGAIN
+ *	until all queued moves (including arcs it starts) have been issued to the planner.
+ */
+stat_t cm_comp_callback()
+{
+	if (comp.out_count == 0) {
+		return (STAT_NOOP);
+	}
+	stat_t status = _drain();
+	if (status == STAT_EAGAIN) {
+		return (STAT_EAGAIN);
+	}
+	if (status != STAT_OK) {
+		cm_abort_comp();
+		return (cm_soft_alarm(status));
+	}
+	return ((arc.run_state == MOVE_OFF) ? STAT_OK : STAT_EAGAIN);
+}
+
+/*
+ * cm_abort_comp() - drop held and queued moves
+ *
+ *	OK to call if compensation is off. If it is on the next move becomes an entry move
+ */
+void cm_abort_comp()
+{
+	comp.out_rd = 0;
+	comp.out_count = 0;
+	if (comp.state != COMP_OFF) {
+		comp.state = COMP_IDLE;
+		comp.position[0] = mp_get_runtime_absolute_position(AXIS_X);
+		comp.position[1] = mp_get_runtime_absolute_position(AXIS_Y);
+	}
+}
+
+/*****************************************************************************
+ * Look-ahead
+ *
+ * _add_element() - resolve the junction with the held move, then hold the new one
+ * _junction()	  - junction between the held move (k) and the next move (n)
+ * _resume()	  - junction after the look-ahead was interrupted
+ * _stop()		  - finish the held move normal to its endpoint
+ *
+ *	p is the programmed junction point, ts the unit tangent at the start of the next
+ *	move and ps the offset point at the start of the next move.
+ */
+
+static stat_t _add_element(ccElement_t *el)
+{
+	float p[2] = { el->start[AXIS_X], el->start[AXIS_Y] };
+	float ts[2], ps[2];
+
+	if (comp.state == COMP_IDLE) {						// entry move
+		if (el->type == COMP_ARC) {
+			return (STAT_CUTTER_COMPENSATION_CANNOT_BE_ENABLED);
+		}
+		el->entry = true;
+		el->start[AXIS_X] = comp.position[0];			// run from where the tool actually is
+		el->start[AXIS_Y] = comp.position[1];
+		el->ostart[0] = comp.position[0];
+		el->ostart[1] = comp.position[1];
+	} else {
+		_tangent(el, p, ts);
+		_offset(p, ts, ps);
+		if (el->type == COMP_ARC) {						// the offset must not shrink the arc through its center
+			float radius = hypotf(p[0] - el->center[0], p[1] - el->center[1]);
+			float inward = (ps[0] - p[0]) * (el->center[0] - p[0]) + (ps[1] - p[1]) * (el->center[1] - p[1]);
+			if ((inward > 0) && (comp.radius > (radius - COMP_POINT_TOLERANCE))) {
+				return (STAT_CUTTER_COMPENSATION_GOUGE);
+			}
+		}
+		if (comp.state == COMP_PENDING) {
+			ritorno(_junction(&comp.el[comp.pending], el, p, ts, ps));
+		} else {
+			ritorno(_resume(el, p, ts, ps));
+		}
+	}
+	comp.pending ^= 1;									// hold the new move
+	comp.state = COMP_PENDING;
+	stat_t status = _drain();
+	return ((status == STAT_EAGAIN) ? STAT_OK : status);
+}
+
+static stat_t _junction(ccElement_t *k, ccElement_t *n, const float p[], const float ts[], const float ps[])
+{
+	float te[2], pe[2];
+
+	if (k->entry) {										// entry move goes to the offset start of the next move
+		n->ostart[0] = ps[0];
+		n->ostart[1] = ps[1];
+		return (_queue_element(k, ps));
+	}
+	_tangent(k, p, te);
+	_offset(p, te, pe);
+
+	// tangent junction
+	if (hypotf(ps[0] - pe[0], ps[1] - pe[1]) < COMP_POINT_TOLERANCE) {
+		n->ostart[0] = pe[0];
+		n->ostart[1] = pe[1];
+		return (_queue_element(k, pe));
+	}
+
+	// outside corner (including reversals) - roll around the corner
+	float cross = te[0] * ts[1] - te[1] * ts[0];
+	if ((cross * comp.side) <= COMP_TANGENT_TOLERANCE) {
+		n->ostart[0] = ps[0];
+		n->ostart[1] = ps[1];
+		ritorno(_queue_element(k, pe));
+		return (_queue_corner(n, pe, ps, p));
+	}
+
+	// inside corner - end both moves at the intersection of their offset paths
+	ccPath_t a, b;
+	float x[2];
+	a.type = k->type;
+	b.type = n->type;
+	if (k->type == COMP_LINE) {
+		a.p[0] = pe[0]; a.p[1] = pe[1];
+		a.d[0] = te[0]; a.d[1] = te[1];
+	} else {
+		a.p[0] = k->center[0]; a.p[1] = k->center[1];
+		a.r = hypotf(pe[0] - k->center[0], pe[1] - k->center[1]);
+	}
+	if (n->type == COMP_LINE) {
+		b.p[0] = ps[0]; b.p[1] = ps[1];
+		b.d[0] = ts[0]; b.d[1] = ts[1];
+	} else {
+		b.p[0] = n->center[0]; b.p[1] = n->center[1];
+		b.r = hypotf(ps[0] - n->center[0], ps[1] - n->center[1]);
+	}
+	ritorno(_intersect(&a, &b, p, x));
+
+	// lines must be long enough to reach the intersection
+	if (k->type == COMP_LINE) {
+		if (((x[0] - k->ostart[0]) * te[0] + (x[1] - k->ostart[1]) * te[1]) < -COMP_POINT_TOLERANCE) {
+			return (STAT_CUTTER_COMPENSATION_GOUGE);
+		}
+	}
+	if (n->type == COMP_LINE) {
+		float length = hypotf(n->gm.target[AXIS_X] - p[0], n->gm.target[AXIS_Y] - p[1]);
+		if (((x[0] - ps[0]) * ts[0] + (x[1] - ps[1]) * ts[1]) > (length + COMP_POINT_TOLERANCE)) {
+			return (STAT_CUTTER_COMPENSATION_GOUGE);
+		}
+	}
+	n->ostart[0] = x[0];
+	n->ostart[1] = x[1];
+	return (_queue_element(k, x));
+}
+
+static stat_t _resume(ccElement_t *n, const float p[], const float ts[], const float ps[])
+{
+	n->ostart[0] = ps[0];
+	n->ostart[1] = ps[1];
+	if (hypotf(ps[0] - comp.position[0], ps[1] - comp.position[1]) < COMP_POINT_TOLERANCE) {
+		return (STAT_OK);
+	}
+	float cross = comp.last_tangent[0] * ts[1] - comp.last_tangent[1] * ts[0];
+	if ((cross * comp.side) > COMP_TANGENT_TOLERANCE) {
+		return (STAT_CUTTER_COMPENSATION_GOUGE);		// the tool is already past the inside corner
+	}
+	float pe[2] = { comp.position[0], comp.position[1] };
+	return (_queue_corner(n, pe, ps, p));
+}
+
+static stat_t _stop()
+{
+	ccElement_t *el = &comp.el[comp.pending];
+	float p[2] = { el->gm.target[AXIS_X], el->gm.target[AXIS_Y] };
+	float pe[2];
+
+	_tangent(el, p, comp.last_tangent);
+	_offset(p, comp.last_tangent, pe);
+	comp.state = COMP_STOPPED;
+	return (_queue_element(el, pe));
+}
+
+/*****************************************************************************
+ * Output queue
+ *
+ * _queue_element() - queue a held move with its resolved offset endpoint
+ * _queue_corner()	- queue a corner move around an outside corner
+ * _drain()			- issue queued moves to the planner and arc generator
+ */
+
+static ccOutput_t *_get_output()
+{
+	if (comp.out_count >= COMP_OUTPUT_QUEUE_SIZE) {
+		return (NULL);
+	}
+	return (&comp.out[(comp.out_rd + comp.out_count) % COMP_OUTPUT_QUEUE_SIZE]);
+}
+
+static stat_t _queue_element(ccElement_t *el, const float end[])
+{
+	ccOutput_t *out = _get_output();
+	if (out == NULL) {
+		return (STAT_BUFFER_FULL_FATAL);
+	}
+	out->type = el->type;
+	out->corner = false;
+	out->el = el;
+	out->start[0] = el->ostart[0];
+	out->start[1] = el->ostart[1];
+	out->end[0] = end[0];
+	out->end[1] = end[1];
+
+	if (el->type == COMP_ARC) {
+		float travel = _arc_travel(el, el->ostart, end);
+		out->motion_mode = el->gm.motion_mode;
+		out->center[0] = el->center[0];
+		out->center[1] = el->center[1];
+		out->rotations = el->rotations;
+		out->full_circle = false;
+		if (el->full_circle) {
+			if (hypotf(end[0] - el->ostart[0], end[1] - el->ostart[1]) < COMP_POINT_TOLERANCE) {
+				out->full_circle = true;
+			} else if ((travel > M_PI) && (out->rotations > 0)) {
+				out->rotations--;						// the partial travel is most of the circle
+			}
+		} else {
+			float pstart[2] = { el->start[AXIS_X], el->start[AXIS_Y] };
+			float pend[2] = { el->gm.target[AXIS_X], el->gm.target[AXIS_Y] };
+			if (fabs(travel - _arc_travel(el, pstart, pend)) > M_PI) {
+				return (STAT_CUTTER_COMPENSATION_GOUGE);// arc is too short for the cutter
+			}
+		}
+	}
+	comp.position[0] = end[0];
+	comp.position[1] = end[1];
+	comp.out_count++;
+	return (STAT_OK);
+}
+
+static stat_t _queue_corner(ccElement_t *el, const float start[], const float end[], const float center[])
+{
+	ccOutput_t *out = _get_output();
+	if (out == NULL) {
+		return (STAT_BUFFER_FULL_FATAL);
+	}
+	out->corner = true;
+	out->el = el;
+	out->start[0] = start[0];
+	out->start[1] = start[1];
+	out->end[0] = end[0];
+	out->end[1] = end[1];
+	out->center[0] = center[0];
+	out->center[1] = center[1];
+	out->rotations = 0;
+	out->full_circle = false;
+	if (el->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+		out->type = COMP_LINE;							// traverses are not cutting - skip the corner arc
+	} else {
+		out->type = COMP_ARC;
+		out->motion_mode = (comp.side > 0) ? MOTION_MODE_CW_ARC : MOTION_MODE_CCW_ARC;
+	}
+	comp.position[0] = end[0];
+	comp.position[1] = end[1];
+	comp.out_count++;
+	return (STAT_OK);
+}
+
+/*
+ *	Corner moves take the Gcode state of the move that follows the corner and hold
+ *	the other axes at the programmed corner. Moves wait for a running arc to finish
+ *	and for planner headroom, so _drain() returns EAGAIN until the queue is empty.
+ */
+static stat_t _drain()
+{
+	GCodeState_t gm;
+	float position[AXES];
+	stat_t status;
+
+	while (comp.out_count > 0) {
+		if (arc.run_state != MOVE_OFF) {
+			return (STAT_EAGAIN);
+		}
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+			return (STAT_EAGAIN);
+		}
+		ccOutput_t *out = &comp.out[comp.out_rd];
+		if (++comp.out_rd >= COMP_OUTPUT_QUEUE_SIZE) {
+			comp.out_rd = 0;
+		}
+		comp.out_count--;
+
+		memcpy(&gm, &out->el->gm, sizeof(GCodeState_t));
+		copy_vector(gm.target, (out->corner ? out->el->start : out->el->gm.target));
+		gm.target[AXIS_X] = out->end[0];
+		gm.target[AXIS_Y] = out->end[1];
+
+		if (out->type == COMP_LINE) {
+			// Offset lines at inside corners can be too short to plan. The planner leaves
+			// its position where it was, so the next element picks up the skipped travel.
+			status = mp_aline(&gm);
+			if ((status != STAT_OK) && (status != STAT_MINIMUM_TIME_MOVE) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+				return (status);
+			}
+		} else {
+			copy_vector(position, out->el->start);
+			position[AXIS_X] = out->start[0];
+			position[AXIS_Y] = out->start[1];
+			gm.motion_mode = out->motion_mode;
+			status = cm_arc_run(&gm, position, out->center[0], out->center[1], out->rotations, out->full_circle);
+			if ((status != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+				return (status);
+			}
+		}
+	}
+	return (STAT_OK);
+}
+
+/*****************************************************************************
+ * Geometry helpers - all in the XY plane
+ *
+ * _load_element()	- copy a move into the free element slot
+ * _tangent()		- unit tangent of the element at a point on the element
+ * _offset()		- point offset to the compensation side of the tangent
+ * _arc_travel()	- angular travel from one point to another in the arc direction [0, 2pi)
+ * _intersect()		- intersection of two offset paths closest to a point
+ */
+
+static ccElement_t *_load_element(GCodeState_t *gm_in, uint8_t type)
+{
+	ccElement_t *el = &comp.el[comp.pending ^ 1];		// the held move is in the other slot
+	memcpy(&el->gm, gm_in, sizeof(GCodeState_t));
+	copy_vector(el->start, cm.gmx.position);			// the model position is the start of the move
+	el->type = type;
+	el->entry = false;
+	el->full_circle = false;
+	el->rotations = 0;
+	return (el);
+}
+
+static void _tangent(ccElement_t *el, const float pt[], float t[])
+{
+	if (el->type == COMP_LINE) {
+		t[0] = el->gm.target[AXIS_X] - el->start[AXIS_X];
+		t[1] = el->gm.target[AXIS_Y] - el->start[AXIS_Y];
+	} else {
+		float u0 = pt[0] - el->center[0];
+		float u1 = pt[1] - el->center[1];
+		if (el->gm.motion_mode == MOTION_MODE_CCW_ARC) {
+			t[0] = -u1; t[1] = u0;
+		} else {
+			t[0] = u1; t[1] = -u0;
+		}
+	}
+	float length = hypotf(t[0], t[1]);
+	if (fp_ZERO(length)) {
+		t[0] = 0; t[1] = 0;
+		return;
+	}
+	t[0] /= length;
+	t[1] /= length;
+}
+
+static void _offset(const float pt[], const float t[], float out[])
+{
+	out[0] = pt[0] - t[1] * comp.radius * comp.side;	// left normal of t is (-t1, t0)
+	out[1] = pt[1] + t[0] * comp.radius * comp.side;
+}
+
+static float _arc_travel(ccElement_t *el, const float from[], const float to[])
+{
+	float travel = atan2(to[1] - el->center[1], to[0] - el->center[0]) -
+				   atan2(from[1] - el->center[1], from[0] - el->center[0]);
+	if (el->gm.motion_mode == MOTION_MODE_CW_ARC) {
+		travel = -travel;
+	}
+	if (travel < 0) {
+		travel += 2*M_PI;
+	}
+	return (travel);
+}
+
+static stat_t _intersect(ccPath_t *a, ccPath_t *b, const float near[], float x[])
+{
+	float pts[2][2];
+	uint8_t count = 0;
+
+	if ((a->type == COMP_LINE) && (b->type == COMP_LINE)) {
+		float den = a->d[0] * b->d[1] - a->d[1] * b->d[0];
+		if (fabs(den) > COMP_TANGENT_TOLERANCE) {
+			float t = ((b->p[0] - a->p[0]) * b->d[1] - (b->p[1] - a->p[1]) * b->d[0]) / den;
+			pts[0][0] = a->p[0] + t * a->d[0];
+			pts[0][1] = a->p[1] + t * a->d[1];
+			count = 1;
+		}
+	} else if (a->type == COMP_LINE) {
+		count = _line_circle(a, b, pts);
+	} else if (b->type == COMP_LINE) {
+		count = _line_circle(b, a, pts);
+	} else {											// circle - circle
+		float dx = b->p[0] - a->p[0];
+		float dy = b->p[1] - a->p[1];
+		float d = hypotf(dx, dy);
+		if ((d > COMP_POINT_TOLERANCE) && (d <= (a->r + b->r)) && (d >= fabs(a->r - b->r))) {
+			float m = (square(a->r) - square(b->r) + square(d)) / (2*d);
+			float h = sqrt(max(square(a->r) - square(m), 0));
+			for (uint8_t i=0; i<2; i++) {
+				float s = (i == 0) ? h : -h;
+				pts[i][0] = a->p[0] + (m * dx - s * dy) / d;
+				pts[i][1] = a->p[1] + (m * dy + s * dx) / d;
+			}
+			count = 2;
+		}
+	}
+	if (count == 0) {
+		return (STAT_CUTTER_COMPENSATION_GOUGE);
+	}
+	uint8_t best = 0;
+	if ((count == 2) && (hypotf(pts[1][0] - near[0], pts[1][1] - near[1]) <
+						 hypotf(pts[0][0] - near[0], pts[0][1] - near[1]))) {
+		best = 1;
+	}
+	x[0] = pts[best][0];
+	x[1] = pts[best][1];
+	return (STAT_OK);
+}
+
+static uint8_t _line_circle(ccPath_t *l, ccPath_t *c, float pts[2][2])
+{
+	float f0 = l->p[0] - c->p[0];
+	float f1 = l->p[1] - c->p[1];
+	float b = f0 * l->d[0] + f1 * l->d[1];
+	float disc = square(b) - (square(f0) + square(f1) - square(c->r));
+	if (disc < 0) {
+		return (0);
+	}
+	disc = sqrt(disc);
+	for (uint8_t i=0; i<2; i++) {
+		float t = (i == 0) ? (-b + disc) : (-b - disc);
+		pts[i][0] = l->p[0] + t * l->d[0];
+		pts[i][1] = l->p[1] + t * l->d[1];
+	}
+	return (2);
+}
@@ -0,0 +1,93 @@
+/*
+ * plan_comp.h - cutter radius compensation (G40, G41, G42)
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLAN_COMP_H_ONCE
+#define PLAN_COMP_H_ONCE
+
+#define COMP_OUTPUT_QUEUE_SIZE	4					// compensated moves waiting to be issued to the planner
+#define COMP_POINT_TOLERANCE	((float)0.0001)		// mm - offset points closer than this are the same point
+#define COMP_TANGENT_TOLERANCE	((float)0.0001)		// sine of the junction angle below which moves are tangent
+
+enum ccMoveType {
+	COMP_LINE = 0,
+	COMP_ARC
+};
+
+enum ccState {						// cutter compensation look-ahead state (comp.state)
+	COMP_OFF = 0,					// G40 - moves pass straight through to the planner
+	COMP_IDLE,						// G41/G42 enabled - the next XY move is the entry move
+	COMP_PENDING,					// a move is held until the move that follows it is known
+	COMP_STOPPED					// look-ahead was interrupted - last move ended normal to its endpoint
+};
+
+typedef struct ccElement {			// a programmed move held for look-ahead
+	uint8_t type;					// COMP_LINE or COMP_ARC
+	uint8_t entry;					// true for the move that starts compensation
+	uint8_t full_circle;			// arcs: programmed as a full circle
+	uint32_t rotations;				// arcs: full turns in addition to the programmed travel
+	float center[2];				// arcs: XY center
+	float start[AXES];				// programmed start position
+	float ostart[2];				// compensated XY start - resolved at the previous junction
+	GCodeState_t gm;				// Gcode state for the move. gm.target is the programmed end
+} ccElement_t;
+
+typedef struct ccOutput {			// a compensated move waiting to be issued
+	uint8_t type;					// COMP_LINE or COMP_ARC
+	uint8_t corner;					// true for a move inserted at an outside corner
+	uint8_t motion_mode;			// arcs: MOTION_MODE_CW_ARC or MOTION_MODE_CCW_ARC
+	uint8_t full_circle;			// arcs: run as a full circle
+	uint32_t rotations;				// arcs: additional full turns
+	ccElement_t *el;				// element providing the Gcode state
+	float start[2];					// arcs: XY start
+	float end[2];					// XY end
+	float center[2];				// arcs: XY center
+} ccOutput_t;
+
+typedef struct ccCompSingleton {	// cutter compensation look-ahead
+	magic_t magic_start;
+	uint8_t state;					// see ccState
+	float side;						// +1 for G41 (tool left of path), -1 for G42 (tool right of path)
+	float radius;					// compensation radius in mm
+	float position[2];				// XY the tool will be at once all queued output has run
+	float last_tangent[2];			// COMP_STOPPED: unit tangent at the end of the last move
+
+	uint8_t pending;				// index of the element being held
+	ccElement_t el[2];				// the held element and the one it was compensated against
+
+	uint8_t out_rd;					// output queue read index
+	uint8_t out_count;				// output queue depth
+	ccOutput_t out[COMP_OUTPUT_QUEUE_SIZE];
+	magic_t magic_end;
+} comp_t;
+extern comp_t comp;
+
+
+/* cutter compensation function prototypes */	// NOTE: See canonical_machine.h for cm_set_cutter_comp() prototype
+
+void cm_comp_init(void);
+bool cm_comp_engaged(void);
+bool cm_comp_holding(void);
+bool cm_comp_busy(void);
+stat_t cm_comp_aline(GCodeState_t *gm_in);
+stat_t cm_comp_arc(GCodeState_t *gm_in, float center_0, float center_1, uint32_t rotations, uint8_t full_circle);
+stat_t cm_comp_flush(void);
+stat_t cm_comp_callback(void);
+void cm_abort_comp(void);
+
+#endif	// End of include guard: PLAN_COMP_H_ONCE
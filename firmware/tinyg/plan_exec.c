@@ -31,6 +31,8 @@
 #include "planner.h"
 #include "kinematics.h"
 #include "stepper.h"
+#include "hardware.h"
+#include "step_stream.h"
 #include "encoder.h"
 #include "report.h"
 #include "util.h"
@@ -44,6 +46,11 @@ static stat_t _exec_aline_head(void);
 static stat_t _exec_aline_body(void);
 static stat_t _exec_aline_tail(void);
 static stat_t _exec_aline_segment(void);
+static void _exec_pso(const float segment_time);
+static void _exec_turns(mpBuf_t *bf);
+static float _get_segments(const float time, const float length);
+static void _exec_advance(float target[], const float segment_time);
+static float _exec_override(void);
 
 #ifndef __JERK_EXEC
 static void _init_forward_diffs(float Vi, float Vt);
@@ -60,13 +67,18 @@ stat_t mp_exec_move()
 {
 	mpBuf_t *bf;
 
+	if (ss.mode == true) return (ss_exec_segment());	// step-stream mode bypasses the planner queue
 	if ((bf = mp_get_run_buffer()) == NULL) {			// NULL means nothing's running
+		tl_end_line();
 		st_prep_null();
 		return (STAT_NOOP);
 	}
 	// Manage cycle and motion state transitions
 	if (bf->move_type == MOVE_TYPE_ALINE) { 			// cycle auto-start for lines only
 		if (cm.motion_state == MOTION_STOP) cm_set_motion_state(MOTION_RUN);
+		tl_start_line(bf->gm.linenum);					// capture line number execution timeline
+	} else {
+		tl_end_line();
 	}
 	if (bf->bf_func == NULL)
         return(cm_hard_alarm(STAT_INTERNAL_ERROR));     // never supposed to get here
@@ -161,9 +173,10 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		if (cm.hold_state == FEEDHOLD_HOLD)
             return (STAT_NOOP);	                        // stops here if holding
 
-		// initialization to process the new incoming bf buffer (Gcode block)
+		// initialization to process the new incoming bf buffer (Gcode block)
 		memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t));// copy in the gcode model state
 		bf->replannable = false;
+		_exec_turns(bf);								// block starts in a wrapped modulo axis frame
 														// too short lines have already been removed
 		if (fp_ZERO(bf->length)) {						// ...looks for an actual zero here
 			mr.move_state = MOVE_OFF;					// reset mr buffer
@@ -178,9 +191,11 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		mr.section = SECTION_HEAD;
 		mr.section_state = SECTION_NEW;
 		mr.jerk = bf->jerk;
+		mr.planned_override = bf->override;
 #ifdef __JERK_EXEC
 		mr.jerk_div2 = bf->jerk/2;						// only needed by __JERK_EXEC
 #endif
+		mp_calculate_trapezoid_jit(bf, mr.exit_velocity);// deferred trapezoid. mr still holds the previous exit
 		mr.head_length = bf->head_length;
 		mr.body_length = bf->body_length;
 		mr.tail_length = bf->tail_length;
@@ -191,6 +206,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 
 		copy_vector(mr.unit, bf->unit);
 		copy_vector(mr.target, bf->gm.target);			// save the final target of the move
+		mr.kin_segment_length = kn_get_segment_length(mr.position, mr.target, mr.unit);
 
 		// generate the waypoints for position correction at section ends
 		for (uint8_t axis=0; axis<AXES; axis++) {
@@ -234,12 +250,49 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		mr.section_state = SECTION_OFF;
 		bf->nx->replannable = false;					// prevent overplanning (Note 2)
 		if (bf->move_state == MOVE_RUN) {
-			if (mp_free_run_buffer()) cm_cycle_end();	// free buffer & end cycle if planner is empty
+			if (mp_free_run_buffer()) cm_cycle_end();	// free buffer & end cycle if planner is empty
 		}
 	}
 	return (status);
 }
 
+/*
+ * _exec_turns() - remove the whole turns a block carries from the runtime position
+ *
+ *	Moves the runtime into the frame the block was planned in (see MODULO_AXES). Step
+ *	counts are shifted by the same amount so following error is undisturbed. The encoder
+ *	shift is rounded, so a turn that is not a whole number of steps leaves a fraction of a
+ *	step of following error per wrap. Turns are cleared so a feedhold re-run of the
+ *	buffer does not remove them twice. A Case 2 feedhold splits a queued block into a
+ *	decel/accel pair; mp_plan_hold_callback() leaves the turns on the decel buffer only.
+ */
+static void _exec_turns(mpBuf_t *bf)
+{
+	uint8_t i;
+	float steps_before[MOTORS];
+	float steps_after[MOTORS];
+
+	for (i=0; i<MODULO_AXES; i++) {
+		if (bf->turns[i] != 0) break;
+	}
+	if (i == MODULO_AXES) return;						// nothing to do - the usual case
+
+	ik_kinematics(mr.position, steps_before);
+	for (i=0; i<MODULO_AXES; i++) {
+		mr.position[AXIS_A + i] -= 360 * (float)bf->turns[i];
+		mr.turns[i] += bf->turns[i];
+		bf->turns[i] = 0;
+	}
+	ik_kinematics(mr.position, steps_after);
+	for (i=0; i<MOTORS; i++) {
+		float shift = steps_before[i] - steps_after[i];
+		mr.target_steps[i] -= shift;
+		mr.position_steps[i] -= shift;
+		mr.commanded_steps[i] -= shift;
+		en_shift_encoder_steps(i, shift);
+	}
+}
+
 /* Forward difference math explained:
  *
  *	We are using a quintic (fifth-degree) Bezier polynomial for the velocity curve.
@@ -398,7 +451,7 @@ static stat_t _exec_aline_head()
 		}
 		mr.midpoint_velocity = (mr.entry_velocity + mr.cruise_velocity) / 2;
 		mr.gm.move_time = mr.head_length / mr.midpoint_velocity;	// time for entire accel region
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * NOM_SEGMENT_USEC)); // # of segments in *each half*
+		mr.segments = _get_segments(mr.gm.move_time / 2, mr.head_length / 2); // # of segments in *each half*
 		mr.segment_time = mr.gm.move_time / (2 * mr.segments);
 		mr.accel_time = 2 * sqrt((mr.cruise_velocity - mr.entry_velocity) / mr.jerk);
 		mr.midpoint_acceleration = 2 * (mr.cruise_velocity - mr.entry_velocity) / mr.accel_time;
@@ -442,7 +495,7 @@ static stat_t _exec_aline_head()
 			return(_exec_aline_body());								// skip ahead to the body generator
 		}
 		mr.gm.move_time = 2*mr.head_length / (mr.entry_velocity + mr.cruise_velocity);// time for entire accel region
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = _get_segments(mr.gm.move_time, mr.head_length);// # of segments for the section
 		mr.segment_time = mr.gm.move_time / mr.segments;
 		_init_forward_diffs(mr.entry_velocity, mr.cruise_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
@@ -528,7 +581,7 @@ static stat_t _exec_aline_body()
 			return(_exec_aline_tail());						// skip ahead to tail periods
 		}
 		mr.gm.move_time = mr.body_length / mr.cruise_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);
+		mr.segments = _get_segments(mr.gm.move_time, mr.body_length);
 		mr.segment_time = mr.gm.move_time / mr.segments;
 		mr.segment_velocity = mr.cruise_velocity;
 		mr.segment_count = (uint32_t)mr.segments;
@@ -561,7 +614,7 @@ static stat_t _exec_aline_tail()
             return(STAT_OK);			                            // end the move
 		mr.midpoint_velocity = (mr.cruise_velocity + mr.exit_velocity) / 2;
 		mr.gm.move_time = mr.tail_length / mr.midpoint_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * NOM_SEGMENT_USEC));// # of segments in *each half*
+		mr.segments = _get_segments(mr.gm.move_time / 2, mr.tail_length / 2);// # of segments in *each half*
 		mr.segment_time = mr.gm.move_time / (2 * mr.segments);		// time to advance for each segment
 		mr.accel_time = 2 * sqrt((mr.cruise_velocity - mr.exit_velocity) / mr.jerk);
 		mr.midpoint_acceleration = 2 * (mr.cruise_velocity - mr.exit_velocity) / mr.accel_time;
@@ -599,7 +652,7 @@ static stat_t _exec_aline_tail()
 		if (fp_ZERO(mr.tail_length))
             return(STAT_OK);                                        // end the move
 		mr.gm.move_time = 2*mr.tail_length / (mr.cruise_velocity + mr.exit_velocity); // len/avg. velocity
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = _get_segments(mr.gm.move_time, mr.tail_length);// # of segments for the section
 		mr.segment_time = mr.gm.move_time / mr.segments;			// time to advance for each segment
 		_init_forward_diffs(mr.cruise_velocity, mr.exit_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
@@ -669,6 +722,25 @@ static stat_t _exec_aline_tail()
 }
 #endif // __JERK_EXEC
 
+/*
+ * _get_segments() - number of segments to run a section (or each half of one) in
+ *
+ *	Segments are nominally NOM_SEGMENT_USEC long. Non-Cartesian kinematics may need shorter
+ *	segments to hold the linearization error (see kn_get_segment_length()), but segments
+ *	are never made shorter than MIN_SEGMENT_USEC to do it.
+ */
+
+static float _get_segments(const float time, const float length)
+{
+	float segments = ceil(uSec(time) / NOM_SEGMENT_USEC);
+
+	if (mr.kin_segment_length > 0) {
+		float kin_segments = min(ceil(length / mr.kin_segment_length), floor(uSec(time) / MIN_SEGMENT_USEC));
+		if (kin_segments > segments) { segments = kin_segments;}
+	}
+	return (segments);
+}
+
 /*********************************************************************************************
  * _exec_aline_segment() - segment runner helper
  *
@@ -721,14 +793,20 @@ static stat_t _exec_aline_segment()
 		mr.encoder_steps[i] = en_read_encoder(i);			// get current encoder position (time aligns to commanded_steps)
 		mr.following_error[i] = mr.encoder_steps[i] - mr.commanded_steps[i];
 	}
-	ik_kinematics(mr.gm.target, mr.target_steps);			// now determine the target steps...
+	float segment_time = _exec_override();					// planned segment time scaled by the override
+	float target[AXES];
+	copy_vector(target, mr.gm.target);
+	_exec_advance(target, segment_time);					// extruder pressure advance, if any
+	ik_kinematics_segment(target, mr.target_steps);			// now determine the target steps...
 	for (i=0; i<MOTORS; i++) {								// and compute the distances to be traveled
 		travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
 	}
 
 	// Call the stepper prep function
 
-	ritorno(st_prep_line(travel_steps, mr.following_error, mr.segment_time));
+	if ((mr.pso_interval > 0) && (st_cfg.pso_output != 0)) _exec_pso(segment_time);
+	if (ss.record == true) ss_record_segment(travel_steps, segment_time);
+	ritorno(st_prep_line(travel_steps, mr.following_error, segment_time));
 	copy_vector(mr.position, mr.gm.target); 				// update position from target
 #ifdef __JERK_EXEC
 	mr.elapsed_accel_time += mr.segment_accel_time;			// this is needed by jerk-based exec (NB: ignored if running the body)
@@ -736,3 +814,170 @@ static stat_t _exec_aline_segment()
 	if (mr.segment_count == 0) return (STAT_OK);			// this section has run all its segments
 	return (STAT_EAGAIN);									// this section still has more segments to run
 }
+
+/*
+ * _exec_override() - apply feed and traverse override changes to the running block
+ *
+ *	Returns the segment time to run, in minutes. Blocks are planned at the override in
+ *	effect when they were queued. If the override has since dropped below that the
+ *	segment is stretched in time by the ratio, which slows it down without changing its
+ *	path, so a change takes effect within a segment rather than after the queue drains.
+ *	At a steady ratio the planned acceleration and jerk scale down with its square and
+ *	cube, so they stay within the planned limits. The ratio never goes above 1 for the
+ *	same reason - increases reach the blocks planned after the change.
+ *
+ *	mr.override is carried from block to block and slews at OVERRIDE_SLEW_RATE, so the
+ *	velocity stays continuous across junctions and override changes. The limits are NOT
+ *	held while it slews: velocity is override * planned velocity, so slewing adds a
+ *	planned velocity * OVERRIDE_SLEW_RATE acceleration term (333 mm/s^2 at 10000 mm/min),
+ *	and the slew starts and stops in one segment, which is a jerk step the planner never
+ *	saw. Keep OVERRIDE_SLEW_RATE low enough for that on the fastest moves.
+ */
+
+static float _exec_override()
+{
+	float factor = ((mr.gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) ?
+					mr.traverse_override : mr.feed_override) / 100.0;
+	float ratio = 1.0;
+	if (mr.planned_override > EPSILON) {
+		ratio = min(max(factor / mr.planned_override, 0.01), 1.0);
+	}
+	float slew = OVERRIDE_SLEW_RATE * mr.segment_time * 60;
+	mr.override = min(max(ratio, mr.override - slew), mr.override + slew);
+	return (mr.segment_time / mr.override);
+}
+
+/*
+ * mp_set_runtime_override() - pass the current override factors to the runtime
+ *
+ *	Called from the foreground. The factors are kept as single byte percentages so the
+ *	exec interrupt never sees a half written value.
+ */
+
+void mp_set_runtime_override(const float feed_factor, const float traverse_factor)
+{
+	mr.feed_override = (uint8_t)min(round(feed_factor * 100), 255);
+	mr.traverse_override = (uint8_t)min(round(traverse_factor * 100), 255);
+}
+
+/*
+ * _exec_advance() - add the pressure advance offset to the extruder axes of a segment
+ *
+ *	An extruder axis with a pressure advance time K is driven ahead of its commanded
+ *	position by K times its commanded velocity, so nozzle pressure builds as the head
+ *	speeds up and bleeds off as it slows down. Only moves that extrude while XYZ moves get
+ *	a lead; on retracts and travel the offset returns to zero. The offset follows its
+ *	target through a first order filter with time constant $pas so velocity steps at
+ *	junctions don't become step bursts. The filter runs through the tail of a stopping
+ *	move as well, so the lead bleeds off with the deceleration rather than in one segment.
+ *
+ *	The rate the lead changes at is limited twice. Its own acceleration is held to what
+ *	the axis jerk reaches in one filter time constant (or one segment, if longer). Then
+ *	the extruder's total rate is held under the axis velocity_max and STEP_RATE_MAX. The
+ *	limits never cut into commanded travel, only the lead.
+ *
+ *	Whatever lead the filter or the limits leave at the end of a move stays in place
+ *	through dwells, program stops and idle - the extruder is still ahead by that much.
+ *	It bleeds off in the segments of the next move, extruding or not, and is dropped
+ *	whenever the steps are resynchronized to the runtime position.
+ *
+ *	The offset is kept in mr.advance, not in mr.position, so waypoints and reported
+ *	positions are unaffected. mr.advance_velocity holds the lead rate of the last segment.
+ *
+ *	segment_time is the time the segment actually runs, after any runtime override
+ *	stretch (see _exec_override()), and the commanded velocity is scaled by mr.override
+ *	to match. The lead therefore tracks the overridden speed, not the planned one.
+ */
+
+static void _exec_advance(float target[], const float segment_time)
+{
+	uint8_t printing = (fp_NOT_ZERO(mr.unit[AXIS_X]) || fp_NOT_ZERO(mr.unit[AXIS_Y]) || fp_NOT_ZERO(mr.unit[AXIS_Z]));
+	float seconds = segment_time * 60;
+	float filter = seconds / (seconds + cm.advance_smoothing);
+	float ramp_time = max(cm.advance_smoothing, seconds);
+
+	for (uint8_t axis=AXIS_A; axis<AXES; axis++) {
+		if (fp_ZERO(cm.a[axis].pressure_advance) && fp_ZERO(mr.advance[axis])) {
+			mr.advance_velocity[axis] = 0;
+			continue;
+		}
+
+		float steps_per_unit = 0;
+		for (uint8_t motor=0; motor<MOTORS; motor++) {
+			if ((st_cfg.mot[motor].motor_map == axis) && (st_cfg.mot[motor].steps_per_unit > steps_per_unit)) {
+				steps_per_unit = st_cfg.mot[motor].steps_per_unit;
+			}
+		}
+		if (fp_ZERO(steps_per_unit)) { continue;}					// no motor on this axis
+
+		float velocity = mr.unit[axis] * mr.segment_velocity * mr.override / 60;	// axis units per second
+		float offset = 0;
+		if (printing && (velocity > 0)) {
+			offset = cm.a[axis].pressure_advance * velocity;
+		}
+		offset = mr.advance[axis] + (offset - mr.advance[axis]) * filter;
+
+		// the lead's rate may only change as fast as the axis jerk allows
+		float jerk = cm.a[axis].jerk_max * JERK_MULTIPLIER / 216000;	// axis units per second^3
+		float lead_velocity = (offset - mr.advance[axis]) / seconds;
+		float lead_velocity_delta = jerk * ramp_time * seconds;
+		lead_velocity = min(max(lead_velocity, mr.advance_velocity[axis] - lead_velocity_delta),
+											   mr.advance_velocity[axis] + lead_velocity_delta);
+
+		// the lead may not push the segment past the rate limits (or further past the commanded travel)
+		float commanded = target[axis] - mr.position[axis];
+		float rate_max = min(cm.a[axis].velocity_max / 60, STEP_RATE_MAX / steps_per_unit);
+		float travel_max = max(rate_max * seconds, fabs(commanded));
+		float travel = min(max(commanded + lead_velocity * seconds, -travel_max), travel_max);
+
+		mr.advance_velocity[axis] = (travel - commanded) / seconds;
+		mr.advance[axis] += travel - commanded;
+		target[axis] += mr.advance[axis];
+	}
+}
+
+/*
+ * mp_set_pso_interval() - set the PSO pulse spacing. Called from a queued command
+ * _exec_pso() - set up the position-synchronized output pulses for the next segment
+ *
+ *	Pulses are spaced mr.pso_interval apart along the path, starting where the interval
+ *	was set. The DDA steps uniformly in time within a segment, so a distance into the
+ *	segment maps directly to a DDA tick. The stepper ISR fires the output on those ticks.
+ *	_exec_pso() is passed the same segment time as st_prep_line(), after any runtime
+ *	override stretch (see _exec_override()), so pulses stay on the path under override.
+ *
+ *	Tick positions are floored and checked against the segment's tick count, which is
+ *	truncated the same way as dda_ticks in st_prep_line(), so every pulse scheduled here
+ *	fires before the loader replaces the segment. mr.pso_to_next only advances over the
+ *	pulses that were scheduled. Any that did not fit - past the last tick, over the 255
+ *	per-segment limit, or bunched by the 2 tick minimum spacing - carry into the next
+ *	segment with a negative distance and fire at its start. Pulses come late, never lost.
+ */
+
+void mp_set_pso_interval(const float interval)
+{
+	mr.pso_interval = max(interval, 0);
+	mr.pso_to_next = 0;
+}
+
+static void _exec_pso(const float segment_time)
+{
+	float length = get_axis_vector_length(mr.gm.target, mr.position);
+	float ticks = (float)(int32_t)(segment_time * 60 * FREQUENCY_DDA);	// same as dda_ticks
+
+	if ((length < EPSILON) || (ticks < 1)) {			// nothing to place pulses along
+		mr.pso_to_next -= length;
+		return;
+	}
+	float ticks_per_mm = ticks / length;
+	float first = max(floor(mr.pso_to_next * ticks_per_mm), 1);	// ISR counts ticks from 1
+	float interval = min(max(floor(mr.pso_interval * ticks_per_mm), 2), UINT16_MAX);
+
+	if ((mr.pso_to_next >= length) || (first > ticks)) {	// no pulse in this segment
+		mr.pso_to_next -= length;
+		return;
+	}
+	float count = min(floor((ticks - first) / interval) + 1, UINT8_MAX);
+	st_prep_pso((uint16_t)first, (uint16_t)interval, (uint8_t)count);
+	mr.pso_to_next += count * mr.pso_interval - length;
+}
@@ -32,15 +32,23 @@
 #include "canonical_machine.h"
 #include "planner.h"
 #include "stepper.h"
+#include "step_stream.h"
 #include "report.h"
 #include "util.h"
 
 // aline planner routines / feedhold planning
 //static void _calc_move_times(GCodeState_t *gms, const float position[]);
-static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[]);
+static float _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[]);
+static void _set_unit_and_jerk(mpBuf_t *bf, const float axis_length[], const float axis_square[], const float length_square, const uint8_t traverse);
 static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag);
-static float _get_junction_vmax(const float a_unit[], const float b_unit[]);
+static float _get_junction_vmax(const float a_unit[], const float b_unit[], const uint8_t traverse);
+static void _hand_off_turns(mpBuf_t *bf);
 static void _reset_replannable_list(void);
+#ifdef __PLAN_OPTIMAL
+static void _match_exit_velocities(mpBuf_t *bp, const mpBuf_t *first);
+#else
+static uint8_t _get_run_distance(const mpBuf_t *bp);
+#endif
 
 /* Runtime-specific setters and getters
  *
@@ -50,13 +58,15 @@ static void _reset_replannable_list(void);
  * mp_set_runtime_work_offset()		- set offsets in the MR struct
  * mp_get_runtime_work_position() 	- returns current axis position in work coordinates
  *									  that were in effect at move planning time
+ * mp_get_runtime_turns()			- returns whole turns removed from a modulo axis position
  */
 
 void mp_zero_segment_velocity() { mr.segment_velocity = 0;}
-float mp_get_runtime_velocity(void) { return (mr.segment_velocity);}
+float mp_get_runtime_velocity(void) { return (mr.segment_velocity * mr.override);}
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]);}
 void mp_set_runtime_work_offset(float offset[]) { copy_vector(mr.gm.work_offset, offset);}
 float mp_get_runtime_work_position(uint8_t axis) { return (mr.position[axis] - mr.gm.work_offset[axis]);}
+float mp_get_runtime_turns(uint8_t axis) { return ((axis >= AXIS_A) ? (float)mr.turns[axis - AXIS_A] : 0);}
 
 /*
  * mp_get_runtime_busy() - return TRUE if motion control busy (i.e. robot is moving)
@@ -110,8 +120,9 @@ stat_t mp_aline(GCodeState_t *gm_in)
 		length_square += axis_square[axis];
 	}
 	float length = sqrt(length_square);
+	uint8_t traverse = (gm_in->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE);
 
-	if (fp_ZERO(length)) {
+	if (fp_ZERO(length)) {
 //		sr_request_status_report();
 		return (STAT_OK);
 	}
@@ -125,9 +136,9 @@ stat_t mp_aline(GCodeState_t *gm_in)
 	//	(2) Previous block is optimally planned. Vi = previous block's exit_velocity
 	//	(3) Previous block is not optimally planned. Vi <= previous block's entry_velocity + delta_velocity
 
-	_calc_move_times(gm_in, axis_length, axis_square);						// set move time and minimum time in the state
+	float override = _calc_move_times(gm_in, axis_length, axis_square);	// set move time and minimum time in the state
 	if (gm_in->move_time < MIN_BLOCK_TIME) {
-		float delta_velocity = pow(length, 0.66666666) * mm.cbrt_jerk;		// max velocity change for this move
+		float delta_velocity = pow(length, 0.66666666) * mm.cbrt_jerk[traverse];// max velocity change for this move
 		float entry_velocity = 0;											// pre-set as if no previous block
 		if ((bf = mp_get_run_buffer()) != NULL) {
 			if (bf->replannable == true) {									// not optimally planned
@@ -145,7 +156,8 @@ stat_t mp_aline(GCodeState_t *gm_in)
 	if ((bf = mp_get_write_buffer()) == NULL)
         return(cm_hard_alarm(STAT_BUFFER_FULL_FATAL));                  // never supposed to fail
 	bf->bf_func = mp_exec_aline;										// register the callback to the exec function
-	bf->length = length;
+	bf->length = length;
+	bf->override = override;
 	memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));						// copy model state into planner buffer
 
 	// Compute the unit vector and find the right jerk to use (combined operations)
@@ -207,30 +219,7 @@ stat_t mp_aline(GCodeState_t *gm_in)
 	// of the jerk-limit axis's unit vector term. This way when the move is finally decomposed into
 	// its constituent axes for execution the jerk for that axis will be at it's maximum value.
 
-	float C;					// contribution term. C = T * a
-	float maxC = 0;
-	float recip_L2 = 1/length_square;
-
-	for (uint8_t axis=0; axis<AXES; axis++) {
-		if (fabs(axis_length[axis]) > 0) {								// You cannot use the fp_XXX comparisons here!
-			bf->unit[axis] = axis_length[axis] / bf->length;			// compute unit vector term (zeros are already zero)
-			C = axis_square[axis] * recip_L2 * cm.a[axis].recip_jerk;	// squaring axis_length ensures it's positive
-			if (C > maxC) {
-				maxC = C;
-				bf->jerk_axis = axis;						// also needed for junction vmax calculation
-			}
-		}
-	}
-	// set up and pre-compute the jerk terms needed for this round of planning
-	bf->jerk = cm.a[bf->jerk_axis].jerk_max * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);	// scale the jerk
-
-	if (fabs(bf->jerk - mm.jerk) > JERK_MATCH_PRECISION) {	// specialized comparison for tolerance of delta
-		mm.jerk = bf->jerk;									// used before this point next time around
-		mm.recip_jerk = 1/bf->jerk;							// compute cached jerk terms used by planning
-		mm.cbrt_jerk = cbrt(bf->jerk);
-	}
-	bf->recip_jerk = mm.recip_jerk;
-	bf->cbrt_jerk = mm.cbrt_jerk;
+	_set_unit_and_jerk(bf, axis_length, axis_square, length_square, traverse);
 
 	// finish up the current block variables
 	if (cm_get_path_control(MODEL) != PATH_EXACT_STOP) { 	// exact stop cases already zeroed
@@ -238,24 +227,182 @@ stat_t mp_aline(GCodeState_t *gm_in)
 		exact_stop = 8675309;								// an arbitrarily large floating point number
 	}
 	bf->cruise_vmax = bf->length / bf->gm.move_time;		// target velocity requested
-	junction_velocity = _get_junction_vmax(bf->pv->unit, bf->unit);
+	junction_velocity = _get_junction_vmax(bf->pv->unit, bf->unit,
+				(traverse && (bf->pv->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE)));
 	bf->entry_vmax = min3(bf->cruise_vmax, junction_velocity, exact_stop);
 	bf->delta_vmax = mp_get_target_velocity(0, bf->length, bf);
 	bf->exit_vmax = min3(bf->cruise_vmax, (bf->entry_vmax + bf->delta_vmax), exact_stop);
 	bf->braking_velocity = bf->delta_vmax;
 
 	// Note: these next lines must remain in exact order. Position must update before committing the buffer.
-	_plan_block_list(bf, &mr_flag);				// replan block list
+	_plan_block_list(bf, &mr_flag);				// replan block list
+	_hand_off_turns(bf);						// modulo axis wraps since the last block
 	copy_vector(mm.position, bf->gm.target);	// set the planner position
 	mp_commit_write_buffer(MOVE_TYPE_ALINE); 	// commit current block (must follow the position update)
 	return (STAT_OK);
 }
 
+/*
+ * mp_aline_preplanned() - queue a line whose velocity profile was planned by the host
+ *
+ *	The host supplies entry, cruise and exit velocities (mm/min). The block bypasses
+ *	look-ahead: it is committed non-replannable with the given velocities, and the
+ *	trapezoid is computed by the same mp_calculate_trapezoid() used for planned blocks.
+ *	It is rejected unless it meets the limits the planner itself would enforce:
+ *
+ *	  - cruise must not exceed any participating axis' feedrate_max
+ *	  - entry and exit must not exceed cruise
+ *	  - entry must not exceed the junction velocity with the previous block
+ *	  - entry must match the exit velocity of the previous queued line (or 0 if none)
+ *	  - the head and tail must fit in the move length at the jerk of the jerk-limit axis
+ *
+ *	The host is responsible for ending the sequence at zero velocity.
+ *
+ *	Host velocities are taken as planned at 100% override. A feed or traverse override
+ *	below 100% still slows these blocks at runtime (see _exec_override()), so the host
+ *	profile runs stretched in time but on the same path. Overrides above 100% do not
+ *	speed them up.
+ */
+stat_t mp_aline_preplanned(GCodeState_t *gm_in, const float entry, const float cruise, const float exit)
+{
+	mpBuf_t *bf;
+	float axis_length[AXES];
+	float axis_square[AXES];
+	float length_square = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		axis_length[axis] = gm_in->target[axis] - mm.position[axis];
+		axis_square[axis] = square(axis_length[axis]);
+		length_square += axis_square[axis];
+	}
+	float length = sqrt(length_square);
+
+	if (fp_ZERO(length)) {
+		return (STAT_OK);
+	}
+	if ((entry < 0) || (exit < 0) || (cruise < EPSILON) || (entry > cruise) || (exit > cruise)) {
+		return (STAT_REQUESTED_VELOCITY_EXCEEDS_LIMITS);
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (fabs(axis_length[axis]) > 0) {
+			if (cruise * fabs(axis_length[axis]) / length > cm.a[axis].feedrate_max) {
+				return (STAT_REQUESTED_VELOCITY_EXCEEDS_LIMITS);
+			}
+		}
+	}
+	if ((bf = mp_get_write_buffer()) == NULL)
+        return(cm_hard_alarm(STAT_BUFFER_FULL_FATAL));					// never supposed to fail
+	bf->length = length;
+	bf->override = 1.0;													// host plans at 100% - see above
+	uint8_t traverse = (gm_in->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE);
+	_set_unit_and_jerk(bf, axis_length, axis_square, length_square, traverse);
+
+	// the previous buffer is only meaningful if it is a line still queued or running
+	float entry_expected = 0;
+	float junction_velocity = 8675309;
+	if ((bf->pv->move_type == MOVE_TYPE_ALINE) && (bf->pv->buffer_state != MP_BUFFER_EMPTY)) {
+		entry_expected = bf->pv->exit_velocity;
+		junction_velocity = _get_junction_vmax(bf->pv->unit, bf->unit,
+					(traverse && (bf->pv->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE)));
+	}
+	if (entry > junction_velocity + PREPLANNED_VELOCITY_TOLERANCE) {
+		mp_unget_write_buffer();
+		return (STAT_PREPLANNED_VELOCITY_MISMATCH);
+	}
+	if (fabs(entry - entry_expected) > PREPLANNED_VELOCITY_TOLERANCE) {
+		mp_unget_write_buffer();
+		return (STAT_PREPLANNED_VELOCITY_MISMATCH);
+	}
+	if ((mp_get_target_length(entry, cruise, bf) + mp_get_target_length(exit, cruise, bf)) >
+		(length * (1 + PREPLANNED_LENGTH_TOLERANCE))) {
+		mp_unget_write_buffer();
+		return (STAT_PREPLANNED_JERK_EXCEEDS_LIMITS);
+	}
+
+	memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));
+	bf->gm.move_time = length / cruise;
+	bf->gm.minimum_time = bf->gm.move_time;
+	bf->bf_func = mp_exec_aline;
+	bf->replannable = false;								// the host plan is final
+
+	// vmax terms are set so a feedhold can still replan through this block
+	bf->entry_vmax = entry;
+	bf->cruise_vmax = cruise;
+	bf->exit_vmax = exit;
+	bf->delta_vmax = mp_get_target_velocity(0, length, bf);
+	bf->braking_velocity = bf->delta_vmax;
+	bf->entry_velocity = entry_expected;					// removes any residual tolerance error
+	bf->cruise_velocity = cruise;
+	bf->exit_velocity = exit;
+	mp_calculate_trapezoid(bf);
+
+	_hand_off_turns(bf);									// modulo axis wraps since the last block
+	copy_vector(mm.position, bf->gm.target);				// set the planner position
+	mp_commit_write_buffer(MOVE_TYPE_ALINE);				// commit current block (must follow the position update)
+	return (STAT_OK);
+}
+
+/*
+ * _hand_off_turns() - move pending modulo axis turns onto the block being queued
+ */
+static void _hand_off_turns(mpBuf_t *bf)
+{
+	for (uint8_t i=0; i<MODULO_AXES; i++) {
+		int16_t turns = mm.turns[i];
+		if (turns > MODULO_TURNS_MAX) turns = MODULO_TURNS_MAX;
+		if (turns < -MODULO_TURNS_MAX) turns = -MODULO_TURNS_MAX;
+		bf->turns[i] = (int8_t)turns;
+		mm.turns[i] -= turns;
+	}
+}
+
+/*
+ * _set_unit_and_jerk() - compute the unit vector and the jerk terms for a block
+ *
+ *	See the notes in mp_aline() for how the jerk-limit axis is chosen.
+ *	Traverses (G0) use the axis traverse jerk if one is set. Feeds and traverses
+ *	have separate cache entries so interleaved G0/G1 moves keep their cbrt().
+ */
+static void _set_unit_and_jerk(mpBuf_t *bf, const float axis_length[], const float axis_square[], const float length_square, const uint8_t traverse)
+{
+	float C;					// contribution term. C = T * a
+	float maxC = 0;
+	float recip_L2 = 1/length_square;
+	float recip_jerk;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (fabs(axis_length[axis]) > 0) {								// You cannot use the fp_XXX comparisons here!
+			bf->unit[axis] = axis_length[axis] / bf->length;			// compute unit vector term (zeros are already zero)
+			recip_jerk = cm.a[axis].recip_jerk;
+			if (traverse && (cm.a[axis].jerk_traverse > 0)) recip_jerk = cm.a[axis].recip_jerk_traverse;
+			C = axis_square[axis] * recip_L2 * recip_jerk;				// squaring axis_length ensures it's positive
+			if (C > maxC) {
+				maxC = C;
+				bf->jerk_axis = axis;						// also needed for junction vmax calculation
+			}
+		}
+	}
+	// set up and pre-compute the jerk terms needed for this round of planning
+	float jerk = cm.a[bf->jerk_axis].jerk_max;
+	if (traverse && (cm.a[bf->jerk_axis].jerk_traverse > 0)) jerk = cm.a[bf->jerk_axis].jerk_traverse;
+	bf->jerk = jerk * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);	// scale the jerk
+
+	if (fabs(bf->jerk - mm.jerk[traverse]) > JERK_MATCH_PRECISION) {	// specialized comparison for tolerance of delta
+		mm.jerk[traverse] = bf->jerk;						// used before this point next time around
+		mm.recip_jerk[traverse] = 1/bf->jerk;				// compute cached jerk terms used by planning
+		mm.cbrt_jerk[traverse] = cbrt(bf->jerk);
+	}
+	bf->recip_jerk = mm.recip_jerk[traverse];
+	bf->cbrt_jerk = mm.cbrt_jerk[traverse];
+}
+
 /***** ALINE HELPERS *****
  * _calc_move_times()
  * _plan_block_list()
  * _get_junction_vmax()
  * _reset_replannable_list()
+ * _get_run_distance()
+ * _match_exit_velocities()
  */
 
 /*
@@ -277,9 +424,16 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *	  -	time for coordinated move at requested feed rate
  *	  -	time that the slowest axis would require for the move
  *
- *	Sets the following variables in the gcode_state struct
- *	  - move_time is set to optimal time
- *	  - minimum_time is set to minimum time
+ *	Feed and traverse override factors (cm.gmx) scale the feed rate and traverse velocity
+ *	of the block being planned. Blocks already in the planner are slowed at runtime if the
+ *	override drops below what they were planned at (see _exec_override()).
+ *
+ *	Sets the following variables in the gcode_state struct
+ *	  - move_time is set to optimal time
+ *	  - minimum_time is set to minimum time
+ *
+ *	Returns the override factor the move time actually reflects, which is less than the
+ *	requested factor if an axis feedrate_max limits the move.
  */
 /* --- NIST RS274NGC_v3 Guidance ---
  *
@@ -316,7 +470,7 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *		any time required for acceleration or deceleration.
  */
 
-static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[])
+static float _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[])
 										// gms = Gcode model state
 {
 	float inv_time=0;				// inverse time if doing a feed in G93 mode
@@ -324,26 +478,33 @@ static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const
 	float abc_time=0;				// coordinated move rotary part at requested feed rate
 	float max_time=0;				// time required for the rate-limiting axis
 	float tmp_time=0;				// used in computation
+	float feed_override = 1.0;		// realtime / M50 overrides applied as the block is planned
+	float traverse_override = 1.0;
 	gms->minimum_time = 8675309;	// arbitrarily large number
 
+	if ((cm.gmx.feed_rate_override_enable == true) && (cm.gmx.feed_rate_override_factor > 0))
+		feed_override = cm.gmx.feed_rate_override_factor;
+	if ((cm.gmx.traverse_override_enable == true) && (cm.gmx.traverse_override_factor > 0))
+		traverse_override = min(cm.gmx.traverse_override_factor, 1.0);
+
 	// compute times for feed motion
 	if (gms->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
 		if (gms->feed_rate_mode == INVERSE_TIME_MODE) {
-			inv_time = gms->feed_rate;	// NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
+			inv_time = gms->feed_rate / feed_override;	// NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
 			gms->feed_rate_mode = UNITS_PER_MINUTE_MODE;
 		} else {
 			// compute length of linear move in millimeters. Feed rate is provided as mm/min
-			xyz_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / gms->feed_rate;
+			xyz_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / (gms->feed_rate * feed_override);
 
 			// if no linear axes, compute length of multi-axis rotary move in degrees. Feed rate is provided as degrees/min
 			if (fp_ZERO(xyz_time)) {
-				abc_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / gms->feed_rate;
+				abc_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / (gms->feed_rate * feed_override);
 			}
 		}
 	}
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		if (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
-			tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
+			tmp_time = fabs(axis_length[axis]) / (cm.a[axis].velocity_max * traverse_override);
 		} else { // MOTION_MODE_STRAIGHT_FEED
 			tmp_time = fabs(axis_length[axis]) / cm.a[axis].feedrate_max;
 		}
@@ -353,7 +514,13 @@ static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const
 			gms->minimum_time = min(gms->minimum_time, tmp_time);
 		}
 	}
-	gms->move_time = max4(inv_time, max_time, xyz_time, abc_time);
+	gms->move_time = max4(inv_time, max_time, xyz_time, abc_time);
+
+	if (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+		return (traverse_override);
+	}
+	float nominal_time = max4(inv_time * feed_override, max_time, xyz_time * feed_override, abc_time * feed_override);
+	return ((gms->move_time > 0) ? (nominal_time / gms->move_time) : feed_override);
 }
 
 /* _plan_block_list() - plans the entire block list
@@ -367,8 +534,13 @@ static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const
  *	If blocks following the first block are already optimally planned (non replannable)
  *	the first block that is not optimally planned becomes the effective first block.
  *
- *	_plan_block_list() plans all blocks between and including the (effective) first block
- *	and the bf. It sets entry, exit and cruise v's from vmax's then calls trapezoid generation.
+ *	_plan_block_list() plans all blocks between and including the (effective) first block
+ *	and the bf. It sets entry, exit and cruise v's from vmax's then calls trapezoid generation
+ *	for blocks within PLANNER_JIT_DEPTH of the run buffer. Trapezoids for blocks further back
+ *	are deferred to mp_exec_aline() (zoid_pending) as their velocities will likely change again.
+ *
+ *	With __PLAN_OPTIMAL all trapezoids are computed, blocks are never marked as optimally
+ *	planned, and degraded entries are matched by the blocks behind them. See planner.h
  *
  *	Variables that must be provided in the mpBuffers that will be processed:
  *
@@ -435,6 +607,10 @@ static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
 		bp->braking_velocity = min(bp->nx->entry_vmax, bp->nx->braking_velocity) + bp->delta_vmax;
 	}
 
+#ifdef __PLAN_OPTIMAL
+	const mpBuf_t *first = bp->nx;						// its entry is fixed by the block ahead
+#endif
+
 	// forward planning pass - recomputes trapezoids in the list from the first block to the bf block.
 	while ((bp = mp_get_next_buffer(bp)) != bf) {
 		if ((bp->pv == bf) || (*mr_flag == true))  {
@@ -449,21 +625,40 @@ static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
 								  bp->nx->braking_velocity,
 								 (bp->entry_velocity + bp->delta_vmax) );
 
+#ifdef __PLAN_OPTIMAL
 		mp_calculate_trapezoid(bp);
+		_match_exit_velocities(bp, first);
+#else
+		if (_get_run_distance(bp) < PLANNER_JIT_DEPTH) {
+			mp_calculate_trapezoid(bp);
+		} else {
+			bp->zoid_pending = true;					// computed by mp_exec_aline()
+		}
 
 		// test for optimally planned trapezoids - only need to check various exit conditions
-		if  ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
-				(fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
-			  ( (bp->pv->replannable == false) &&
-				(fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) {
-			bp->replannable = false;
-		}
+		// A pending exit has not been through a trapezoid yet so it stays replannable
+		if  ( (bp->zoid_pending == false) && ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
+				(fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
+			  ( (bp->pv->replannable == false) &&
+				(fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) ) {
+			bp->replannable = false;
+		}
+#endif
 	}
 	// finish up the last block move
 	bp->entry_velocity = bp->pv->exit_velocity;
 	bp->cruise_velocity = bp->cruise_vmax;
 	bp->exit_velocity = 0;
+#ifdef __PLAN_OPTIMAL
 	mp_calculate_trapezoid(bp);
+	_match_exit_velocities(bp, first);
+#else
+	if (_get_run_distance(bp) < PLANNER_JIT_DEPTH) {
+		mp_calculate_trapezoid(bp);
+	} else {
+		bp->zoid_pending = true;
+	}
+#endif
 }
 
 /*
@@ -479,6 +674,34 @@ static void _reset_replannable_list()
 	} while (((bp = mp_get_next_buffer(bp)) != bf) && (bp->move_state != MOVE_OFF));
 }
 
+/*
+ *	_get_run_distance() - number of buffers from the run buffer to bp (0 for the run buffer)
+ */
+#ifndef __PLAN_OPTIMAL
+static uint8_t _get_run_distance(const mpBuf_t *bp)
+{
+	return ((uint8_t)((bp - mb.r + PLANNER_BUFFER_POOL_SIZE) % PLANNER_BUFFER_POOL_SIZE));
+}
+#endif
+
+/*
+ *	_match_exit_velocities() - pull exits down to an entry that a trapezoid had to lower
+ *
+ *	The T" and body-only HT cases lower the entry of a block that is too short to shed its
+ *	velocity. Each block behind it is replanned to exit at the lowered entry, which may in
+ *	turn lower its own entry. Stops at the first block in the list, whose entry is fixed.
+ */
+#ifdef __PLAN_OPTIMAL
+static void _match_exit_velocities(mpBuf_t *bp, const mpBuf_t *first)
+{
+	while ((bp != first) && (bp->pv->exit_velocity > (bp->entry_velocity + PLANNER_JUNCTION_TOLERANCE))) {
+		bp = bp->pv;
+		bp->exit_velocity = bp->nx->entry_velocity;
+		mp_calculate_trapezoid(bp);
+	}
+}
+#endif
+
 /*
  * _get_junction_vmax() - Sonny's algorithm - simple
  *
@@ -537,7 +760,7 @@ static void _reset_replannable_list()
  *	 	d		Delta of sums			(Dx*Ux+DY*UY)/Usum
  */
 
-static float _get_junction_vmax(const float a_unit[], const float b_unit[])
+static float _get_junction_vmax(const float a_unit[], const float b_unit[], const uint8_t traverse)
 {
 	float costheta = - (a_unit[AXIS_X] * b_unit[AXIS_X])
 					 - (a_unit[AXIS_Y] * b_unit[AXIS_Y])
@@ -549,20 +772,27 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
 	if (costheta < -0.99) { return (10000000); } 		// straight line cases
 	if (costheta > 0.99)  { return (0); } 				// reversal cases
 
+	// Junctions between two traverses use the traverse deviations where set
+	float dev[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		dev[axis] = cm.a[axis].junction_dev;
+		if (traverse && (cm.a[axis].junction_dev_traverse > 0)) dev[axis] = cm.a[axis].junction_dev_traverse;
+	}
+
 	// Fuse the junction deviations into a vector sum
-	float a_delta = square(a_unit[AXIS_X] * cm.a[AXIS_X].junction_dev);
-	a_delta += square(a_unit[AXIS_Y] * cm.a[AXIS_Y].junction_dev);
-	a_delta += square(a_unit[AXIS_Z] * cm.a[AXIS_Z].junction_dev);
-	a_delta += square(a_unit[AXIS_A] * cm.a[AXIS_A].junction_dev);
-	a_delta += square(a_unit[AXIS_B] * cm.a[AXIS_B].junction_dev);
-	a_delta += square(a_unit[AXIS_C] * cm.a[AXIS_C].junction_dev);
-
-	float b_delta = square(b_unit[AXIS_X] * cm.a[AXIS_X].junction_dev);
-	b_delta += square(b_unit[AXIS_Y] * cm.a[AXIS_Y].junction_dev);
-	b_delta += square(b_unit[AXIS_Z] * cm.a[AXIS_Z].junction_dev);
-	b_delta += square(b_unit[AXIS_A] * cm.a[AXIS_A].junction_dev);
-	b_delta += square(b_unit[AXIS_B] * cm.a[AXIS_B].junction_dev);
-	b_delta += square(b_unit[AXIS_C] * cm.a[AXIS_C].junction_dev);
+	float a_delta = square(a_unit[AXIS_X] * dev[AXIS_X]);
+	a_delta += square(a_unit[AXIS_Y] * dev[AXIS_Y]);
+	a_delta += square(a_unit[AXIS_Z] * dev[AXIS_Z]);
+	a_delta += square(a_unit[AXIS_A] * dev[AXIS_A]);
+	a_delta += square(a_unit[AXIS_B] * dev[AXIS_B]);
+	a_delta += square(a_unit[AXIS_C] * dev[AXIS_C]);
+
+	float b_delta = square(b_unit[AXIS_X] * dev[AXIS_X]);
+	b_delta += square(b_unit[AXIS_Y] * dev[AXIS_Y]);
+	b_delta += square(b_unit[AXIS_Z] * dev[AXIS_Z]);
+	b_delta += square(b_unit[AXIS_A] * dev[AXIS_A]);
+	b_delta += square(b_unit[AXIS_B] * dev[AXIS_B]);
+	b_delta += square(b_unit[AXIS_C] * dev[AXIS_C]);
 
 	float delta = (sqrt(a_delta) + sqrt(b_delta))/2;
 	float sintheta_over2 = sqrt((1 - costheta)/2);
@@ -736,6 +966,7 @@ stat_t mp_plan_hold_callback()
 	bp->exit_vmax = 0;
 
 	bp = mp_get_next_buffer(bp);				// point to the acceleration buffer
+	memset(bp->turns, 0, sizeof(bp->turns));	// the decel buffer removes the turns; don't do it twice
 	bp->entry_vmax = 0;
 	bp->length -= braking_length;				// the buffers were identical (and hence their lengths)
 	bp->delta_vmax = mp_get_target_velocity(0, bp->length, bp);
@@ -755,7 +986,7 @@ stat_t mp_end_hold()
 	if (cm.hold_state == FEEDHOLD_END_HOLD) {
 		cm.hold_state = FEEDHOLD_OFF;
 		mpBuf_t *bf;
-		if ((bf = mp_get_run_buffer()) == NULL) {	// NULL means nothing's running
+		if (((bf = mp_get_run_buffer()) == NULL) && (ss_get_mode() == false)) {	// nothing's running
 			cm_set_motion_state(MOTION_STOP);
 			return (STAT_NOOP);
 		}
@@ -32,8 +32,29 @@
 #include "report.h"
 #include "util.h"
 
+static void _calculate_trapezoid(mpBuf_t *bf, const float pv_exit_velocity);
+
 /*
- * mp_calculate_trapezoid() - calculate trapezoid parameters
+ * mp_calculate_trapezoid()		- calculate trapezoid parameters
+ * mp_calculate_trapezoid_jit() - calculate a deferred trapezoid as the block starts to run
+ *
+ *	_plan_block_list() only maintains the velocities of blocks far from the run buffer and
+ *	marks them zoid_pending. Their velocities are likely to change again before they run,
+ *	so the trapezoid is computed once, by mp_exec_aline(), when the block is about to run.
+ *	At that point the previous block has already been freed, so its actual exit velocity is
+ *	passed in and becomes the entry, as it would in the forward pass. The previous trapezoid
+ *	may have lowered that exit (T" / H" cases) or raised it (B" and the body-only HT case).
+ *	A raised entry is held to entry_vmax and to what the block can shed before its exit
+ *	(exit + delta_vmax); past those limits the junction takes the same velocity step the
+ *	forward pass would give it. Pending blocks stay replannable until their trapezoid has
+ *	run, so a block planned immediately always follows one that was too.
+ *
+ *	The JIT call runs in the exec (LO interrupt), once per pending block. Most cases cost a
+ *	few float operations and one or two sqrt()s. The worst case is the asymmetric HT' case,
+ *	which is capped at TRAPEZOID_ITERATION_MAX passes of two sqrt()s and one pow() each.
+ *	From avr-libc cycle counts that is an estimated 2 ms at 32 MHz (not measured on a
+ *	target). That is under the 5 ms nominal segment the exec is preparing it behind, and
+ *	the same work came out of every replan of the block in the foreground.
  *
  *	This rather brute-force and long-ish function sets section lengths and velocities
  *	based on the line length and velocities requested. It modifies the incoming
@@ -123,7 +144,21 @@
 #define MIN_BODY_LENGTH (MIN_SEGMENT_TIME_PLUS_MARGIN * bf->cruise_velocity)
 
 void mp_calculate_trapezoid(mpBuf_t *bf)
-{
+{
+	bf->zoid_pending = false;
+	_calculate_trapezoid(bf, bf->pv->exit_velocity);
+}
+
+void mp_calculate_trapezoid_jit(mpBuf_t *bf, const float pv_exit_velocity)
+{
+	if (bf->zoid_pending == false) return;
+	bf->zoid_pending = false;
+	bf->entry_velocity = min3(pv_exit_velocity, bf->entry_vmax, (bf->exit_velocity + bf->delta_vmax));
+	_calculate_trapezoid(bf, pv_exit_velocity);
+}
+
+static void _calculate_trapezoid(mpBuf_t *bf, const float pv_exit_velocity)
+{
 	//********************************************
 	//********************************************
 	//**   RULE #1 of mp_calculate_trapezoid()  **
@@ -151,7 +186,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 	// B" case: Block is short, but fits into a single body segment
 
 	if (bf->naiive_move_time <= NOM_SEGMENT_TIME) {
-		bf->entry_velocity = bf->pv->exit_velocity;
+		bf->entry_velocity = pv_exit_velocity;
 		if (fp_NOT_ZERO(bf->entry_velocity)) {
 			bf->cruise_velocity = bf->entry_velocity;
 			bf->exit_velocity = bf->entry_velocity;
@@ -237,10 +272,10 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 		}
 
 		// Asymmetric HT' rate-limited case. This is relatively expensive but it's not called very often
-		// iteration trap: uint8_t i=0;
-		// iteration trap: if (++i > TRAPEZOID_ITERATION_MAX) { fprintf_P(stderr,PSTR("_calculate_trapezoid() failed to converge"));}
-
+		// Iterations are capped as this also runs in the exec for deferred trapezoids
+
 		float computed_velocity = bf->cruise_vmax;
+		uint8_t i = 0;
 		do {
 			bf->cruise_velocity = computed_velocity;	// initialize from previous iteration
 			bf->head_length = mp_get_target_length(bf->entry_velocity, bf->cruise_velocity, bf);
@@ -252,8 +287,8 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 				bf->tail_length = (bf->tail_length / (bf->head_length + bf->tail_length)) * bf->length;
 				computed_velocity = mp_get_target_velocity(bf->exit_velocity, bf->tail_length, bf);
 			}
-			// insert iteration trap here if needed
-		} while ((fabs(bf->cruise_velocity - computed_velocity) / computed_velocity) > TRAPEZOID_ITERATION_ERROR_PERCENT);
+		} while ((++i < TRAPEZOID_ITERATION_MAX) &&
+				 ((fabs(bf->cruise_velocity - computed_velocity) / computed_velocity) > TRAPEZOID_ITERATION_ERROR_PERCENT));
 
 		// set velocity and clean up any parts that are too short
 		bf->cruise_velocity = computed_velocity;
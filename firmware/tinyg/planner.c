@@ -55,7 +55,9 @@
 #include "config.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_comp.h"
 #include "planner.h"
+#include "step_stream.h"
 #include "kinematics.h"
 #include "stepper.h"
 #include "encoder.h"
@@ -92,6 +94,8 @@ void planner_init()
 // If you know all memory has been zeroed by a hard reset you don't need these next 2 lines
 	memset(&mr, 0, sizeof(mr));	// clear all values, pointers and status
 	memset(&mm, 0, sizeof(mm));	// clear all values, pointers and status
+	mr.override = 1.0;
+	mp_set_runtime_override(1.0, 1.0);
 	planner_init_assertions();
 	mp_init_buffers();
 }
@@ -117,7 +121,7 @@ stat_t planner_test_assertions()
 }
 
 /*
- * mp_flush_planner() - flush all moves in the planner and all arcs
+ * mp_flush_planner() - flush all moves in the planner, all arcs, compensated and dogleg moves
  *
  *	Does not affect the move currently running in mr.
  *	Does not affect mm or gm model positions
@@ -127,7 +131,11 @@ stat_t planner_test_assertions()
 void mp_flush_planner()
 {
 	cm_abort_arc();
+	cm_abort_comp();
+	cm_abort_dogleg();
+	ss_flush();
 	mp_init_buffers();
+	for (uint8_t i=0; i<MODULO_AXES; i++) mm.turns[i] = 0;	// flushed blocks never wrapped the runtime
 	cm_set_motion_state(MOTION_STOP);
 }
 
@@ -154,13 +162,36 @@ void mp_flush_planner()
  *	still close to the starting point.
  */
 
-void mp_set_planner_position(uint8_t axis, const float position) { mm.position[axis] = position; }
-void mp_set_runtime_position(uint8_t axis, const float position) { mr.position[axis] = position; }
+void mp_set_planner_position(uint8_t axis, const float position)
+{
+	mm.position[axis] = position;
+	if (axis >= AXIS_A) mm.turns[axis - AXIS_A] = 0;		// position is now explicit - drop any pending wrap
+}
+
+void mp_set_runtime_position(uint8_t axis, const float position)
+{
+	mr.position[axis] = position;
+	if (axis >= AXIS_A) mr.turns[axis - AXIS_A] = 0;
+}
+
+/*
+ * mp_wrap_planner_position() - remove whole turns from a modulo axis planner position
+ *
+ *	Called by the model between moves. The turns are handed to the next block queued by
+ *	mp_aline() and removed from the runtime position when that block starts to execute.
+ */
+void mp_wrap_planner_position(uint8_t axis, const int16_t turns)
+{
+	mm.position[axis] -= 360 * (float)turns;
+	mm.turns[axis - AXIS_A] += turns;
+}
 
 void mp_set_steps_to_runtime_position()
 {
 	float step_position[MOTORS];
 	ik_kinematics(mr.position, step_position);				// convert lengths to steps in floating point
+	memset(mr.advance, 0, sizeof(mr.advance));				// steps now match the position without advance
+	memset(mr.advance_velocity, 0, sizeof(mr.advance_velocity));
 	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 		mr.target_steps[motor] = step_position[motor];
 		mr.position_steps[motor] = step_position[motor];
@@ -205,6 +236,7 @@ void mp_queue_command(void(*cm_exec)(float[], float[]), float *value, float *fla
 	}
 
 	bf->move_type = MOVE_TYPE_COMMAND;
+	bf->gm.linenum = cm.gm.linenum;						// for step-stream recording
 	bf->bf_func = _exec_command;						// callback to planner queue exec function
 	bf->cm_func = cm_exec;								// callback to canonical machine exec function
 
@@ -217,6 +249,7 @@ void mp_queue_command(void(*cm_exec)(float[], float[]), float *value, float *fla
 
 static stat_t _exec_command(mpBuf_t *bf)
 {
+	if (ss.record == true) ss_record_marker(bf->gm.linenum);
 	st_prep_command(bf);
 	return (STAT_OK);
 }
@@ -246,6 +279,7 @@ stat_t mp_dwell(float seconds)
 
 	bf->bf_func = _exec_dwell;							// register callback to dwell start
 	bf->gm.move_time = seconds;							// in seconds, not minutes
+	bf->gm.linenum = cm.gm.linenum;						// for step-stream recording
 	bf->move_state = MOVE_NEW;
 	mp_commit_write_buffer(MOVE_TYPE_DWELL);			// must be final operation before exit
 	return (STAT_OK);
@@ -253,6 +287,7 @@ stat_t mp_dwell(float seconds)
 
 static stat_t _exec_dwell(mpBuf_t *bf)
 {
+	if (ss.record == true) ss_record_marker(bf->gm.linenum);
 	st_prep_dwell((uint32_t)(bf->gm.move_time * 1000000));// convert seconds to uSec
 	if (mp_free_run_buffer()) cm_cycle_end();			// free buffer & perform cycle_end if planner is empty
 	return (STAT_OK);
@@ -281,6 +316,14 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  *
  * mp_get_planner_buffers_available()   Returns # of available planner buffers
  *
+ * mp_planner_is_empty()	Returns TRUE if every buffer is free. Read-only, so unlike
+ *							mp_get_run_buffer() it is safe to call from the foreground.
+ *
+ * mp_get_planner_queue_time()	Returns planned time in the queue, in minutes. This is the
+ *							sum of the move times of all committed buffers including the
+ *							running buffer. Alines contribute their optimal (unaccelerated)
+ *							time, so the value is a lower bound on the time to drain.
+ *
  * mp_init_buffers()		Initializes or resets buffers
  *
  * mp_get_write_buffer()	Get pointer to next available write buffer
@@ -313,6 +356,36 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  */
 
 uint8_t mp_get_planner_buffers_available(void) { return (mb.buffers_available);}
+uint8_t mp_planner_is_empty(void) { return (mb.buffers_available == PLANNER_BUFFER_POOL_SIZE);}
+
+/* queue_time is added to here in the foreground and subtracted from in the exec interrupt.
+ * A float update is a multi-byte read-modify-write, so the foreground side runs with
+ * interrupts masked or the exec's subtraction can be lost (or a torn value read).
+ */
+float mp_get_planner_queue_time(void)
+{
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+	float queue_time = mb.queue_time;
+	SREG = sreg;
+	return (queue_time);
+#else
+	return (mb.queue_time);
+#endif
+}
+
+/*
+ * _get_buffer_time() - return the planned time of a buffer in minutes
+ *
+ *	Dwells carry their time in seconds; commands take no time.
+ */
+static float _get_buffer_time(mpBuf_t *bf)
+{
+	if (bf->move_type == MOVE_TYPE_ALINE) return (bf->gm.move_time);
+	if (bf->move_type == MOVE_TYPE_DWELL) return (bf->gm.move_time / 60);
+	return (0);
+}
 
 void mp_init_buffers(void)
 {
@@ -368,8 +441,20 @@ void mp_commit_write_buffer(const uint8_t move_type)
 {
 	mb.q->move_type = move_type;
 	mb.q->move_state = MOVE_NEW;
+	float buffer_time = _get_buffer_time(mb.q);
+
+	// Queue the buffer, count its time and advance the queue pointer as one step so the
+	// exec never sees a queued buffer whose time is not yet in mb.queue_time
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+#endif
 	mb.q->buffer_state = MP_BUFFER_QUEUED;
+	mb.queue_time += buffer_time;				// must precede the exec request, below
 	mb.q = mb.q->nx;							// advance the queued buffer pointer
+#ifdef __AVR
+	SREG = sreg;
+#endif
 	qr_request_queue_report(+1);				// request a QR and add to the "added buffers" count
 	st_request_exec_move();						// requests an exec if the runtime is not busy
 												// NB: BEWARE! the exec may result in the planner buffer being
@@ -392,6 +477,7 @@ mpBuf_t * mp_get_run_buffer()
 
 uint8_t mp_free_run_buffer()					// EMPTY current run buf & adv to next
 {
+	mb.queue_time -= _get_buffer_time(mb.r);
 	mp_clear_buffer(mb.r);						// clear it out (& reset replannable)
 //	mb.r->buffer_state = MP_BUFFER_EMPTY;		// redundant after the clear, above
 	mb.r = mb.r->nx;							// advance to next run buffer
@@ -399,6 +485,7 @@ uint8_t mp_free_run_buffer()					// EMPTY current run buf & adv to next
 		mb.r->buffer_state = MP_BUFFER_PENDING;	// pend next buffer
 	}
 	mb.buffers_available++;
+	if (mb.q == mb.r) mb.queue_time = 0;		// nothing committed: don't let rounding errors accumulate
 	qr_request_queue_report(-1);				// request a QR and add to the "removed buffers" count
 	return ((mb.w == mb.r) ? true : false); 	// return true if the queue emptied
 }
@@ -103,6 +103,56 @@ enum sectionState {
 #define PLANNER_BUFFER_POOL_SIZE 32
 #define PLANNER_BUFFER_HEADROOM 4			// buffers to reserve in planner before processing new input line
 
+/* PLANNER_JIT_DEPTH
+ *	Blocks closer than this to the run buffer get their trapezoids computed when planned.
+ *	Blocks further back only get velocities; the trapezoid is computed just in time by
+ *	mp_exec_aline(). See mp_calculate_trapezoid_jit().
+ */
+#define PLANNER_JIT_DEPTH 3
+
+/* OVERRIDE_SLEW_RATE
+ *	Feed and traverse overrides are planned into each block, and changes also scale the
+ *	segment times of blocks already queued or running (see _exec_override()). The runtime
+ *	scale moves toward its new value at most this much per second so velocity stays
+ *	continuous. The runtime scale only slows a block down - increases apply to new blocks.
+ *	While it slews, acceleration exceeds the planned value by up to velocity * this rate,
+ *	and jerk is not limited (see _exec_override()).
+ */
+#define OVERRIDE_SLEW_RATE ((float)2.0)
+
+/* MODULO_AXES
+ *	Rotary axes A,B,C can run in AXIS_MODULO mode. Their positions are kept within one turn
+ *	by removing whole turns between moves. The model and planner drop the turns at once; the
+ *	count rides on the next queued block so the runtime drops them when that block starts.
+ *	A block carries at most MODULO_TURNS_MAX turns per axis - any more wait for the next block.
+ */
+#define MODULO_AXES (AXES - AXIS_A)
+#define MODULO_TURNS_MAX 127
+
+/* __PLAN_OPTIMAL
+ *	Plans for the fastest profile over the whole queued window. Every new block replans
+ *	all queued blocks back to the running block, instead of stopping at blocks that look
+ *	optimally planned, so no junction is left below the velocity it could reach. When a
+ *	trapezoid has to lower its entry velocity the exits of the blocks behind it are pulled
+ *	down to match, so the profile has no velocity steps at junctions.
+ *
+ *	"Fastest" is relative to the planner's own model: velocity changes are bounded with the
+ *	mp_get_target_length() / mp_get_target_velocity() S-curve approximation, and the
+ *	trapezoid fitting iterates to TRAPEZOID_ITERATION_ERROR_PERCENT. It is not the exact
+ *	jerk-limited optimum, and it only sees the queued window.
+ *
+ *	This costs a trapezoid per queued block for every new block and turns off just-in-time
+ *	trapezoids. It is on by default for ARM. On the xmega it is off by default - build with
+ *	-D__PLAN_OPTIMAL (add it to the compiler symbols in tinyg.cproj) to select it, and check
+ *	the exec still keeps up at the shortest segment times the job uses.
+ *
+ * PLANNER_JUNCTION_TOLERANCE	Exit/entry velocity mismatch (mm/min) accepted at a junction
+ */
+#if defined (__ARM) && !defined (__PLAN_OPTIMAL)
+#define __PLAN_OPTIMAL
+#endif
+#define PLANNER_JUNCTION_TOLERANCE ((float)1.0)
+
 /* Some parameters for _generate_trapezoid()
  * TRAPEZOID_ITERATION_MAX	 				Max iterations for convergence in the HT asymmetric case.
  * TRAPEZOID_ITERATION_ERROR_PERCENT		Error percentage for iteration convergence. As percent - 0.01 = 1%
@@ -114,6 +164,13 @@ enum sectionState {
 #define TRAPEZOID_LENGTH_FIT_TOLERANCE		((float)0.0001)	// allowable mm of error in planning phase
 #define TRAPEZOID_VELOCITY_TOLERANCE		(max(2,bf->entry_velocity/100))
 
+/* Acceptance limits for host-planned lines (mp_aline_preplanned())
+ * PREPLANNED_VELOCITY_TOLERANCE			Allowable mm/min mismatch at a junction
+ * PREPLANNED_LENGTH_TOLERANCE				Allowable fraction by which head + tail may exceed the length
+ */
+#define PREPLANNED_VELOCITY_TOLERANCE		((float)1.0)
+#define PREPLANNED_LENGTH_TOLERANCE			((float)0.001)
+
 /*
  *	Macros and typedefs
  */
@@ -147,6 +204,9 @@ typedef struct mpBuffer {			// See Planning Velocity Notes for variable usage
 	uint8_t move_code;				// byte that can be used by used exec functions
 	uint8_t move_state;				// move state machine sequence
 	uint8_t replannable;			// TRUE if move can be re-planned
+	uint8_t zoid_pending;			// TRUE if head/body/tail lengths are deferred to exec time
+	int8_t turns[MODULO_AXES];		// whole turns to remove from modulo axes A,B,C when this block starts
+	float override;					// feed or traverse override factor the block was planned at
 
 	float unit[AXES];				// unit vector for axis scaling & planning
 
@@ -177,6 +237,7 @@ typedef struct mpBuffer {			// See Planning Velocity Notes for variable usage
 typedef struct mpBufferPool {		// ring buffer for sub-moves
 	magic_t magic_start;			// magic number to test memory integrity
 	uint8_t buffers_available;		// running count of available buffers
+	float queue_time;				// running total of planned move time in the queue (minutes)
 	mpBuf_t *w;						// get_write_buffer pointer
 	mpBuf_t *q;						// queue_write_buffer pointer
 	mpBuf_t *r;						// get/end_run_buffer pointer
@@ -187,10 +248,11 @@ typedef struct mpBufferPool {		// ring buffer for sub-moves
 typedef struct mpMoveMasterSingleton { // common variables for planning (move master)
 	magic_t magic_start;			// magic number to test memory integrity
 	float position[AXES];			// final move position for planning purposes
+	int16_t turns[MODULO_AXES];		// turns removed from position but not yet handed to a block
 
-	float jerk;						// jerk values cached from previous block
-	float recip_jerk;
-	float cbrt_jerk;
+	float jerk[2];					// jerk values cached from previous block - [0]=feed, [1]=traverse
+	float recip_jerk[2];			// ...kept separately so alternating G0/G1 does not thrash the cache
+	float cbrt_jerk[2];
 
 	magic_t magic_end;
 } mpMoveMasterSingleton_t;
@@ -205,6 +267,7 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	float unit[AXES];				// unit vector for axis scaling & planning
 	float target[AXES];				// final target for bf (used to correct rounding errors)
 	float position[AXES];			// current move position
+	int32_t turns[MODULO_AXES];		// whole turns removed from modulo axes. Angle is turns*360 + position
 	float position_c[AXES];			// for Kahan summation in _exec_aline_segment()
 	float waypoint[SECTIONS][AXES];	// head/body/tail endpoints for correction
 
@@ -224,9 +287,20 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 
 	float segments;					// number of segments in line (also used by arc generation)
 	uint32_t segment_count;			// count of running segments
+	float kin_segment_length;		// longest segment that holds kinematic linearization error. 0 = no limit
+	float advance[AXES];			// pressure advance offset applied to extruder axes (not in position)
+	float advance_velocity[AXES];	// rate the pressure advance offset changed at in the last segment
 	float segment_velocity;			// computed velocity for aline segment
 	float segment_time;				// actual time increment per aline segment
-	float jerk;						// max linear jerk
+	float jerk;						// max linear jerk
+
+	float override;					// runtime override: planned segment time is divided by this
+	float planned_override;			// override factor the running block was planned at
+	volatile uint8_t feed_override;	// current feed override in percent (set by the foreground)
+	volatile uint8_t traverse_override;// current traverse override in percent (set by the foreground)
+
+	float pso_interval;				// path distance between position-synchronized output pulses (0 = off)
+	float pso_to_next;				// path distance to the next PSO pulse
 
 #ifdef __JERK_EXEC					// values used exclusively by computed jerk acceleration
 	float jerk_div2;				// cached value for efficiency
@@ -272,6 +346,7 @@ void mp_flush_planner(void);
 void mp_set_planner_position(uint8_t axis, const float position);
 void mp_set_runtime_position(uint8_t axis, const float position);
 void mp_set_steps_to_runtime_position(void);
+void mp_wrap_planner_position(uint8_t axis, const int16_t turns);
 
 void mp_queue_command(void(*cm_exec_t)(float[], float[]), float *value, float *flag);
 stat_t mp_runtime_command(mpBuf_t *bf);
@@ -280,6 +355,7 @@ stat_t mp_dwell(const float seconds);
 void mp_end_dwell(void);
 
 stat_t mp_aline(GCodeState_t *gm_in);
+stat_t mp_aline_preplanned(GCodeState_t *gm_in, const float entry, const float cruise, const float exit);
 
 stat_t mp_plan_hold_callback(void);
 stat_t mp_end_hold(void);
@@ -287,6 +363,8 @@ stat_t mp_feed_rate_override(uint8_t flag, float parameter);
 
 // planner buffer handlers
 uint8_t mp_get_planner_buffers_available(void);
+uint8_t mp_planner_is_empty(void);
+float mp_get_planner_queue_time(void);
 void mp_init_buffers(void);
 mpBuf_t * mp_get_write_buffer(void);
 void mp_unget_write_buffer(void);
@@ -309,6 +387,7 @@ void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp);
 float mp_get_runtime_velocity(void);
 float mp_get_runtime_work_position(uint8_t axis);
 float mp_get_runtime_absolute_position(uint8_t axis);
+float mp_get_runtime_turns(uint8_t axis);
 void mp_set_runtime_work_offset(float offset[]);
 void mp_zero_segment_velocity(void);
 uint8_t mp_get_runtime_busy(void);
@@ -316,12 +395,15 @@ float* mp_get_planner_position_vector(void);
 
 // plan_zoid.c functions
 void mp_calculate_trapezoid(mpBuf_t *bf);
+void mp_calculate_trapezoid_jit(mpBuf_t *bf, const float pv_exit_velocity);
 float mp_get_target_length(const float Vi, const float Vf, const mpBuf_t *bf);
 float mp_get_target_velocity(const float Vi, const float L, const mpBuf_t *bf);
 
 // plan_exec.c functions
 stat_t mp_exec_move(void);
 stat_t mp_exec_aline(mpBuf_t *bf);
+void mp_set_pso_interval(const float interval);
+void mp_set_runtime_override(const float feed_factor, const float traverse_factor);
 /*
 #ifdef __cplusplus
 }
@@ -216,6 +216,25 @@ stat_t pwm_set_duty(uint8_t chan, float duty)
 	return (STAT_OK);
 }
 
+/*
+ * pwm_set_output() - connect or disconnect the PWM channel from its output pin
+ *
+ *	Disconnected, the pin follows the port's OUT register again. Only channel 1 has an
+ *	output pin.
+ */
+
+void pwm_set_output(uint8_t chan, uint8_t enable)
+{
+	#ifdef __AVR
+	if (chan != PWM_1) return;
+	if (enable == true) {
+		pwm.p[chan].timer->CTRLB |= TC0_CCBEN_bm;
+	} else {
+		pwm.p[chan].timer->CTRLB &= ~TC0_CCBEN_bm;
+	}
+	#endif // __AVR
+}
+
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
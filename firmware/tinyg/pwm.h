@@ -64,6 +64,7 @@ extern pwmSingleton_t pwm;
 void pwm_init(void);
 stat_t pwm_set_freq(uint8_t channel, float freq);
 stat_t pwm_set_duty(uint8_t channel, float duty);
+void pwm_set_output(uint8_t channel, uint8_t enable);
 
 #ifdef __TEXT_MODE
 
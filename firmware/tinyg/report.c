@@ -45,6 +45,7 @@ extern "C"{
 srSingleton_t sr;
 qrSingleton_t qr;
 rxSingleton_t rx;
+tlSingleton_t tl;
 
 /**** Exception Reports ************************************************************
  * rpt_exception() - generate an exception message - always in JSON format
@@ -290,14 +291,14 @@ stat_t sr_status_report_callback() 		// called by controller dispatcher
 
 	sr.status_report_requested = false;		// disable reports until requested again
 
-	if (sr.status_report_verbosity == SR_VERBOSE) {
+	uint8_t arena = nv_select_arena(NV_ARENA_REPORT);	// build in the report arena so a pending
+	if (sr.status_report_verbosity == SR_VERBOSE) {		//...response list is left untouched
 		_populate_unfiltered_status_report();
-	} else {
-		if (_populate_filtered_status_report() == false) {	// no new data
-			return (STAT_OK);
-		}
+		nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	} else if (_populate_filtered_status_report() == true) {	// only print if there is new data
+		nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
 	}
-	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	nv_select_arena(arena);
 	return (STAT_OK);
 }
 
@@ -427,12 +428,17 @@ void sr_print_sv(nvObj_t *nv) { text_print_ui8(nv, fmt_sv);}
 /*****************************************************************************
  * Queue Reports
  *
- *	Queue reports can report three values:
+ *	Queue reports can report four values:
  *	  - qr	queue depth - # of buffers availabel in planner queue
  *	  - qi	buffers added to planner queue since las report
  *	  - qo	buffers removed from planner queue since last report
+ *	  - qt	planned time in the queue, in seconds
  *
- *	A QR_SINGLE report returns qr only. A QR_TRIPLE returns all 3 values
+ *	A QR_SINGLE report returns qr only. A QR_TRIPLE returns qr, qi and qo.
+ *	A QR_TIMED report returns qr and qt. A buffer may hold anything from a
+ *	few milliseconds to many seconds of motion, so hosts that want to keep
+ *	a fixed amount of work ahead of the machine should throttle on qt.
+ *	qt is the sum of the unaccelerated move times and is a lower bound.
  *
  *	There are 2 ways to get queue reports:
  *
@@ -463,6 +469,7 @@ void qr_request_queue_report(int8_t buffers)
 {
 	// get buffer depth and added/removed count
 	qr.buffers_available = mp_get_planner_buffers_available();
+	qr.queue_time = mp_get_planner_queue_time() * 60;
 	if (buffers > 0) {
 		qr.buffers_added += buffers;
 	} else {
@@ -502,27 +509,36 @@ stat_t qr_queue_report_callback() 		// called by controller dispatcher
 
 	qr.queue_report_requested = false;
 
+	char buf[48];
+	int n;
 	if (cfg.comm_mode == TEXT_MODE) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "qr:%d\n", qr.buffers_available);
+			n = sprintf(buf, "qr:%d\n", qr.buffers_available);
+		} else if (qr.queue_report_verbosity == QR_TIMED) {
+			n = sprintf(buf, "qr:%d, qt:%1.3f\n", qr.buffers_available, (double)qr.queue_time);
 		} else  {
-			fprintf(stderr, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
+			n = sprintf(buf, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
 		}
 
 	} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "{qr:%d}\n", qr.buffers_available);
+			n = sprintf(buf, "{qr:%d}\n", qr.buffers_available);
+		} else if (qr.queue_report_verbosity == QR_TIMED) {
+			n = sprintf(buf, "{qr:%d,qt:%1.3f}\n", qr.buffers_available, (double)qr.queue_time);
 		} else {
-			fprintf(stderr, "{qr:%d,qi:%d,qo:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+			n = sprintf(buf, "{qr:%d,qi:%d,qo:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
 		}
 
 	} else {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "{\"qr\":%d}\n", qr.buffers_available);
+			n = sprintf(buf, "{\"qr\":%d}\n", qr.buffers_available);
+		} else if (qr.queue_report_verbosity == QR_TIMED) {
+			n = sprintf(buf, "{\"qr\":%d,\"qt\":%1.3f}\n", qr.buffers_available, (double)qr.queue_time);
 		} else {
-			fprintf(stderr, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+			n = sprintf(buf, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
 		}
 	}
+	xio_write_stderr(buf, n);
 	qr_init_queue_report();
 	return (STAT_OK);
 }
@@ -544,10 +560,101 @@ stat_t rx_report_callback(void) {
 
     rx.rx_report_requested = false;
 
-    fprintf(stderr, "{\"rx\":%d}\n", rx.space_available);
+    char buf[16];
+    int n = sprintf(buf, "{\"rx\":%d}\n", rx.space_available);
+    xio_write_stderr(buf, n);
     return (STAT_OK);
 }
 
+/*****************************************************************************
+ * TIMELINE REPORTS
+ *
+ *	The timeline records when each Gcode line actually executed, as opposed to
+ *	when it was parsed, so slow lines in a production job can be found by
+ *	correlating with external logs. Events are captured by mp_exec_move() as the
+ *	run buffer changes line number, and are drained by the report callback as:
+ *
+ *	  {"tl":[[line,start,end,vel],...]}  ticks are SysTick ms, vel is mm/min
+ *
+ *	Exec runs one segment ahead of the steppers so the ticks lead the motors by
+ *	up to a segment time (~5 ms). Only alines carry line numbers; dwells, commands
+ *	and an empty queue end the current line. Lines without N words all read as 0.
+ *	If the ring fills before it is drained the oldest events are kept and the
+ *	count of lost events is reported as "tlx".
+ *
+ * tl_start_line()  - open an event for a line unless it's already open (LO interrupt)
+ * tl_end_line()	- close the open event and push it onto the ring (LO interrupt)
+ * tl_timeline_report_callback() - send any captured events (main loop)
+ */
+
+void tl_start_line(uint32_t linenum)
+{
+	if (tl.timeline_report_verbosity == TL_OFF) return;
+	if ((tl.running == true) && (tl.current.linenum == linenum)) return;
+	tl_end_line();
+	tl.current.linenum = linenum;
+	tl.current.start_tick = SysTickTimer_getValue();
+	tl.running = true;
+}
+
+void tl_end_line()
+{
+	if (tl.running == false) return;
+	tl.running = false;
+
+	uint8_t wr = (tl.wr + 1) & (TIMELINE_BUFFER_SIZE-1);
+	if (wr == tl.rd) {								// ring is full
+		tl.dropped++;
+		return;
+	}
+	tl.current.end_tick = SysTickTimer_getValue();
+	tl.current.exit_velocity = mp_get_runtime_velocity();
+	memcpy(&tl.event[tl.wr], &tl.current, sizeof(tlEvent_t));
+	tl.wr = wr;										// publish only after the event is complete
+}
+
+stat_t tl_timeline_report_callback()
+{
+	if (tl.timeline_report_verbosity == TL_OFF)
+		return (STAT_NOOP);
+
+	uint16_t dropped = tl.dropped;
+	if ((tl.rd == tl.wr) && (dropped == tl.dropped_reported))
+		return (STAT_NOOP);
+
+	if (cfg.comm_mode == TEXT_MODE) {
+		while (tl.rd != tl.wr) {
+			tlEvent_t *ev = &tl.event[tl.rd];
+			fprintf(stderr, "tl:%lu, %lu, %lu, %1.0f\n", ev->linenum, ev->start_tick, ev->end_tick, (double)ev->exit_velocity);
+			tl.rd = (tl.rd + 1) & (TIMELINE_BUFFER_SIZE-1);
+		}
+		if (dropped != tl.dropped_reported) {
+			fprintf(stderr, "tlx:%u\n", dropped - tl.dropped_reported);
+		}
+	} else {
+		if (js.json_syntax == JSON_SYNTAX_RELAXED) {
+			fprintf(stderr, "{tl:[");
+		} else {
+			fprintf(stderr, "{\"tl\":[");
+		}
+		while (tl.rd != tl.wr) {
+			tlEvent_t *ev = &tl.event[tl.rd];
+			fprintf(stderr, "[%lu,%lu,%lu,%1.0f]", ev->linenum, ev->start_tick, ev->end_tick, (double)ev->exit_velocity);
+			tl.rd = (tl.rd + 1) & (TIMELINE_BUFFER_SIZE-1);
+			if (tl.rd != tl.wr) fprintf(stderr, ",");
+		}
+		if (dropped == tl.dropped_reported) {
+			fprintf(stderr, "]}\n");
+		} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
+			fprintf(stderr, "],tlx:%u}\n", dropped - tl.dropped_reported);
+		} else {
+			fprintf(stderr, "],\"tlx\":%u}\n", dropped - tl.dropped_reported);
+		}
+	}
+	tl.dropped_reported = dropped;
+	return (STAT_OK);
+}
+
 /* Alternate Formulation for a Single report - using nvObj list
 
 	// get a clean nv object
@@ -570,6 +677,7 @@ stat_t rx_report_callback(void) {
  * qr_get() - run a queue report (as data)
  * qi_get() - run a queue report - buffers in
  * qo_get() - run a queue report - buffers out
+ * qt_get() - run a queue report - planned time in queue (seconds)
  */
 stat_t qr_get(nvObj_t *nv)
 {
@@ -594,6 +702,13 @@ stat_t qo_get(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t qt_get(nvObj_t *nv)
+{
+	nv->value = mp_get_planner_queue_time() * 60;
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
 /*****************************************************************************
  * JOB ID REPORTS
  *
@@ -675,12 +790,16 @@ void job_print_job(nvObj_t *nv) { job_populate_job_report();}
 static const char fmt_qr[] PROGMEM = "qr:%d\n";
 static const char fmt_qi[] PROGMEM = "qi:%d\n";
 static const char fmt_qo[] PROGMEM = "qo:%d\n";
-static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple]\n";
+static const char fmt_qt[] PROGMEM = "qt:%1.3f\n";
+static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple,3=timed]\n";
+static const char fmt_tlv[] PROGMEM = "[tlv] timeline report verbosity%4d [0=off,1=on]\n";
 
 void qr_print_qr(nvObj_t *nv) { text_print_int(nv, fmt_qr);}
 void qr_print_qi(nvObj_t *nv) { text_print_int(nv, fmt_qi);}
 void qr_print_qo(nvObj_t *nv) { text_print_int(nv, fmt_qo);}
+void qr_print_qt(nvObj_t *nv) { text_print_flt(nv, fmt_qt);}
 void qr_print_qv(nvObj_t *nv) { text_print_ui8(nv, fmt_qv);}
+void tl_print_tlv(nvObj_t *nv) { text_print_ui8(nv, fmt_tlv);}
 
 #endif // __TEXT_MODE
 
@@ -54,7 +54,8 @@ enum cmStatusReportRequest {
 enum qrVerbosity {								// planner queue enable and verbosity
 	QR_OFF = 0,									// no response is provided
 	QR_SINGLE,									// queue depth reported
-	QR_TRIPLE									// queue depth reported for buffers, buffers added, buffered removed
+	QR_TRIPLE,									// queue depth reported for buffers, buffers added, buffered removed
+	QR_TIMED									// queue depth and planned queue time reported
 };
 
 typedef struct srSingleton {
@@ -80,6 +81,7 @@ typedef struct qrSingleton {		// data for queue reports
 	/*** runtime values (PRIVATE) ***/
 	uint8_t queue_report_requested;	// set to true to request a report
 	uint8_t buffers_available;		// stored buffer depth passed to by callback
+	float queue_time;				// stored planned queue time (seconds) passed to by callback
 	uint8_t prev_available;			// buffers available at last count
 	uint16_t buffers_added;			// buffers added since last count
 	uint16_t buffers_removed;		// buffers removed since last report
@@ -93,11 +95,42 @@ typedef struct rxSingleton {
     uint16_t space_available;       // space available in usb rx buffer at time of request
 } rxSingleton_t;
 
+#define TIMELINE_BUFFER_SIZE 16		// events held for the timeline report. Must be a power of 2
+
+enum tlVerbosity {					// line number timeline reports
+	TL_OFF = 0,						// no events are captured
+	TL_ON							// events are captured and reported
+};
+
+typedef struct tlEvent {			// execution timeline for one line number
+	uint32_t linenum;				// Gcode line number (N word)
+	uint32_t start_tick;			// SysTick when the line's first segment was executed
+	uint32_t end_tick;				// SysTick when the next line or a non-motion block took over
+	float exit_velocity;			// velocity of the line's last segment (mm/min)
+} tlEvent_t;
+
+typedef struct tlSingleton {		// data for timeline reports
+
+	/*** config values (PUBLIC) ***/
+	uint8_t timeline_report_verbosity;
+
+	/*** runtime values (PRIVATE) ***/
+	uint8_t running;				// true if the current event is open
+	volatile uint8_t wr;			// ring write index - advanced by the exec (LO interrupt)
+	volatile uint8_t rd;			// ring read index - advanced by the report callback
+	uint16_t dropped;				// events lost to a full ring (written by the exec)
+	uint16_t dropped_reported;		// dropped count at the last report
+	tlEvent_t current;				// event being timed
+	tlEvent_t event[TIMELINE_BUFFER_SIZE];
+
+} tlSingleton_t;
+
 /**** Externs - See report.c for allocation ****/
 
 extern srSingleton_t sr;
 extern qrSingleton_t qr;
 extern rxSingleton_t rx;
+extern tlSingleton_t tl;
 
 /**** Function Prototypes ****/
 
@@ -127,9 +160,14 @@ stat_t qr_queue_report_callback(void);
 void rx_request_rx_report(void);
 stat_t rx_report_callback(void);
 
+void tl_start_line(uint32_t linenum);
+void tl_end_line(void);
+stat_t tl_timeline_report_callback(void);
+
 stat_t qr_get(nvObj_t *nv);
 stat_t qi_get(nvObj_t *nv);
 stat_t qo_get(nvObj_t *nv);
+stat_t qt_get(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 
@@ -140,6 +178,8 @@ stat_t qo_get(nvObj_t *nv);
 	void qr_print_qr(nvObj_t *nv);
 	void qr_print_qi(nvObj_t *nv);
 	void qr_print_qo(nvObj_t *nv);
+	void qr_print_qt(nvObj_t *nv);
+	void tl_print_tlv(nvObj_t *nv);
 
 #else
 
@@ -150,6 +190,8 @@ stat_t qo_get(nvObj_t *nv);
 	#define qr_print_qr tx_print_stub
 	#define qr_print_qi tx_print_stub
 	#define qr_print_qo tx_print_stub
+	#define qr_print_qt tx_print_stub
+	#define tl_print_tlv tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -42,7 +42,17 @@
 
 // Machine configuration settings
 #define CHORDAL_TOLERANCE 			0.01					// chordal accuracy for arc drawing
+#define ARC_SPIRAL_TOLERANCE		1.0						// max mm radius mismatch run as a spiral. 0 = no spirals. Keep <= ARC_RADIUS_ERROR_MAX
 #define SOFT_LIMIT_ENABLE			0						// 0 = off, 1 = on
+#define TRAVERSE_MODE				TRAVERSE_COORDINATED	// one of: TRAVERSE_COORDINATED, TRAVERSE_DOGLEG, TRAVERSE_DOGLEG_SAFE_Z
+#define TRAVERSE_SAFE_Z				0						// machine Z to lift to for TRAVERSE_DOGLEG_SAFE_Z
+#define PRESSURE_ADVANCE_SMOOTHING	0.02					// seconds. Filters the extruder lead set by [abc]pa
+#define KINEMATICS					KIN_CARTESIAN			// one of: KIN_CARTESIAN, KIN_TABLE_AC, KIN_HEAD_B_TABLE_C
+#define KINEMATIC_PIVOT_X			0						// machine position of the rotary pivot
+#define KINEMATIC_PIVOT_Y			0
+#define KINEMATIC_PIVOT_Z			0
+#define KINEMATIC_PIVOT_LENGTH		0						// head B pivot to tool tip (KIN_HEAD_B_TABLE_C)
+#define KINEMATIC_TOLERANCE			0.005					// max mm linearization error in a segment. 0 = no subdivision
 #define SWITCH_TYPE 				SW_TYPE_NORMALLY_OPEN	// one of: SW_TYPE_NORMALLY_OPEN, SW_TYPE_NORMALLY_CLOSED
 
 #define MOTOR_POWER_MODE			MOTOR_POWERED_IN_CYCLE	// one of: MOTOR_DISABLED					(0)
@@ -57,6 +67,7 @@
 #define COMM_MODE					JSON_MODE				// one of: TEXT_MODE, JSON_MODE
 #define TEXT_VERBOSITY				TV_VERBOSE				// one of: TV_SILENT, TV_VERBOSE
 #define NETWORK_MODE				NETWORK_STANDALONE
+#define PENDANT_DEVICE				0						// secondary input: 0=none, 1=RS485, 2=SPI1, 3=SPI2
 
 #define JSON_VERBOSITY				JV_MESSAGES				// one of: JV_SILENT, JV_FOOTER, JV_CONFIGS, JV_MESSAGES, JV_LINENUM, JV_VERBOSE
 #define JSON_SYNTAX_MODE 			JSON_SYNTAX_STRICT		// one of JSON_SYNTAX_RELAXED, JSON_SYNTAX_STRICT
@@ -69,7 +80,8 @@
 //tgfx-friendly defaults
 //#define STATUS_REPORT_DEFAULTS "line","vel","mpox","mpoy","mpoz","mpoa","coor","ofsa","ofsx","ofsy","ofsz","dist","unit","stat","homz","homy","homx","momo"
 
-#define QUEUE_REPORT_VERBOSITY		QR_OFF					// one of: QR_OFF, QR_SINGLE, QR_TRIPLE
+#define QUEUE_REPORT_VERBOSITY		QR_OFF					// one of: QR_OFF, QR_SINGLE, QR_TRIPLE, QR_TIMED
+#define TIMELINE_REPORT_VERBOSITY	TL_OFF					// one of: TL_OFF, TL_ON
 
 // Gcode startup defaults
 #define GCODE_DEFAULT_UNITS			MILLIMETERS				// MILLIMETERS or INCHES
@@ -88,7 +100,7 @@
 #ifdef __DEBUG_SETTINGS
 
 #undef QUEUE_REPORT_VERBOSITY
-#define QUEUE_REPORT_VERBOSITY		QR_SINGLE				// one of: QR_OFF, QR_SINGLE, QR_TRIPLE
+#define QUEUE_REPORT_VERBOSITY		QR_SINGLE				// one of: QR_OFF, QR_SINGLE, QR_TRIPLE, QR_TIMED
 
 #undef JSON_VERBOSITY
 #define JSON_VERBOSITY				JV_MESSAGES				// one of: JV_SILENT, JV_FOOTER, JV_CONFIGS, JV_MESSAGES, JV_LINENUM, JV_VERBOSE
@@ -132,6 +144,59 @@
 #define P1_PWM_PHASE_OFF                0.1
 #endif //P1_PWM_FREQUENCY
 
+// If the tool change cycle is not configured fill it with default values
+#ifndef TOOL_CHANGE_MODE
+
+#define TOOL_CHANGE_MODE                TOOL_CHANGE_OFF		// one of: TOOL_CHANGE_OFF, TOOL_CHANGE_MANUAL, TOOL_CHANGE_PROBE
+#define TOOL_CHANGE_X                   0					// machine position to park at for tool changes (mm)
+#define TOOL_CHANGE_Y                   0
+#define TOOL_CHANGE_Z                   0
+#define TOOL_SETTER_X                   0					// machine position of the tool setter (mm)
+#define TOOL_SETTER_Y                   0
+#define TOOL_SETTER_Z                   -100				// probe endpoint - setter must trigger before this
+#define TOOL_SETTER_FEED                100					// mm/min
+#define TOOL_SETTER_REFERENCE           0					// Z trigger position for a zero length (reference) tool
+#endif //TOOL_CHANGE_MODE
+
+// If traverse dynamics are not configured G0 uses the cutting jerk and junction deviation
+#ifndef X_JERK_TRAVERSE
+
+#define X_JERK_TRAVERSE                 0					// 0 = same as X_JERK_MAX
+#define Y_JERK_TRAVERSE                 0
+#define Z_JERK_TRAVERSE                 0
+#define A_JERK_TRAVERSE                 0
+#define B_JERK_TRAVERSE                 0
+#define C_JERK_TRAVERSE                 0
+#define X_JUNCTION_DEV_TRAVERSE         0					// 0 = same as X_JUNCTION_DEVIATION
+#define Y_JUNCTION_DEV_TRAVERSE         0
+#define Z_JUNCTION_DEV_TRAVERSE         0
+#define A_JUNCTION_DEV_TRAVERSE         0
+#define B_JUNCTION_DEV_TRAVERSE         0
+#define C_JUNCTION_DEV_TRAVERSE         0
+#endif //X_JERK_TRAVERSE
+
+// Pressure advance is for extruders driven by a rotary axis (see settings_Ultimaker.h)
+#ifndef A_PRESSURE_ADVANCE
+#define A_PRESSURE_ADVANCE              0					// seconds. 0 = off
+#define B_PRESSURE_ADVANCE              0
+#define C_PRESSURE_ADVANCE              0
+#endif //A_PRESSURE_ADVANCE
+
+/*** Tool Table Defaults ***/
+
+#define TT1_LENGTH	0
+#define TT1_DIAMETER	0
+#define TT1_WEAR	0
+#define TT2_LENGTH	0
+#define TT2_DIAMETER	0
+#define TT2_WEAR	0
+#define TT3_LENGTH	0
+#define TT3_DIAMETER	0
+#define TT3_WEAR	0
+#define TT4_LENGTH	0
+#define TT4_DIAMETER	0
+#define TT4_WEAR	0
+
 
 /*** User-Defined Data Defaults ***/
 
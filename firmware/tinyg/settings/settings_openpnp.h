@@ -51,6 +51,9 @@
 #undef JSON_VERBOSITY
 #define JSON_VERBOSITY 			JV_LINENUM
 
+#undef TRAVERSE_MODE
+#define TRAVERSE_MODE			TRAVERSE_DOGLEG			// pick-and-place moves are point-to-point
+
 #undef COM_ENABLE_XON
 #define COM_ENABLE_XON			true
 
@@ -32,6 +32,7 @@
 #include "planner.h"
 #include "hardware.h"
 #include "pwm.h"
+#include "util.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -54,6 +55,9 @@ void cm_spindle_init()
 
 /*
  * cm_get_spindle_pwm() - return PWM phase (duty cycle) for dir and speed
+ *
+ *	The spindle override factor is applied to the speed before it is clamped to the
+ *	lo/hi range. The override does not change the programmed S value in the model.
  */
 float cm_get_spindle_pwm( uint8_t spindle_mode )
 {
@@ -75,8 +79,15 @@ float cm_get_spindle_pwm( uint8_t spindle_mode )
 		if( cm.gm.spindle_speed < speed_lo ) cm.gm.spindle_speed = speed_lo;
 		if( cm.gm.spindle_speed > speed_hi ) cm.gm.spindle_speed = speed_hi;
 
+		// apply spindle override and re-clamp
+		float speed = cm.gm.spindle_speed;
+		if ((cm.gmx.spindle_override_enable == true) && (cm.gmx.spindle_override_factor > 0)) {
+			speed *= cm.gmx.spindle_override_factor;
+			speed = min(speed_hi, max(speed_lo, speed));
+		}
+
 		// normalize speed to [0..1]
-		float speed = (cm.gm.spindle_speed - speed_lo) / (speed_hi - speed_lo);
+		speed = (speed - speed_lo) / (speed_hi - speed_lo);
 		return (speed * (phase_hi - phase_lo)) + phase_lo;
 	} else {
 		return pwm.c[PWM_1].phase_off;
@@ -85,7 +96,8 @@ float cm_get_spindle_pwm( uint8_t spindle_mode )
 
 /*
  * cm_spindle_control() -  queue the spindle command to the planner buffer
- * cm_exec_spindle_control() - execute the spindle command (called from planner)
+ * cm_exec_spindle_control() - execute the spindle command now (also used by the safety door)
+ * _exec_spindle_control() - spindle control callback from planner queue
  */
 
 stat_t cm_spindle_control(uint8_t spindle_mode)
@@ -98,7 +110,11 @@ stat_t cm_spindle_control(uint8_t spindle_mode)
 //static void _exec_spindle_control(uint8_t spindle_mode, float f, float *vector, float *flag)
 static void _exec_spindle_control(float *value, float *flag)
 {
-	uint8_t spindle_mode = (uint8_t)value[0];
+	cm_exec_spindle_control((uint8_t)value[0]);
+}
+
+void cm_exec_spindle_control(uint8_t spindle_mode)
+{
 	cm_set_spindle_mode(MODEL, spindle_mode);
 
  #ifdef __AVR
@@ -154,6 +170,14 @@ static void _exec_spindle_speed(float *value, float *flag)
 	pwm_set_duty(PWM_1, cm_get_spindle_pwm(cm.gm.spindle_mode) ); // update spindle speed if we're running
 }
 
+/*
+ * cm_exec_spindle_override() - apply a changed spindle override factor to the PWM now
+ */
+void cm_exec_spindle_override()
+{
+	pwm_set_duty(PWM_1, cm_get_spindle_pwm(cm.gm.spindle_mode) );
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,7 @@ void cm_exec_spindle_speed(float speed);			// callback for above
 
 stat_t cm_spindle_control(uint8_t spindle_mode);	// M3, M4, M5 integrated spindle control
 void cm_exec_spindle_control(uint8_t spindle_mode);	// callback for above
+void cm_exec_spindle_override(void);				// apply spindle override factor immediately
 
 #ifdef __cplusplus
 }
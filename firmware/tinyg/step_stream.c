@@ -0,0 +1,455 @@
+/*
+ * step_stream.c - raw step-stream mode (host-generated step segments)
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Step-stream mode lets the host do all trajectory generation. The host sends segments of
+ * per-motor step counts and a segment time that are passed straight to st_prep_line(),
+ * bypassing the Gcode parser, the planner and the aline exec. The DDA, limit switches,
+ * feedholds and queue flushes still work:
+ *
+ *	- The exec pulls one segment per call from a ring buffer instead of the planner queue.
+ *	- A feedhold stops at the next segment boundary. There is no deceleration, so the host
+ *	  must ramp down before sending a feedhold at speed. Cycle start resumes the stream.
+ *	- A queue flush or alarm discards the queued segments.
+ *	- The runtime position is advanced by every segment run so status reports stay current.
+ *
+ *	{"sgm":1}	enter step-stream mode. The planner must be empty and the machine idle.
+ *	{"sgm":0}	leave step-stream mode once all segments have run. Gcode positions resync.
+ *	{"sgs":"usec,m1,m2,m3,m4;usec,m1,..."}
+ *				queue one or more segments. usec is MIN_SEGMENT_USEC to NOM_SEGMENT_USEC,
+ *				m1..m4 are signed whole steps per motor. Trailing zero motors can be
+ *				omitted. The response is the number of free segments (buffer credits).
+ *	{"sgc":n}	get the number of free segments (n is null).
+ *
+ *	Gcode is rejected while step-stream mode is active.
+ *
+ *	The exec output of a normal run can be recorded for replay in this mode. See RECORDING.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "step_stream.h"
+#include "hardware.h"
+#include "persistence.h"
+#include "report.h"
+#include "util.h"
+#include "xio.h"			// for char definitions
+
+ssStream_t ss;
+
+static stat_t _parse_segment(char_t **rd, ssSegment_t *seg);
+
+/*
+ * step_stream_init() - initialize step-stream mode (off)
+ */
+
+void step_stream_init()
+{
+	memset(&ss, 0, sizeof(ss));
+	ss.magic_start = MAGICNUM;
+	ss.magic_end = MAGICNUM;
+}
+
+uint8_t ss_get_mode() { return (ss.mode);}
+uint8_t ss_get_credits() { return ((ss.tail - ss.head - 1) & (SS_BUFFER_SIZE-1));}
+
+/*
+ * ss_flush() - discard queued segments. Called from mp_flush_planner()
+ */
+
+void ss_flush()
+{
+	ss.tail = ss.head;
+}
+
+/*
+ * ss_exec_segment() - prep the next segment for the steppers. Called from mp_exec_move()
+ *
+ *	Runs from the exec interrupt. Follows the same return convention as mp_exec_move().
+ */
+
+stat_t ss_exec_segment()
+{
+	if ((cm.machine_state == MACHINE_ALARM) || (cm.machine_state == MACHINE_SHUTDOWN)) {
+		ss_flush();
+	}
+	if (cm.hold_state == FEEDHOLD_SYNC) {				// stop at the segment boundary
+		cm.hold_state = FEEDHOLD_HOLD;
+		cm_set_motion_state(MOTION_HOLD);
+		sr_request_status_report(SR_IMMEDIATE_REQUEST);
+	}
+	if ((ss.tail == ss.head) || (cm.hold_state == FEEDHOLD_HOLD)) {
+		if ((ss.tail == ss.head) && (cm.motion_state == MOTION_RUN)) {
+			cm_cycle_end();								// stream ran dry
+		}
+		st_prep_null();
+		return (STAT_NOOP);
+	}
+	if (cm.motion_state == MOTION_STOP) cm_set_motion_state(MOTION_RUN);
+
+	ssSegment_t *seg = &ss.seg[ss.tail];
+	float travel_steps[MOTORS];
+	float following_error[MOTORS];						// no correction - the host owns the trajectory
+	uint8_t motor;
+
+	for (motor=0; motor<MOTORS; motor++) {
+		travel_steps[motor] = seg->steps[motor];
+		following_error[motor] = 0;
+	}
+	for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+		if ((motor = ss.axis_motor[axis]) != SS_NO_MOTOR) {
+			mp_set_runtime_position(axis, mp_get_runtime_absolute_position(axis) +
+									seg->steps[motor] * st_cfg.mot[motor].units_per_step);
+		}
+	}
+	stat_t status = st_prep_line(travel_steps, following_error, seg->usec / MICROSECONDS_PER_MINUTE);
+	ss.tail = (ss.tail + 1) & (SS_BUFFER_SIZE-1);
+	return (status);
+}
+
+/*
+ * _parse_segment() - parse "usec,m1,m2..." into a segment and advance the read pointer
+ */
+
+static stat_t _parse_segment(char_t **rd, ssSegment_t *seg)
+{
+	char_t *end;
+	float usec = strtod(*rd, &end);
+
+	if (end == *rd) return (STAT_BAD_NUMBER_FORMAT);
+	if ((usec < MIN_SEGMENT_USEC) || (usec > NOM_SEGMENT_USEC)) return (STAT_INPUT_VALUE_RANGE_ERROR);
+	seg->usec = (uint16_t)usec;
+	*rd = end;
+
+	float steps_max = usec * SS_STEP_RATE_MAX / 1000000;
+	float steps;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		seg->steps[motor] = 0;
+		if (**rd != SS_VALUE_SEPARATOR) continue;		// omitted motors take no steps
+		(*rd)++;
+		steps = strtod(*rd, &end);
+		if (end == *rd) return (STAT_BAD_NUMBER_FORMAT);
+		if (fabs(steps) > steps_max) return (STAT_INPUT_VALUE_RANGE_ERROR);
+		seg->steps[motor] = (int8_t)round(steps);
+		*rd = end;
+	}
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * RECORDING
+ *
+ *	Record mode captures what the exec sends to st_prep_line() so a job can be replayed
+ *	in step-stream mode without parsing or planning. There is no local storage big enough
+ *	for a job, so the recording is sent to the host as replayable JSON lines:
+ *
+ *	  {"sgs":"usec,m1,m2..;usec,..."}	segments, exactly as they would be queued for replay
+ *	  {"sgk":linenum}					a command or dwell ran here (Gcode line number)
+ *
+ *	Fractional steps are carried between segments so the recording does not drift.
+ *	Each recorded segment is kept within what _parse_segment() accepts for replay. Override
+ *	can stretch an exec segment well past NOM_SEGMENT_USEC (to 500 ms at 1%), so long
+ *	segments are split into equal pieces of MIN_SEGMENT_USEC to NOM_SEGMENT_USEC as they
+ *	are sent, with the steps shared out in proportion.
+ *	To replay, the host sends the segment lines in step-stream mode. At a marker it waits
+ *	for the stream to drain, leaves step-stream mode, sends the original Gcode line, and
+ *	re-enters step-stream mode. Commands that ran mid-motion will stop the machine on replay.
+ *
+ *	A recording is only valid for the settings it was made with. {"sgh":n} returns a hash
+ *	of all persisted settings and the firmware build. The host stores it, with its own hash
+ *	of the program, and checks both before a replay.
+ *
+ *	Recording stops with an exception report if segments are produced faster than they can
+ *	be sent (STAT_BUFFER_FULL), or a segment has too many steps to record or steps faster
+ *	than the SS_STEP_RATE_MAX replay limit (range error). The DDA runs the exec at up to
+ *	FREQUENCY_DDA, so moves above half that rate cannot be recorded.
+ ***********************************************************************************/
+
+/*
+ * ss_record_segment() - record a segment. Called from the exec ahead of st_prep_line()
+ * ss_record_marker()  - record a command or dwell. Called from the planner exec functions
+ *
+ *	segment_time is the time the segment is actually run for, which is the planned time
+ *	stretched by any runtime feed or traverse override (see _exec_override()). A replay
+ *	therefore reproduces the overrides that were in effect while recording.
+ */
+
+static ssRecord_t *_get_record_buffer(void)
+{
+	if (ss.rec_status != STAT_OK) return (NULL);
+	if (((ss.rec_head + 1) & (SS_RECORD_SIZE-1)) == ss.rec_tail) {
+		ss.rec_status = STAT_BUFFER_FULL;
+		return (NULL);
+	}
+	return (&ss.rec[ss.rec_head]);
+}
+
+void ss_record_segment(const float travel_steps[], const float segment_time)
+{
+	ssRecord_t *rec;
+	float steps;
+
+	if ((rec = _get_record_buffer()) == NULL) return;
+	float usec = round(segment_time * MICROSECONDS_PER_MINUTE);
+	float pieces = ceil(usec / NOM_SEGMENT_USEC);		// as split by ss_record_callback()
+	float steps_max = usec * SS_STEP_RATE_MAX / 1000000;// as checked by _parse_segment()...
+	if (pieces > 1) steps_max -= pieces;				// ...less a step per piece for rounding
+	steps_max = min(steps_max, INT8_MAX);
+
+	rec->usec = (uint32_t)usec;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		ss.rec_residual[motor] += travel_steps[motor];
+		steps = round(ss.rec_residual[motor]);
+		if (fabs(steps) > steps_max) {
+			ss.rec_status = STAT_INPUT_VALUE_RANGE_ERROR;
+			return;
+		}
+		rec->steps[motor] = (int8_t)steps;
+		ss.rec_residual[motor] -= steps;
+	}
+	ss.rec_head = (ss.rec_head + 1) & (SS_RECORD_SIZE-1);
+}
+
+void ss_record_marker(const uint32_t linenum)
+{
+	ssRecord_t *rec;
+
+	if ((rec = _get_record_buffer()) == NULL) return;
+	rec->usec = 0;
+	rec->linenum = linenum;
+	ss.rec_head = (ss.rec_head + 1) & (SS_RECORD_SIZE-1);
+}
+
+/*
+ * ss_record_callback() - send recorded segments to the host
+ *
+ *	Segments are sent in batches of SS_RECORD_BATCH. A partial batch is sent once the
+ *	cycle has ended or recording has been turned off. A segment longer than NOM_SEGMENT_USEC
+ *	is sent one piece at a time and stays at the tail until its last piece has gone.
+ */
+
+stat_t ss_record_callback()
+{
+	uint8_t pending = (ss.rec_head - ss.rec_tail) & (SS_RECORD_SIZE-1);
+
+	if (ss.record == true) {
+		if (ss.rec_status != STAT_OK) {
+			ss.record = false;
+			rpt_exception(ss.rec_status);
+			return (STAT_OK);
+		}
+		if ((pending < SS_RECORD_BATCH) && (cm.cycle_state != CYCLE_OFF)) {
+			return (STAT_NOOP);
+		}
+	}
+	if (pending == 0) return (STAT_NOOP);
+
+	static char buf[SS_RECORD_LINE_LEN];
+	ssRecord_t *rec = &ss.rec[ss.rec_tail];
+	int n;
+
+	if (rec->usec == 0) {
+		n = sprintf(buf, "{\"sgk\":%lu}\n", (unsigned long)rec->linenum);
+		ss.rec_tail = (ss.rec_tail + 1) & (SS_RECORD_SIZE-1);
+	} else {
+		n = sprintf(buf, "{\"sgs\":\"");
+		for (uint8_t i=0; (i < SS_RECORD_BATCH) && (ss.rec_tail != ss.rec_head); i++) {
+			rec = &ss.rec[ss.rec_tail];
+			if (rec->usec == 0) break;						// markers go on their own line
+			if (i > 0) buf[n++] = SS_SEGMENT_SEPARATOR;
+			uint16_t pieces = (uint16_t)ceil(rec->usec / NOM_SEGMENT_USEC);	// left to send
+			uint32_t usec = rec->usec / pieces;
+			int8_t steps[MOTORS];
+			int8_t last = -1;								// trailing zero motors are omitted
+			for (uint8_t motor=0; motor<MOTORS; motor++) {
+				steps[motor] = (int8_t)round((float)rec->steps[motor] / pieces);
+				rec->steps[motor] -= steps[motor];
+				if (steps[motor] != 0) last = motor;
+			}
+			n += sprintf(&buf[n], "%lu", (unsigned long)usec);
+			for (int8_t motor=0; motor<=last; motor++) {
+				n += sprintf(&buf[n], ",%d", steps[motor]);
+			}
+			if ((rec->usec -= usec) == 0) {					// last piece of the segment
+				ss.rec_tail = (ss.rec_tail + 1) & (SS_RECORD_SIZE-1);
+			}
+		}
+		n += sprintf(&buf[n], "\"}\n");
+	}
+	xio_write_stderr(buf, n);
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * ss_get_sgm() - get step-stream mode
+ * ss_set_sgm() - enter or leave step-stream mode
+ */
+
+stat_t ss_get_sgm(nvObj_t *nv)
+{
+	nv->value = (float)ss.mode;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t ss_set_sgm(nvObj_t *nv)
+{
+	uint8_t mode = fp_NOT_ZERO(nv->value);
+
+	if (mode == ss.mode) return (STAT_OK);
+	if ((ss.tail != ss.head) || (mp_planner_is_empty() == false) || (cm_get_runtime_busy() == true) ||
+		(cm.machine_state == MACHINE_ALARM) || (cm.machine_state == MACHINE_SHUTDOWN) ||
+		(cm.cycle_state != CYCLE_OFF)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (mode == true) {
+		for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+			ss.axis_motor[axis] = SS_NO_MOTOR;
+			for (uint8_t motor=0; motor<MOTORS; motor++) {
+				if (st_cfg.mot[motor].motor_map == axis) {
+					ss.axis_motor[axis] = motor;			// first motor wins for dual-motor axes
+					break;
+				}
+			}
+		}
+	} else {
+		for (uint8_t axis=AXIS_X; axis<AXES; axis++) {	// model and planner pick up where the stream ended
+			cm_set_position(axis, mp_get_runtime_absolute_position(axis));
+		}
+	}
+	ss.mode = mode;
+	return (STAT_OK);
+}
+
+/*
+ * ss_get_sgc() - get step-stream buffer credits (free segments)
+ */
+
+stat_t ss_get_sgc(nvObj_t *nv)
+{
+	nv->value = (float)ss_get_credits();
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/*
+ * ss_run_sgs() - queue step-stream segments
+ *
+ *	The string is rejected whole if it does not parse or if there are not enough credits
+ *	for all of its segments. The response value is the credits left.
+ */
+
+stat_t ss_run_sgs(nvObj_t *nv)
+{
+	if (ss.mode == false) return (STAT_COMMAND_NOT_ACCEPTED);
+	if (nv->valuetype != TYPE_STRING) return (STAT_UNSUPPORTED_TYPE);
+
+	char_t *rd = *nv->stringp;
+	uint8_t count = 1;
+	for (char_t *p = rd; *p != NUL; p++) {
+		if (*p == SS_SEGMENT_SEPARATOR) count++;
+	}
+	if (count > ss_get_credits()) return (STAT_BUFFER_FULL);
+
+	uint8_t wr = ss.head;
+	while (true) {
+		ritorno(_parse_segment(&rd, &ss.seg[wr]));
+		wr = (wr + 1) & (SS_BUFFER_SIZE-1);
+		if (*rd == NUL) break;
+		if (*rd++ != SS_SEGMENT_SEPARATOR) return (STAT_BAD_NUMBER_FORMAT);
+	}
+	ss.head = wr;										// publish the segments to the exec
+	cm_cycle_start();
+	st_request_exec_move();
+
+	nv->value = (float)ss_get_credits();
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+/*
+ * ss_get_sgr() - get record mode
+ * ss_set_sgr() - start or stop recording exec output
+ */
+
+stat_t ss_get_sgr(nvObj_t *nv)
+{
+	nv->value = (float)ss.record;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t ss_set_sgr(nvObj_t *nv)
+{
+	uint8_t record = fp_NOT_ZERO(nv->value);
+
+	if (record == ss.record) return (STAT_OK);
+	if (record == true) {
+		if ((ss.mode == true) || (cm.cycle_state != CYCLE_OFF) || (ss.rec_tail != ss.rec_head)) {
+			return (STAT_COMMAND_NOT_ACCEPTED);
+		}
+		for (uint8_t motor=0; motor<MOTORS; motor++) {
+			ss.rec_residual[motor] = 0;
+		}
+		ss.rec_status = STAT_OK;
+	}
+	ss.record = record;									// stopping lets the callback send what is left
+	return (STAT_OK);
+}
+
+/*
+ * ss_get_sgh() - get the settings hash used to validate recordings
+ *
+ *	Hashes the persisted value of every setting, plus the firmware build, and returns
+ *	it as 8 hex digits (a float would not hold all 32 bits).
+ */
+
+static uint32_t _hash_bytes(uint32_t h, const uint8_t *bytes, uint8_t len)
+{
+	for (uint8_t i=0; i<len; i++) {
+		h = 31 * h + bytes[i];
+	}
+	return (h);
+}
+
+stat_t ss_get_sgh(nvObj_t *nv)
+{
+	nvObj_t setting;
+	nvObj_t *nvp = nv;
+	float build = TINYG_FIRMWARE_BUILD;
+	uint32_t h = _hash_bytes(0, (uint8_t *)&build, sizeof(build));
+
+	nv = &setting;										// GET_TABLE_BYTE() works on nv
+	for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
+		if (GET_TABLE_BYTE(flags) & F_PERSIST) {
+			read_persistent_value(nv);
+			h = _hash_bytes(h, (uint8_t *)&nv->value, sizeof(nv->value));
+		}
+	}
+	char_t hash[9];
+	sprintf((char *)hash, "%08lx", (unsigned long)h);
+	nvp->valuetype = TYPE_STRING;
+	return (nv_copy_string(nvp, hash));
+}
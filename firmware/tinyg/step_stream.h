@@ -0,0 +1,88 @@
+/*
+ * step_stream.h - raw step-stream mode (host-generated step segments)
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef STEP_STREAM_H_ONCE
+#define STEP_STREAM_H_ONCE
+
+/* SS_BUFFER_SIZE must be a power of 2.
+ * SS_STEP_RATE_MAX is half the DDA rate so every step gets a full DDA tick of low time.
+ *	Segments run between MIN_SEGMENT_USEC and NOM_SEGMENT_USEC, so the most steps a motor
+ *	can take in a segment (125 at 50 KHz) fits in the int8_t step count.
+ */
+#define SS_BUFFER_SIZE	32					// segments queued ahead of the exec (buffer credits)
+#define SS_STEP_RATE_MAX (FREQUENCY_DDA / 2)	// steps per second
+#define SS_NO_MOTOR		0xFF
+
+#define SS_RECORD_SIZE	16					// recorded segments waiting to be sent (power of 2)
+#define SS_RECORD_BATCH	6					// recorded segments sent per line
+#define SS_RECORD_LINE_LEN	(12 + SS_RECORD_BATCH * (6 + MOTORS * 5))
+#define SS_SEGMENT_SEPARATOR ';'			// separates segments in a stream string
+#define SS_VALUE_SEPARATOR ','				// separates values in a segment
+
+typedef struct ssSegment {					// one host-generated step segment
+	uint16_t usec;							// segment time in microseconds
+	int8_t steps[MOTORS];					// signed whole (micro)steps for each motor
+} ssSegment_t;
+
+typedef struct ssRecord {					// one recorded exec segment or command
+	uint32_t usec;							// segment time in microseconds, 0 for a command marker
+	int8_t steps[MOTORS];					// signed whole (micro)steps for each motor
+	uint32_t linenum;						// markers: Gcode line number of the command or dwell
+} ssRecord_t;
+
+typedef struct ssStreamSingleton {
+	magic_t magic_start;
+	uint8_t mode;							// true while step-stream mode is active
+	volatile uint8_t head;					// next segment to write - owned by the main loop
+	volatile uint8_t tail;					// next segment to run - owned by the exec
+	uint8_t axis_motor[AXES];				// motor that reports the position of each axis (SS_NO_MOTOR if none)
+	ssSegment_t seg[SS_BUFFER_SIZE];
+
+	uint8_t record;							// true while exec output is being recorded
+	volatile uint8_t rec_head;				// next record to write - owned by the exec
+	volatile uint8_t rec_tail;				// next record to send - owned by the main loop
+	volatile stat_t rec_status;				// set by the exec if the recording is lost
+	float rec_residual[MOTORS];				// fractional steps carried to the next recorded segment
+	ssRecord_t rec[SS_RECORD_SIZE];
+	magic_t magic_end;
+} ssStream_t;
+extern ssStream_t ss;
+
+/* step-stream function prototypes */
+
+void step_stream_init(void);
+
+uint8_t ss_get_mode(void);
+uint8_t ss_get_credits(void);
+stat_t ss_exec_segment(void);
+void ss_flush(void);
+
+void ss_record_segment(const float travel_steps[], const float segment_time);
+void ss_record_marker(const uint32_t linenum);
+stat_t ss_record_callback(void);
+
+stat_t ss_get_sgm(nvObj_t *nv);
+stat_t ss_set_sgm(nvObj_t *nv);
+stat_t ss_get_sgc(nvObj_t *nv);
+stat_t ss_run_sgs(nvObj_t *nv);
+stat_t ss_get_sgr(nvObj_t *nv);
+stat_t ss_set_sgr(nvObj_t *nv);
+stat_t ss_get_sgh(nvObj_t *nv);
+
+#endif	// End of include guard: STEP_STREAM_H_ONCE
@@ -36,6 +36,7 @@
 #include "planner.h"
 #include "report.h"
 #include "hardware.h"
+#include "gpio.h"
 #include "text_parser.h"
 #include "util.h"
 
@@ -299,6 +300,60 @@ uint8_t st_runtime_isbusy()
 	return (true);
 }
 
+/*
+ * st_get_actual_steps() - return the instantaneous motor positions in (fractional) steps
+ *
+ *	mr.position runs a segment or more ahead of the steps actually emitted, so it
+ *	leads and jitters when sampled for reporting. This function reconstructs where
+ *	the motors are right now from the encoder (step) counts plus the fraction of the
+ *	running segment that has elapsed, as measured by st_run.dda_ticks_downcount.
+ *
+ *	The encoder count is accumulated at segment load, so it holds the position at
+ *	the start of the running segment. The segment's steps are played out linearly
+ *	over its DDA ticks, so the elapsed steps are the substep increment scaled by
+ *	the elapsed fraction. Outside of a line segment (dwells, idle) the counted
+ *	steps are returned.
+ *
+ *	The runtime values are copied with interrupts masked to get a coherent
+ *	snapshot from the DDA ISR; the math is done afterwards.
+ */
+
+void st_get_actual_steps(float steps[])
+{
+	int32_t counted_steps[MOTORS];
+	int32_t substep_increment[MOTORS];
+	uint32_t dda_ticks_downcount;
+	uint32_t dda_ticks_X_substeps;
+	uint8_t motor;
+
+#ifdef __AVR
+	uint8_t sreg = SREG;
+	cli();
+#endif
+	dda_ticks_downcount = st_run.dda_ticks_downcount;
+	dda_ticks_X_substeps = st_run.dda_ticks_X_substeps;
+	for (motor=0; motor<MOTORS; motor++) {
+		if ((dda_ticks_downcount == 0) || (dda_ticks_X_substeps == 0)) {	// segment done or dwelling
+			counted_steps[motor] = en.en[motor].encoder_steps + en.en[motor].steps_run;
+			substep_increment[motor] = 0;
+		} else {
+			counted_steps[motor] = en.en[motor].encoder_steps;
+			substep_increment[motor] = st_run.mot[motor].substep_increment * en.en[motor].step_sign;
+		}
+	}
+#ifdef __AVR
+	SREG = sreg;
+#endif
+
+	float fraction = 0;
+	if (dda_ticks_X_substeps != 0) {
+		fraction = 1 - (float)dda_ticks_downcount * DDA_SUBSTEPS / (float)dda_ticks_X_substeps;
+	}
+	for (motor=0; motor<MOTORS; motor++) {
+		steps[motor] = (float)counted_steps[motor] + (float)substep_increment[motor] / DDA_SUBSTEPS * fraction;
+	}
+}
+
 /*
  * st_reset() - reset stepper internals
  */
@@ -533,6 +588,18 @@ ISR(TIMER_DDA_ISR_vect)
 	PORT_MOTOR_3_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 3 uSec
 	PORT_MOTOR_4_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 2 uSec
 
+	// position-synchronized output - pulses are one DDA tick wide
+	if (st_run.pso_high) {
+		st_run.pso_port->OUTCLR = GPIO1_OUT_BIT_bm;
+		st_run.pso_high = false;
+	}
+	if ((st_run.pso_count != 0) && (--st_run.pso_ticks_downcount == 0)) {
+		st_run.pso_port->OUTSET = GPIO1_OUT_BIT_bm;
+		st_run.pso_high = true;
+		st_run.pso_ticks_downcount = st_run.pso_interval_ticks;
+		st_run.pso_count--;
+	}
+
 	if (--st_run.dda_ticks_downcount != 0) return;
 
 	TIMER_DDA.CTRLA = STEP_TIMER_DISABLE;				// disable DDA timer
@@ -769,6 +836,14 @@ static void _load_move()
 		st_run.dda_ticks_downcount = st_pre.dda_ticks;
 		st_run.dda_ticks_X_substeps = st_pre.dda_ticks_X_substeps;
 
+		st_run.pso_count = st_pre.pso_count;					// consume the PSO setup for this segment
+#ifdef __AVR
+		if (st_run.pso_port == NULL) st_run.pso_count = 0;		// PSO was turned off after the prep
+#endif
+		st_run.pso_ticks_downcount = st_pre.pso_first_ticks;
+		st_run.pso_interval_ticks = st_pre.pso_interval_ticks;
+		st_pre.pso_count = 0;
+
 		//**** MOTOR_1 LOAD ****
 
 		// These sections are somewhat optimized for execution speed. The whole load operation
@@ -949,6 +1024,7 @@ static void _load_move()
 	// handle dwells
 	} else if (st_pre.move_type == MOVE_TYPE_DWELL) {
 		st_run.dda_ticks_downcount = st_pre.dda_ticks;
+		st_run.dda_ticks_X_substeps = 0;				// marks a dwell for st_get_actual_steps()
 		TIMER_DWELL.PER = st_pre.dda_period;			// load dwell timer period
 		TIMER_DWELL.CTRLA = STEP_TIMER_ENABLE;			// enable the dwell timer
 
@@ -996,6 +1072,12 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 	} else if (isnan(segment_time)) { return (cm_hard_alarm(STAT_PREP_LINE_MOVE_TIME_IS_NAN));		// never supposed to happen
 	} else if (segment_time < EPSILON) { return (STAT_MINIMUM_TIME_MOVE);
 	}
+	float steps_max = segment_time * 60 * FREQUENCY_DDA;	// one step per DDA tick
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (fabs(travel_steps[motor]) > steps_max) {			// the DDA would drop steps
+			return (cm_hard_alarm(STAT_PREP_LINE_STEP_RATE_EXCEEDED));
+		}
+	}
 	// setup segment parameters
 	// - dda_ticks is the integer number of DDA clock ticks needed to play out the segment
 	// - ticks_X_substeps is the maximum depth of the DDA accumulator (as a negative number)
@@ -1065,6 +1147,24 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 	return (STAT_OK);
 }
 
+/*
+ * st_prep_pso() - set up position-synchronized output pulses for the next line segment
+ *
+ *	Must be called before st_prep_line() for the segment. Pulses fire first_ticks DDA ticks
+ *	into the segment and every interval_ticks after that, count pulses in all. The setup
+ *	applies to one segment only - the loader clears it.
+ */
+
+void st_prep_pso(uint16_t first_ticks, uint16_t interval_ticks, uint8_t count)
+{
+#ifdef __AVR
+	if (st_run.pso_port == NULL) return;
+#endif
+	st_pre.pso_first_ticks = max(first_ticks, 1);
+	st_pre.pso_interval_ticks = max(interval_ticks, 2);	// leaves a tick for the output to go low
+	st_pre.pso_count = count;
+}
+
 /*
  * st_prep_null() - Keeps the loader happy. Otherwise performs no action
  */
@@ -1257,6 +1357,29 @@ stat_t st_set_mt(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+/*
+ * st_set_pso() - select the GPIO1 output used for position-synchronized pulses
+ *
+ *	0 turns PSO off. The 4 outputs are the GPIO1 bits otherwise used for spindle enable,
+ *	spindle direction, spindle PWM and coolant. The selected bit is reserved in gpio so
+ *	those functions (and the spindle PWM timer) leave it alone while PSO owns it.
+ */
+
+stat_t st_set_pso(nvObj_t *nv)
+{
+	if ((nv->value < 0) || (nv->value > GPIO1_OUTPUTS)) return (STAT_INPUT_VALUE_RANGE_ERROR);
+	set_ui8(nv);
+	gpio_reserve_bit((st_cfg.pso_output == 0) ? 0 : (0x08 >> (st_cfg.pso_output-1)));
+#ifdef __AVR
+	st_run.pso_count = 0;								// order matters - the DDA ISR may preempt
+	st_run.pso_high = false;
+	if (st_run.pso_port != NULL) st_run.pso_port->OUTCLR = GPIO1_OUT_BIT_bm;
+	st_run.pso_port = (st_cfg.pso_output == 0) ? NULL : hw.out_port[st_cfg.pso_output-1];
+	if (st_run.pso_port != NULL) st_run.pso_port->OUTCLR = GPIO1_OUT_BIT_bm;	// drop whatever drove it before
+#endif
+	return (STAT_OK);
+}
+
 stat_t st_set_md(nvObj_t *nv)	// Make sure this function is not part of initialization --> f00
 {
 	if (((uint8_t)nv->value == 0) || (nv->valuetype == TYPE_NULL)) {
@@ -1301,6 +1424,7 @@ static const char *const msg_units[] PROGMEM = { msg_units0, msg_units1, msg_uni
 static const char fmt_me[] PROGMEM = "motors energized\n";
 static const char fmt_md[] PROGMEM = "motors de-energized\n";
 static const char fmt_mt[] PROGMEM = "[mt]  motor idle timeout%14.2f Sec\n";
+static const char fmt_pso[] PROGMEM = "[pso] PSO output%22d [0=off,1-4=GPIO1 output]\n";
 static const char fmt_0ma[] PROGMEM = "[%s%s] m%s map to axis%15d [0=X,1=Y,2=Z...]\n";
 static const char fmt_0sa[] PROGMEM = "[%s%s] m%s step angle%20.3f%s\n";
 static const char fmt_0tr[] PROGMEM = "[%s%s] m%s travel per revolution%10.4f%s\n";
@@ -1311,6 +1435,7 @@ static const char fmt_0pl[] PROGMEM = "[%s%s] m%s motor power level%13.3f [0.000
 static const char fmt_pwr[] PROGMEM = "Motor %c power enabled state:%2.0f\n";
 
 void st_print_mt(nvObj_t *nv) { text_print_flt(nv, fmt_mt);}
+void st_print_pso(nvObj_t *nv) { text_print_ui8(nv, fmt_pso);}
 void st_print_me(nvObj_t *nv) { text_print_nul(nv, fmt_me);}
 void st_print_md(nvObj_t *nv) { text_print_nul(nv, fmt_md);}
 
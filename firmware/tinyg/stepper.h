@@ -304,6 +304,12 @@ enum cmMotorPowerMode {
  */
 #define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (NOM_SEGMENT_TIME * 60)))
 
+/* Step rate limit
+ *	The DDA can put out at most one step per tick. Motion the exec generates on its own
+ *	(e.g. pressure advance) is held to half that to leave room for the commanded move.
+ */
+#define STEP_RATE_MAX (FREQUENCY_DDA / 2)			// steps per second
+
 /* Step correction settings
  *	Step correction settings determine how the encoder error is fed back to correct position errors.
  *	Since the following_error is running 2 segments behind the current segment you have to be careful
@@ -354,7 +360,8 @@ typedef struct cfgMotor {				// per-motor configs
 } cfgMotor_t;
 
 typedef struct stConfig {				// stepper configs
-	float motor_power_timeout;			// seconds before setting motors to idle current (currently this is OFF)
+	float motor_power_timeout;			// seconds before setting motors to idle current (currently this is OFF)
+	uint8_t pso_output;					// GPIO1 output for position-synchronized pulses (1-4), 0 = off
 	cfgMotor_t mot[MOTORS];				// settings for motors 1-N
 } stConfig_t;
 
@@ -373,6 +380,14 @@ typedef struct stRunSingleton {			// Stepper static values and axis parameters
 	uint32_t dda_ticks_downcount;		// tick down-counter (unscaled)
 	uint32_t dda_ticks_X_substeps;		// ticks multiplied by scaling factor
 	stRunMotor_t mot[MOTORS];			// runtime motor structures
+
+	uint8_t pso_count;					// PSO pulses left to fire in this segment
+	uint8_t pso_high;					// PSO output is on - clear it on the next tick
+	uint16_t pso_ticks_downcount;		// ticks to the next PSO pulse
+	uint16_t pso_interval_ticks;		// ticks between PSO pulses
+#ifdef __AVR
+	PORT_t *pso_port;					// output port for PSO pulses (NULL = off)
+#endif
 	uint16_t magic_end;
 } stRunSingleton_t;
 
@@ -408,6 +423,10 @@ typedef struct stPrepSingleton {
 	uint32_t dda_ticks;					// DDA or dwell ticks for the move
 	uint32_t dda_ticks_X_substeps;		// DDA ticks scaled by substep factor
 	stPrepMotor_t mot[MOTORS];			// prep time motor structs
+
+	uint8_t pso_count;					// PSO pulses in the segment - consumed by the loader
+	uint16_t pso_first_ticks;			// ticks from segment start to the first PSO pulse
+	uint16_t pso_interval_ticks;		// ticks between PSO pulses
 	uint16_t magic_end;
 } stPrepSingleton_t;
 
@@ -421,6 +440,7 @@ void stepper_init_assertions(void);
 stat_t stepper_test_assertions(void);
 
 uint8_t st_runtime_isbusy(void);
+void st_get_actual_steps(float steps[]);
 void st_reset(void);
 void st_cycle_start(void);
 void st_cycle_end(void);
@@ -436,6 +456,7 @@ void st_prep_null(void);
 void st_prep_command(void *bf);		// use a void pointer since we don't know about mpBuf_t yet)
 void st_prep_dwell(float microseconds);
 stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
+void st_prep_pso(uint16_t first_ticks, uint16_t interval_ticks, uint8_t count);
 
 stat_t st_set_sa(nvObj_t *nv);
 stat_t st_set_tr(nvObj_t *nv);
@@ -447,6 +468,7 @@ stat_t st_get_pwr(nvObj_t *nv);
 stat_t st_set_mt(nvObj_t *nv);
 stat_t st_set_md(nvObj_t *nv);
 stat_t st_set_me(nvObj_t *nv);
+stat_t st_set_pso(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 
@@ -461,6 +483,7 @@ stat_t st_set_me(nvObj_t *nv);
 	void st_print_mt(nvObj_t *nv);
 	void st_print_me(nvObj_t *nv);
 	void st_print_md(nvObj_t *nv);
+	void st_print_pso(nvObj_t *nv);
 
 #else
 
@@ -475,6 +498,7 @@ stat_t st_set_me(nvObj_t *nv);
 	#define st_print_mt tx_print_stub
 	#define st_print_me tx_print_stub
 	#define st_print_md tx_print_stub
+	#define st_print_pso tx_print_stub
 
 #endif // __TEXT_MODE
 
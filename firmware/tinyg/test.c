@@ -42,6 +42,9 @@
 #include "tests/test_012_slow_moves.h"		// slow move test
 #include "tests/test_013_coordinate_offsets.h"	// what it says
 #include "tests/test_014_microsteps.h"		// test all microstep settings
+#include "tests/test_015_tool_offsets.h"		// G10 L1 tool table and G43/G49
+#include "tests/test_016_cutter_comp.h"		// G40/G41/G42 cutter radius compensation
+#include "tests/test_017_spiral_arcs.h"		// G2/G3 with different start and end radii
 #include "tests/test_050_mudflap.h"			// mudflap test - entire drawing
 #include "tests/test_051_braid.h"			// braid test - partial drawing
 
@@ -77,6 +80,9 @@ uint8_t run_test(nvObj_t *nv)
 		case 12: { xio_open(XIO_DEV_PGM, PGMFILE(&test_slow_moves),PGM_FLAGS); break;}
 		case 13: { xio_open(XIO_DEV_PGM, PGMFILE(&test_coordinate_offsets),PGM_FLAGS); break;}
 		case 14: { xio_open(XIO_DEV_PGM, PGMFILE(&test_microsteps),PGM_FLAGS); break;}
+		case 15: { xio_open(XIO_DEV_PGM, PGMFILE(&test_tool_offsets),PGM_FLAGS); break;}
+		case 16: { xio_open(XIO_DEV_PGM, PGMFILE(&test_cutter_comp),PGM_FLAGS); break;}
+		case 17: { xio_open(XIO_DEV_PGM, PGMFILE(&test_spiral_arcs),PGM_FLAGS); break;}
 		case 50: { xio_open(XIO_DEV_PGM, PGMFILE(&test_mudflap),PGM_FLAGS); break;}
 		case 51: { xio_open(XIO_DEV_PGM, PGMFILE(&test_braid),PGM_FLAGS); break;}
 #endif
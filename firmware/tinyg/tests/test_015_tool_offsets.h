@@ -0,0 +1,38 @@
+/*
+ * test_015_tool_offsets.h
+ *
+ * Notes:
+ *	  -	The character array should be derived from the filename (by convention)
+ *	  - Comments are not allowed in the char array, but gcode comments are OK e.g. (g0 test)
+ *	  - Leaves tool table entries 1 and 2 set. Tool change mode should be off ($tcm=0)
+ */
+const char test_tool_offsets[] PROGMEM = "\
+(MSG**** Tool length offsets test [v1] ****)\n\
+g00g17g21g40g49g80g90\n\
+g54\n\
+f600\n\
+(MSG**** test G10 L1 tool table ****)\n\
+(msgStep 1: Set tool 1 length to 10 and diameter to 6, tool 2 length to -5)\n\
+g10l1p1z10r3\n\
+g10l1p2z-5\n\
+$tt1\n\
+$tt2\n\
+(MSG**** test G43 / G49 ****)\n\
+(msgStep 1: Select tool 1. Move to Z0. Machine Z should be 0)\n\
+(msgStep 2: Apply G43. Move to Z0. Machine Z should be 10, work Z should be 0)\n\
+(msgStep 3: Apply G43 H2. Move to Z0. Machine Z should be -5)\n\
+(msgStep 4: Cancel with G49. Move to Z0. Machine Z should be 0)\n\
+t1m6\n\
+g0z0\n\
+g43\n\
+g0z0\n\
+$mpo\n\
+$pos\n\
+g43h2\n\
+g0z0\n\
+$mpo\n\
+g49\n\
+g0z0\n\
+$mpo\n\
+g4p0.5\n\
+m30";
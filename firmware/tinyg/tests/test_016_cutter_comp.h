@@ -0,0 +1,36 @@
+/*
+ * test_016_cutter_comp.h
+ *
+ * Notes:
+ *	  -	The character array should be derived from the filename (by convention)
+ *	  - Comments are not allowed in the char array, but gcode comments are OK e.g. (g0 test)
+ *	  - Sets tool table entry 1 to a 6 mm diameter. Tool change mode should be off ($tcm=0)
+ */
+const char test_cutter_comp[] PROGMEM = "\
+(MSG**** Cutter radius compensation test [v1] ****)\n\
+g00g17g21g40g49g80g90\n\
+g54\n\
+g10l1p1r3\n\
+t1m6\n\
+f600\n\
+(MSG**** test G41 - outside contour, climb cut ****)\n\
+(msgStep 1: Contour should be offset 3mm outside the 40x40 square with rounded outside corners)\n\
+(msgStep 2: The upper right corner arc should be offset to radius 13)\n\
+g0x-20y-20\n\
+g41d1g1x0y0\n\
+y40\n\
+x30\n\
+g2x40y30i0j-10\n\
+g1y0\n\
+x0\n\
+g40g1x-20y-20\n\
+(MSG**** test G42 - inside contour with inside corners ****)\n\
+(msgStep 3: Tool should stay 3mm inside the 40x40 square with sharp corners)\n\
+g42d1g1x0y0\n\
+y40\n\
+x40\n\
+y0\n\
+x0\n\
+g40g1x-20y-20\n\
+g0x0y0\n\
+m30";
@@ -0,0 +1,29 @@
+/*
+ * test_017_spiral_arcs.h
+ *
+ * Notes:
+ *	  -	The character array should be derived from the filename (by convention)
+ *	  - Comments are not allowed in the char array, but gcode comments are OK e.g. (g0 test)
+ *	  - Sets the arc spiral tolerance to 10 mm ($spt=10) - spirals this large are opt-in.
+ *		Puts it back to the 1 mm default (ARC_SPIRAL_TOLERANCE) at the end
+ */
+const char test_spiral_arcs[] PROGMEM = "\
+$spt=10\n\
+(MSG**** Spiral arc test [v1] ****)\n\
+g00g17g21g40g49g80g90\n\
+g0x0y0z0\n\
+f600\n\
+(msgStep 1: CW half turn spiralling out from radius 5 to radius 7)\n\
+g0x-5y0\n\
+g2x7y0i5j0\n\
+(msgStep 2: CCW half turn spiralling back in to radius 5)\n\
+g3x-5y0i-7j0\n\
+(msgStep 3: Spiral entry - 2 extra turns from radius 2 to radius 10 while ramping down 3mm)\n\
+g0x-2y0\n\
+g2x-10y0z-3i2j0p2\n\
+(msgStep 4: Mismatch beyond tolerance should fail with an arc specification error)\n\
+g0x-2y0z0\n\
+g2x40y0i2j0\n\
+g0x0y0z0\n\
+$spt=1\n\
+m30";
@@ -45,7 +45,7 @@
 /****** REVISIONS ******/
 
 #ifndef TINYG_FIRMWARE_BUILD
-#define TINYG_FIRMWARE_BUILD        440.20	// arc test
+#define TINYG_FIRMWARE_BUILD        440.45	// secondary pendant input
 
 #endif
 #define TINYG_FIRMWARE_VERSION		0.97					// firmware major version
@@ -64,6 +64,7 @@
 #define __HELP_SCREENS						// enables help screens (~3.5Kb)
 #define __CANNED_TESTS 						// enables $tests 		(~12Kb)
 #define __TEST_99 							// enables diagnostic test 99 (independent of other tests)
+//#define __UNIT_TESTS						// enables unit tests selected by the module __UNIT_TEST_xxx flags
 
 /****** DEVELOPMENT SETTINGS ******/
 
@@ -193,9 +194,10 @@ typedef uint16_t magic_t;		// magic number size
 #define HOMING_AXES	4			// number of axes that can be homed (assumes Zxyabc sequence)
 #define MOTORS		4			// number of motors on the board
 #define COORDS		6			// number of supported coordinate systems (1-6)
+#define TOOLS		4			// number of tool table entries (T1-T4). T0 is "no tool"
 #define PWMS		2			// number of supported PWM channels
 
-// Note: If you change COORDS you must adjust the entries in cfgArray table in config.c
+// Note: If you change COORDS or TOOLS you must adjust the entries in cfgArray table in config.c
 
 #define AXIS_X		0
 #define AXIS_Y		1
@@ -299,7 +301,7 @@ char *get_status_message(stat_t status);
 #define	STAT_FLOAT_IS_NAN 33
 #define	STAT_PERSISTENCE_ERROR 34
 #define	STAT_BAD_STATUS_REPORT_SETTING 35
-#define	STAT_ERROR_36 36
+#define	STAT_PREP_LINE_STEP_RATE_EXCEEDED 36
 #define	STAT_ERROR_37 37
 #define	STAT_ERROR_38 38
 #define	STAT_ERROR_39 39
@@ -390,8 +392,8 @@ char *get_status_message(stat_t status);
 #define	STAT_JSON_SYNTAX_ERROR 111              // JSON input string is not well formed
 #define	STAT_JSON_TOO_MANY_PAIRS 112            // JSON input string has too many JSON pairs
 #define	STAT_JSON_TOO_LONG 113					// JSON input or output exceeds buffer size
-#define	STAT_ERROR_114 114
-#define	STAT_ERROR_115 115
+#define	STAT_FIRMWARE_CRC_MISMATCH 114			// staged firmware image does not match its CRC
+#define	STAT_FIRMWARE_UPDATE_UNAVAILABLE 115	// bootloader API missing or firmware too large to stage
 #define	STAT_ERROR_116 116
 #define	STAT_ERROR_117 117
 #define	STAT_ERROR_118 118
@@ -466,11 +468,11 @@ char *get_status_message(stat_t status);
 #define STAT_T_WORD_IS_MISSING 178
 #define STAT_T_WORD_IS_INVALID 179
 
-#define	STAT_ERROR_180 180									// reserved for Gcode errors
-#define	STAT_ERROR_181 181
-#define	STAT_ERROR_182 182
-#define	STAT_ERROR_183 183
-#define	STAT_ERROR_184 184
+#define	STAT_CUTTER_COMPENSATION_GOUGE 180				// offset path would cut into the programmed contour
+#define	STAT_CUTTER_COMPENSATION_NOT_ALLOWED 181		// command cannot be run with G41/G42 active
+#define	STAT_PREPLANNED_JERK_EXCEEDS_LIMITS 182			// host-planned line cannot reach its velocities at max jerk
+#define	STAT_PREPLANNED_VELOCITY_MISMATCH 183			// host-planned entry velocity does not match the previous line
+#define	STAT_ERROR_184 184									// reserved for Gcode errors
 #define	STAT_ERROR_185 185
 #define	STAT_ERROR_186 186
 #define	STAT_ERROR_187 187
@@ -548,6 +550,7 @@ char *get_status_message(stat_t status);
 #define	STAT_PROBE_CYCLE_FAILED 250						// probing cycle did not complete
 #define STAT_PROBE_ENDPOINT_IS_STARTING_POINT 251
 #define	STAT_JOGGING_CYCLE_FAILED 252					// jogging cycle did not complete
+#define	STAT_TOOL_CHANGE_CYCLE_FAILED 253				// tool change cycle did not complete
 
 // !!! Do not exceed 255 without also changing stat_t typedef
 
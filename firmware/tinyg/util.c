@@ -283,6 +283,33 @@ uint32_t SysTickTimer_getValue()
 }
 #endif // __ARM
 
+/*
+ * ut_check()  - count a unit test check and print it if it failed
+ * ut_report() - print the failures since the last report for a suite and reset the count
+ *
+ *	name and suite are PROGMEM strings (use PSTR()), detail is a RAM string or "".
+ */
+#ifdef __UNIT_TESTS
+static uint8_t ut_fails;
+
+void ut_check(const char *name, const char *detail, const uint8_t passed)
+{
+	if (passed == false) {
+		ut_fails++;
+		printf_P(PSTR("unit test failed: %S %s\n"), name, detail);
+	}
+}
+
+uint8_t ut_report(const char *suite)
+{
+	uint8_t fails = ut_fails;
+
+	printf_P(PSTR("%S unit tests: %d failed\n"), suite, fails);
+	ut_fails = 0;
+	return (fails);
+}
+#endif // __UNIT_TESTS
+
 #ifdef __cplusplus
 }
 #endif
@@ -85,6 +85,13 @@ uint16_t compute_checksum(char_t const *string, const uint16_t length);
 
 uint32_t SysTickTimer_getValue(void);
 
+//*** unit test support ***
+
+#ifdef __UNIT_TESTS
+void ut_check(const char *name, const char *detail, const uint8_t passed);
+uint8_t ut_report(const char *suite);
+#endif
+
 //**** Math Support *****
 
 #ifndef square
@@ -85,6 +85,7 @@
 //
 typedef struct xioSingleton {
 	FILE * stderr_shadow;			// used for stack overflow / memory integrity checking
+	uint8_t stderr_dev;				// XIO_DEV bound to stderr - used by xio_write_stderr()
 } xioSingleton_t;
 xioSingleton_t xio;
 
@@ -213,6 +214,11 @@ void xio_open_generic(uint8_t dev, x_open_t x_open,
  * xio_gets() - entry point for non-blocking get line function
  * xio_getc() - entry point for getc (not stdio compatible)
  * xio_putc() - entry point for putc (not stdio compatible)
+ * xio_write() - entry point for bulk writes (not stdio compatible)
+ * xio_write_stderr() - bulk write to whatever device is bound to stderr
+ *
+ *	xio_write() bypasses stdio. USB has a native span writer that copies into the TX
+ *	buffer with one TX interrupt enable per span. Other devices fall back to putc.
  *
  * It might be prudent to run an assertion such as below, but we trust the callers:
  * 	if (dev < XIO_DEV_COUNT) blah blah blah
@@ -238,6 +244,22 @@ int xio_putc(const uint8_t dev, const char c)
 	return (ds[dev].x_putc(c, &ds[dev].file));
 }
 
+int xio_write(const uint8_t dev, const char *buf, const int len)
+{
+	if (dev == XIO_DEV_USB)
+		return (xio_write_usb(buf, len));
+
+	for (int i=0; i<len; i++) {
+		ds[dev].x_putc(buf[i], &ds[dev].file);
+	}
+	return (XIO_OK);
+}
+
+int xio_write_stderr(const char *buf, const int len)
+{
+	return (xio_write(xio.stderr_dev, buf, len));
+}
+
 /*
  * xio_ctrl() - PUBLIC set control flags (top-level XIO_DEV access)
  * xio_ctrl_generic() - PRIVATE but generic set-control-flags
@@ -288,10 +310,54 @@ void xio_fc_null(xioDev_t *d)
 	return;
 }
 
+/*
+ * xio_trap_realtime() - return true if an RX byte is an extended realtime command
+ *
+ *	Called from the RX ISRs, which drop trapped bytes from the RX queue. CAM output and
+ *	JSON messages can carry UTF-8 text (an em dash is E2 80 94), so 8-bit bytes are only
+ *	trapped if they have an assigned meaning and arrive outside of Gcode comments - (...)
+ *	or ; to end of line - and JSON strings, and are not the continuation of a UTF-8
+ *	sequence. Comment and string state is reset at every CR or LF.
+ */
+uint8_t xio_trap_realtime(xioDev_t *d, const char c)
+{
+	uint8_t b = (uint8_t)c;
+
+	if ((d->rx_utf8 > 0) && ((b & 0xC0) == 0x80)) {	// UTF-8 continuation byte
+		d->rx_utf8--;
+		return (false);
+	}
+	d->rx_utf8 = 0;
+	if (b >= 0xC0) {									// UTF-8 lead byte
+		d->rx_utf8 = (b >= 0xF0) ? 3 : ((b >= 0xE0) ? 2 : 1);
+		return (false);
+	}
+	if (b < 0x80) {										// track comments and strings
+		if ((c == CR) || (c == LF)) {
+			d->rx_text = 0;
+		} else if (d->rx_text == 0) {
+			if (c == '(') d->rx_text = ')';
+			if (c == ';') d->rx_text = LF;
+			if (c == '"') d->rx_text = '"';
+		} else if (c == d->rx_text) {
+			d->rx_text = 0;
+		}
+		return (false);
+	}
+	if (d->rx_text != 0) return (false);				// 8-bit text in a comment or string
+	if ((b == CHAR_STATUS_REPORT) || (b == CHAR_SAFETY_DOOR) || (b == CHAR_JOG_CANCEL) ||
+		((b >= CHAR_FEED_OVR_RESET) && (b <= CHAR_TRAVERSE_OVR_LOW)) ||
+		((b >= CHAR_SPINDLE_OVR_RESET) && (b <= CHAR_SPINDLE_OVR_FINE_MINUS))) {
+		return (true);
+	}
+	return (false);
+}
+
 /*
  * xio_set_stdin()  - set stdin from device number
  * xio_set_stdout() - set stdout from device number
  * xio_set_stderr() - set stderr from device number
+ * xio_get_stderr() - get the device number bound to stderr
  *
  *	stderr is defined in stdio as __iob[2]. Turns out stderr is the last RAM
  *	allocated by the linker for this project. We usae that to keep a shadow
@@ -302,5 +368,7 @@ void xio_set_stdout(const uint8_t dev) { stdout = &ds[dev].file; }
 void xio_set_stderr(const uint8_t dev)
 {
 	stderr = &ds[dev].file;
+	xio.stderr_dev = dev;
 	xio.stderr_shadow = stderr;		// this is the last thing in RAM, so we use it as a memory corruption canary
 }
+uint8_t xio_get_stderr() { return (xio.stderr_dev);}
@@ -142,6 +142,8 @@ typedef struct xioDEVICE {						// common device struct (one per dev)
 	uint8_t flag_in_line;						// used as a state variable for line reads
 	uint8_t flag_eol;							// end of line detected
 	uint8_t flag_eof;							// end of file detected
+	uint8_t rx_text;							// RX ISR is inside a comment or string: closing char, or LF for EOL
+	uint8_t rx_utf8;							// RX ISR UTF-8 continuation bytes still expected
 	char *buf;									// text buffer binding (can be dynamic)
 	uint16_t magic_end;
 } xioDev_t;
@@ -188,6 +190,8 @@ int xio_ctrl(const uint8_t dev, const flags_t flags);
 int xio_gets(const uint8_t dev, char *buf, const int size);
 int xio_getc(const uint8_t dev);
 int xio_putc(const uint8_t dev, const char c);
+int xio_write(const uint8_t dev, const char *buf, const int len);
+int xio_write_stderr(const char *buf, const int len);
 int xio_set_baud(const uint8_t dev, const uint8_t baud_rate);
 
 // generic functions (private, but at virtual level)
@@ -201,6 +205,7 @@ void xio_open_generic(uint8_t dev, x_open_t x_open,
 								   x_flow_t x_flow);
 
 void xio_fc_null(xioDev_t *d);			// NULL flow control callback
+uint8_t xio_trap_realtime(xioDev_t *d, const char c);	// RX ISR extended realtime filter
 void xio_fc_usart(xioDev_t *d);			// XON/XOFF flow control callback
 
 // std devices
@@ -208,6 +213,7 @@ void xio_init_stdio(void);				// set std devs & do startup prompt
 void xio_set_stdin(const uint8_t dev);
 void xio_set_stdout(const uint8_t dev);
 void xio_set_stderr(const uint8_t dev);
+uint8_t xio_get_stderr(void);
 
 /*************************************************************************
  * SUPPORTING DEFINTIONS - SHOULD NOT NEED TO CHANGE
@@ -284,6 +290,29 @@ enum xioSignals {
 #define CHAR_QUEUE_FLUSH (char)'%'
 //#define CHAR_BOOTLOADER ESC
 
+/* Extended realtime characters
+ *	The assigned bytes below are trapped by the RX ISR and handed to cm_request_realtime().
+ *	They never enter the RX queue. Values follow the grbl extended-ASCII assignments so
+ *	existing senders and pendants can drive them. Bytes inside comments, JSON strings and
+ *	UTF-8 sequences are not trapped, nor are unassigned bytes (see xio_trap_realtime()).
+ */
+#define CHAR_STATUS_REPORT			0x80	// request an immediate status report
+#define CHAR_SAFETY_DOOR			0x84	// safety door opened (hold, spindle & coolant off)
+#define CHAR_JOG_CANCEL				0x85	// cancel an active jog
+#define CHAR_FEED_OVR_RESET			0x90	// feed override to 100%
+#define CHAR_FEED_OVR_COARSE_PLUS	0x91	// feed override +10%
+#define CHAR_FEED_OVR_COARSE_MINUS	0x92	// feed override -10%
+#define CHAR_FEED_OVR_FINE_PLUS		0x93	// feed override +1%
+#define CHAR_FEED_OVR_FINE_MINUS	0x94	// feed override -1%
+#define CHAR_TRAVERSE_OVR_RESET		0x95	// traverse override to 100%
+#define CHAR_TRAVERSE_OVR_MEDIUM	0x96	// traverse override to 50%
+#define CHAR_TRAVERSE_OVR_LOW		0x97	// traverse override to 25%
+#define CHAR_SPINDLE_OVR_RESET		0x99	// spindle override to 100%
+#define CHAR_SPINDLE_OVR_COARSE_PLUS 0x9A	// spindle override +10%
+#define CHAR_SPINDLE_OVR_COARSE_MINUS 0x9B	// spindle override -10%
+#define CHAR_SPINDLE_OVR_FINE_PLUS	0x9C	// spindle override +1%
+#define CHAR_SPINDLE_OVR_FINE_MINUS	0x9D	// spindle override -1%
+
 /* XIO return codes
  * These codes are the "inner nest" for the STAT_ return codes.
  * The first N TG codes correspond directly to these codes.
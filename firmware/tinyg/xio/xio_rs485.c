@@ -170,6 +170,10 @@ ISR(RS485_RX_ISR_vect)	//ISR(USARTC1_RXC_vect)		// serial port C0 RX isr
 		cm_request_cycle_start();
 		return;
 	}
+	if (xio_trap_realtime(&RS, c)) {				// trap extended realtime commands (pendant overrides)
+		cm_request_realtime((uint8_t)c);
+		return;
+	}
 	// filter out CRs and LFs if they are to be ignored
 	if ((c == CR) && (RS.flag_ignorecr)) return;
 	if ((c == LF) && (RS.flag_ignorelf)) return;
@@ -196,6 +196,7 @@ int xio_gets_usart(xioDev_t *d, char *buf, const int size);
 int xio_getc_usart(FILE *stream);
 int xio_putc_usart(const char c, FILE *stream);
 int xio_putc_usb(const char c, FILE *stream);	// stdio compatible put character
+int xio_write_usb(const char *buf, const int len);	// bulk span writer (not stdio compatible)
 int xio_putc_rs485(const char c, FILE *stream);	// stdio compatible put character
 void xio_enable_rs485_rx(void);					// needed for startup
 void xio_enable_rs485_tx(void);					// included for completeness
@@ -38,7 +38,8 @@
 
 /*
  * xio_putc_usb()
- * USB_TX_ISR - USB transmitter interrupt (TX) used by xio_usb_putc()
+ * xio_write_usb()
+ * USB_TX_ISR - USB transmitter interrupt (TX) used by xio_usb_putc() and xio_write_usb()
  *
  * 	These are co-routines that work in tandem.
  * 	xio_putc_usb() is a more efficient form derived from xio_putc_usart()
@@ -77,6 +78,46 @@ int xio_putc_usb(const char c, FILE *stream)
 	return (XIO_OK);
 }
 
+/*
+ * xio_write_usb() - write a span of characters to the USB TX buffer
+ *
+ *	Same buffer protocol and <LF> expansion as xio_putc_usb(), but the TX interrupt is
+ *	disabled once while as much of the span as fits is copied in, then re-enabled once.
+ *	If the buffer fills the routine enables TX, sleeps until the ISR drains some space,
+ *	and continues with the rest of the span.
+ */
+
+int xio_write_usb(const char *buf, const int len)
+{
+	int i = 0;
+	bool cr_pending = false;							// <CR> owed after an expanded <LF>
+
+	while ((i < len) || cr_pending) {
+		USBu.usart->CTRLA = CTRLA_RXON_TXOFF;			// disable TX interrupt (mutex region)
+		while ((i < len) || cr_pending) {
+			buffer_t next_tx_buf_head = USBu.tx_buf_head-1;
+			if (next_tx_buf_head == 0)
+				next_tx_buf_head = TX_BUFFER_SIZE-1;
+			if (next_tx_buf_head == USBu.tx_buf_tail)	// buffer full
+				break;
+			USBu.tx_buf_head = next_tx_buf_head;
+			if (cr_pending) {
+				USBu.tx_buf[USBu.tx_buf_head] = CR;
+				cr_pending = false;
+				continue;
+			}
+			char c = buf[i++];
+			USBu.tx_buf[USBu.tx_buf_head] = c;
+			if ((c == '\n') && (USB.flag_crlf))
+				cr_pending = true;
+		}
+		USBu.usart->CTRLA = CTRLA_RXON_TXON;			// force interrupt to send the span
+		if ((i < len) || cr_pending)
+			sleep_mode();								// sleep until the ISR frees some space
+	}
+	return (XIO_OK);
+}
+
 ISR(USB_TX_ISR_vect) //ISR(USARTC0_DRE_vect)		// USARTC0 data register empty
 {
 	// If the CTS pin (FTDI's RTS) is HIGH, then we cannot send anything, so exit
@@ -127,6 +168,8 @@ ISR(USB_CTS_ISR_vect)
  *	- Signals are captured at the ISR level and either dispatched or flag-set
  *	- As RX ISR is a critical code region signal handling is stupid and fast
  *	- signal characters are not put in the RX buffer
+ *	- assigned bytes >= 0x80 outside of comments and strings are extended realtime commands
+ *	  and are queued to the canonical machine (see xio_trap_realtime())
  *
  * Flow Control:
  *	- Flow control is not implemented. Need to work RTS line.
@@ -159,6 +202,10 @@ ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
 		cm_request_cycle_start();
 		return;
 	}
+	if (xio_trap_realtime(&USB, c)) {			// trap extended realtime commands
+		cm_request_realtime((uint8_t)c);
+		return;
+	}
 	if (USB.flag_xoff) {
 		if (c == XOFF) {						// trap incoming XON/XOFF signals
 			USBu.fc_state_tx = FC_IN_XOFF;
@@ -92,14 +92,73 @@
 #ifdef __UNIT_TEST_EEPROM
 #include <stdio.h>
 #include <avr/pgmspace.h>			// precursor for xio.h
-#include <string.h>					// for memset()
-#include <avr/pgmspace.h>
 #include "xio.h"					// all device includes are nested here
+#include "../util.h"				// unit test checks
 #endif
 
 #define __USE_AVR1008_EEPROM		// use the AVR1008 workaround code
 #define ARBITRARY_MAX_LENGTH 80		// string max for NNVM write
 
+/**** Deferred write queue ****
+ *
+ *	Writes are queued by the foreground and written out later, one page write
+ *	per EEPROM_QueueService() call, when the caller knows it is safe to block.
+ *	Each page write is synchronous. The queue only defers writes - it does not
+ *	overlap them with other work. Everything runs in the foreground, so no
+ *	locking is required.
+ *
+ *	Under __NNVM the same queue is used and EEPROM_QueueService() writes the tail
+ *	into the emulation RAM, so the queue logic can be exercised without an EEPROM.
+ */
+
+typedef struct eeQueueItem {
+	uint16_t address;					// EEPROM address of first byte
+	uint8_t len;						// number of bytes to write
+	int8_t data[EEPROM_QUEUE_ITEM_LEN];
+} eeQueueItem_t;
+
+typedef struct eeQueue {
+	uint8_t head;						// next free slot
+	uint8_t tail;						// oldest pending write
+	uint16_t completed;					// count of completed writes (wraps)
+	eeQueueItem_t item[EEPROM_QUEUE_SIZE];
+} eeQueue_t;
+
+static eeQueue_t eeq;
+
+/*
+ * _queue_read()	- read from the newest queued write that covers the whole range
+ * _queue_overlay() - apply queued writes (oldest first) over bytes read from EEPROM
+ */
+static uint8_t _queue_read(const uint16_t address, int8_t *buf, const uint16_t size)
+{
+	uint8_t i = eeq.head;
+
+	while (i != eeq.tail) {
+		if (i == 0) i = EEPROM_QUEUE_SIZE;
+		eeQueueItem_t *item = &eeq.item[--i];
+		if ((address >= item->address) && ((address + size) <= (item->address + item->len))) {
+			memcpy(buf, &item->data[address - item->address], size);
+			return (true);
+		}
+	}
+	return (false);
+}
+
+static void _queue_overlay(const uint16_t address, int8_t *buf, const uint16_t size)
+{
+	for (uint8_t i = eeq.tail; i != eeq.head; ) {
+		eeQueueItem_t *item = &eeq.item[i];
+		for (uint8_t j=0; j < item->len; j++) {
+			uint16_t addr = item->address + j;
+			if ((addr >= address) && (addr < (address + size))) {
+				buf[addr - address] = item->data[j];
+			}
+		}
+		if (++i >= EEPROM_QUEUE_SIZE) i = 0;
+	}
+}
+
 /**** Inline assembly to support NVM operations ****/
 
 static inline void NVM_EXEC(void)
@@ -262,12 +321,14 @@ void NNVM_ReadBytes(const uint16_t address, int8_t *buf, const uint16_t size)
 uint16_t EEPROM_WriteString(const uint16_t address, const char *buf, const uint8_t terminate)
 {
 #ifdef __NNVM
+	EEPROM_QueueFlush();		// keep queued and direct writes in order
 	NNVM_WriteString(address, buf, true);
 	return (address);
 #else
 	uint16_t addr = address;	// local copy
 	uint8_t i = 0;				// index into string
 
+	EEPROM_QueueFlush();		// keep queued and direct writes in order
 	EEPROM_DisableMapping();
 	while (buf[i]) {
 		EEPROM_WriteByte(addr++, buf[i++]);
@@ -382,7 +443,8 @@ uint16_t EEPROM_ReadString(const uint16_t address, char *buf, const uint16_t siz
  *	This function writes a byte buffer to IO mapped EEPROM.
  *	If memory mapped EEPROM is enabled this function will not work.
  *	This functiom will cancel all ongoing EEPROM page buffer loading
- *	operations, if any.
+ *	operations, if any. Blocks for each page write - see EEPROM_QueueBytes()
+ *	to defer the write until the machine is idle.
  *
  *	Returns address past the write
  */
@@ -390,12 +452,14 @@ uint16_t EEPROM_ReadString(const uint16_t address, char *buf, const uint16_t siz
 uint16_t EEPROM_WriteBytes(const uint16_t address, const int8_t *buf, const uint16_t size)
 {
 #ifdef __NNVM
+	EEPROM_QueueFlush();		// keep queued and direct writes in order
 	NNVM_WriteBytes(address, buf, size);
 	return(address + size);
 #else
 	uint16_t i;
 	uint16_t addr = address;	// local copy
 
+	EEPROM_QueueFlush();		// keep queued and direct writes in order
 	EEPROM_DisableMapping();
 	for (i=0; i<size; i++) {
 		EEPROM_WriteByte(addr++, buf[i]);
@@ -410,17 +474,27 @@ uint16_t EEPROM_WriteBytes(const uint16_t address, const int8_t *buf, const uint
  *	This function reads a character string to IO mapped EEPROM.
  *	If memory mapped EEPROM is enabled this function will not work.
  *	A string may span multiple EEPROM pages.
+ *
+ *	Bytes with a queued write that has not yet completed are returned from the
+ *	queue. A read that a single queued write covers does not touch the NVM, so it
+ *	does not wait for a page write in progress.
  */
 
 uint16_t EEPROM_ReadBytes(const uint16_t address, int8_t *buf, const uint16_t size)
 {
 #ifdef __NNVM
-	NNVM_ReadBytes(address, buf, size);
+	if (_queue_read(address, buf, size) == false) {
+		NNVM_ReadBytes(address, buf, size);
+		_queue_overlay(address, buf, size);
+	}
 	return(address + size);
 #else
 	uint16_t i;
 	uint16_t addr = address;				// local copy
 
+	if (_queue_read(address, buf, size) == true) {
+		return (address + size);
+	}
 	EEPROM_DisableMapping();
 
 	for (i=0; i<size; i++) {
@@ -433,10 +507,101 @@ uint16_t EEPROM_ReadBytes(const uint16_t address, int8_t *buf, const uint16_t si
 		NVM_EXEC();
 		buf[i] = NVM.DATA0;
 	}
+	_queue_overlay(address, buf, size);
 	return (addr);
 #endif //__NNVM
 }
 
+/*
+ * EEPROM_QueueBytes()	   - queue N bytes to be written later
+ * EEPROM_QueueService()   - write the oldest queued item out (blocks for one page write)
+ * EEPROM_QueueFlush()	   - write out everything that is queued
+ * EEPROM_QueuePending()   - return number of queued writes not yet written
+ * EEPROM_QueueCompleted() - return running count of completed writes (wraps)
+ *
+ *	EEPROM_QueueBytes() returns false and queues nothing if the queue is full or
+ *	the write does not fit in one queue item and one page. A write to an address
+ *	that is already queued replaces the queued data, which saves a page erase.
+ *
+ *	EEPROM_QueueService() loads the page buffer, runs the atomic page write and
+ *	waits for it to finish, like EEPROM_WriteBytes(). Writes complete in queue order.
+ *	The AVR1008 workaround this file uses sleeps through the page write with HI
+ *	level interrupts enabled, and a HI interrupt that wakes the CPU early corrupts
+ *	the write. The DDA, dwell and load timers are all HI level, so only call
+ *	EEPROM_QueueService() and EEPROM_QueueFlush() when the steppers are idle - see
+ *	persistence_callback(). The foreground is held for a few ms per page write.
+ *
+ *	Under __NNVM EEPROM_QueueService() copies the tail item to the emulation RAM.
+ */
+
+uint8_t EEPROM_QueueBytes(const uint16_t address, const int8_t *buf, const uint8_t size)
+{
+	if ((size == 0) || (size > EEPROM_QUEUE_ITEM_LEN) ||
+		((address & EEPROM_BYTE_ADDR_MASK_gm) + size > EEPROM_PAGESIZE)) {
+		return (false);
+	}
+	for (uint8_t i = eeq.tail; i != eeq.head; ) {
+		if ((eeq.item[i].address == address) && (eeq.item[i].len == size)) {
+			memcpy(eeq.item[i].data, buf, size);
+			return (true);
+		}
+		if (++i >= EEPROM_QUEUE_SIZE) i = 0;
+	}
+	uint8_t next = eeq.head + 1;
+	if (next >= EEPROM_QUEUE_SIZE) next = 0;
+	if (next == eeq.tail) {
+		return (false);						// queue is full
+	}
+	eeq.item[eeq.head].address = address;
+	eeq.item[eeq.head].len = size;
+	memcpy(eeq.item[eeq.head].data, buf, size);
+	eeq.head = next;
+	return (true);
+}
+
+void EEPROM_QueueService(void)
+{
+	if (eeq.tail == eeq.head) {
+		return;
+	}
+	eeQueueItem_t *item = &eeq.item[eeq.tail];
+#ifdef __NNVM
+	NNVM_WriteBytes(item->address, item->data, item->len);
+#else
+	EEPROM_DisableMapping();				// *** SAFETY ***
+	EEPROM_FlushBuffer();					// prevent unintentional write
+	NVM.CMD = NVM_CMD_LOAD_EEPROM_BUFFER_gc;// load page_load command
+	NVM.ADDR1 = (item->address >> 8) & EEPROM_ADDR1_MASK_gm;
+	NVM.ADDR2 = 0x00;
+	for (uint8_t i=0; i < item->len; i++) {
+		NVM.ADDR0 = (item->address + i) & 0xFF;
+		NVM.DATA0 = item->data[i];			// triggers EEPROM page buffer load
+	}
+	NVM.CMD = NVM_CMD_ERASE_WRITE_EEPROM_PAGE_gc;// Atomic Write (Erase&Write)
+	NVM_EXEC_WRAPPER();
+	EEPROM_WaitForNVM();
+#endif //__NNVM
+	if (++eeq.tail >= EEPROM_QUEUE_SIZE) eeq.tail = 0;
+	eeq.completed++;
+}
+
+void EEPROM_QueueFlush(void)
+{
+	while (eeq.tail != eeq.head) {
+		EEPROM_QueueService();
+	}
+}
+
+uint8_t EEPROM_QueuePending(void)
+{
+	return ((eeq.head - eeq.tail + EEPROM_QUEUE_SIZE) % EEPROM_QUEUE_SIZE);
+}
+
+uint16_t EEPROM_QueueCompleted(void)
+{
+	return (eeq.completed);
+}
+
 /*************************************************************************
  ****** Functions from Atmel eeprom_driver.c w/some changes **************
  *************************************************************************/
@@ -665,3 +830,71 @@ inline void EEPROM_EraseAll( void )
 	NVM_EXEC_WRAPPER();
 }
 
+
+/*****************************************************************************
+ * UNIT TESTS
+ *
+ *	Exercise the deferred write queue against the NNVM emulation, so they can
+ *	run on a board (or the simulator) without wearing the EEPROM. Define __NNVM,
+ *	__UNIT_TESTS and __UNIT_TEST_EEPROM to build them. They use the last two emulation pages
+ *	and put back what was there, so they can run after config_init().
+ *****************************************************************************/
+
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_EEPROM) && defined (__NNVM)
+
+#define EE_TEST_ADDR (((NNVM_SIZE / EEPROM_PAGESIZE) - 2) * EEPROM_PAGESIZE)
+
+void EEPROM_unit_tests()
+{
+	char save[2*EEPROM_PAGESIZE];
+	int8_t buf[8];
+	uint16_t completed;
+
+	EEPROM_QueueFlush();
+	memcpy(save, &nnvm[EE_TEST_ADDR], sizeof(save));
+	memset(&nnvm[EE_TEST_ADDR], 0, sizeof(save));
+	completed = EEPROM_QueueCompleted();
+
+	// rejected writes queue nothing
+	ut_check(PSTR("zero length"), "", EEPROM_QueueBytes(EE_TEST_ADDR, (int8_t *)"abcd", 0) == false);
+	ut_check(PSTR("oversize"), "", EEPROM_QueueBytes(EE_TEST_ADDR, (int8_t *)"abcde", EEPROM_QUEUE_ITEM_LEN+1) == false);
+	ut_check(PSTR("page span"), "", EEPROM_QueueBytes(EE_TEST_ADDR + EEPROM_PAGESIZE-2, (int8_t *)"abcd", 4) == false);
+	ut_check(PSTR("rejects pending"), "", EEPROM_QueuePending() == 0);
+
+	// a queued write is deferred until serviced, but reads see it
+	EEPROM_QueueBytes(EE_TEST_ADDR, (int8_t *)"abcd", 4);
+	ut_check(PSTR("deferred"), "", (EEPROM_QueuePending() == 1) && (nnvm[EE_TEST_ADDR] == 0));
+	EEPROM_ReadBytes(EE_TEST_ADDR, buf, 4);
+	ut_check(PSTR("queued read"), "", memcmp(buf, "abcd", 4) == 0);
+
+	// rewriting the same address replaces the queued data
+	EEPROM_QueueBytes(EE_TEST_ADDR, (int8_t *)"wxyz", 4);
+	EEPROM_ReadBytes(EE_TEST_ADDR, buf, 4);
+	ut_check(PSTR("coalesce"), "", (EEPROM_QueuePending() == 1) && (memcmp(buf, "wxyz", 4) == 0));
+
+	// overlapping writes apply oldest first, and partial reads are overlaid
+	EEPROM_QueueBytes(EE_TEST_ADDR+2, (int8_t *)"12", 2);
+	EEPROM_ReadBytes(EE_TEST_ADDR, buf, 6);
+	ut_check(PSTR("overlay"), "", memcmp(buf, "wx12\0\0", 6) == 0);
+
+	EEPROM_QueueService();
+	ut_check(PSTR("service one"), "", (EEPROM_QueuePending() == 1) && (memcmp(&nnvm[EE_TEST_ADDR], "wxyz", 4) == 0));
+	EEPROM_QueueFlush();
+	ut_check(PSTR("flush order"), "", memcmp(&nnvm[EE_TEST_ADDR], "wx12", 4) == 0);
+	ut_check(PSTR("completed"), "", (EEPROM_QueuePending() == 0) && (EEPROM_QueueCompleted() - completed == 2));
+
+	// the queue holds EEPROM_QUEUE_SIZE-1 writes
+	for (uint8_t i=0; i < EEPROM_QUEUE_SIZE-1; i++) {
+		ut_check(PSTR("fill"), "", EEPROM_QueueBytes(EE_TEST_ADDR + EEPROM_PAGESIZE + i*4, (int8_t *)&i, 1) == true);
+	}
+	ut_check(PSTR("full"), "", EEPROM_QueueBytes(EE_TEST_ADDR, (int8_t *)"abcd", 4) == false);
+
+	// a direct write lands after the queued writes to the same address
+	EEPROM_WriteBytes(EE_TEST_ADDR + EEPROM_PAGESIZE, (int8_t *)"Q", 1);
+	ut_check(PSTR("direct after queued"), "", (EEPROM_QueuePending() == 0) && (nnvm[EE_TEST_ADDR + EEPROM_PAGESIZE] == 'Q'));
+
+	memcpy(&nnvm[EE_TEST_ADDR], save, sizeof(save));
+	ut_report(PSTR("EEPROM"));
+}
+
+#endif // __UNIT_TESTS && __UNIT_TEST_EEPROM && __NNVM
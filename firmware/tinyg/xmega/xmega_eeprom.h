@@ -73,11 +73,21 @@
 #define EEPROM(_pageAddr, _byteAddr) \
 	((uint8_t *) MAPPED_EEPROM_START)[_pageAddr*EEPROM_PAGESIZE + _byteAddr]
 
+#define EEPROM_QUEUE_SIZE 8				// deferred write queue depth (one slot is unused)
+#define EEPROM_QUEUE_ITEM_LEN 4			// max bytes per queued write. Must not span a page
+
 /* function prototypes for TinyG added functions */
 uint16_t EEPROM_WriteString(const uint16_t address, const char *buf, const uint8_t terminate);
 uint16_t EEPROM_ReadString(const uint16_t address, char *buf, const uint16_t size);
 uint16_t EEPROM_WriteBytes(const uint16_t address, const int8_t *buf, const uint16_t size);
 uint16_t EEPROM_ReadBytes(const uint16_t address, int8_t *buf, const uint16_t size);
+
+/* deferred (queued) writes */
+uint8_t EEPROM_QueueBytes(const uint16_t address, const int8_t *buf, const uint8_t size);
+void EEPROM_QueueService(void);
+void EEPROM_QueueFlush(void);
+uint8_t EEPROM_QueuePending(void);
+uint16_t EEPROM_QueueCompleted(void);
 
 //#ifdef __UNIT_TEST_EEPROM
 void EEPROM_unit_tests(void);
@@ -204,8 +214,8 @@ void EEPROM_EraseAll( void );
 
 */
 
-//#define __UNIT_TEST_EEPROM
-#ifdef __UNIT_TEST_EEPROM
+//#define __UNIT_TEST_EEPROM		// run queue tests at startup - requires __NNVM and __UNIT_TESTS
+#if defined (__UNIT_TESTS) && defined (__UNIT_TEST_EEPROM)
 void EEPROM_unit_tests(void);
 #define	EEPROM_UNITS EEPROM_unit_tests();
 #else